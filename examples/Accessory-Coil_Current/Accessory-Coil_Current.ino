@@ -0,0 +1,169 @@
+//******************************************************************************************************
+//
+//                 Switch decoder for coils, with current sensed (adaptive) pulse lengths
+//
+// purpose:   Most switch decoders activate a coil for a fixed time, that must be long enough for the
+//            slowest switch. Most solenoids, however, have switched well before. This sketch measures
+//            the coil current and ends the pulse as soon as the armature has reached its end stop.
+//            Since only one coil is activated at a time, this increases the number of switches per
+//            second (faster routes) and lowers the load on the power supply.
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0 ap initial version
+//
+// usage:     This sketch should declare the following objects:
+//            - extern Dcc           dcc;     // The main DCC object
+//            - extern Accessory     accCmd;  // To retrieve the data from accessory commands
+//
+//            Received commands are put in a small queue, and coils are activated one after the other.
+//            The ADC runs in free-running mode while a coil is active. Each result is passed by the
+//            ADC ISR to the CoilDetector (see CoilDetector.h), which decides when to end the pulse.
+//            The ISR itself switches the coil off, so the pulse ends without waiting for loop().
+//            If no completion is detected, the pulse ends after maxPulseMs (the fixed length fallback).
+//
+//            The detector parameters should be validated against current profiles recorded from the
+//            real coils. If RECORD_PROFILE is defined, the samples of each pulse are printed, and can
+//            be replayed on a PC with extras/Host_Simulation/coil_profile_replay.cpp
+//
+// hardware:  - AVR DA / DB, DxCore board
+//            - 8 coil outputs (4 switches), for example via ULN2803
+//            - a shunt resistor in the common return of the coils, connected to an ADC input
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#include <Arduino.h>
+#include <AP_DCC_library.h>
+#include "CoilDetector.h"
+
+const uint8_t dccPin = PIN_PD0;
+const uint8_t currentPin = PIN_PD2;                  // Shunt resistor
+const uint8_t currentMux = ADC_MUXPOS_AIN2_gc;       // ADC channel of currentPin
+const uint8_t coilPin[8] = {PIN_PA0, PIN_PA1, PIN_PA2, PIN_PA3, PIN_PA4, PIN_PA5, PIN_PA6, PIN_PA7};  // The ISR assumes PA0..PA7
+const uint8_t myDecoderAddress = 24;                 // Switches 97..100 (OpenDCC / RCN-213)
+
+const uint16_t blankMs = 5;                          // No completion accepted within this time
+const uint16_t maxPulseMs = 100;                     // Fixed length fallback
+const uint16_t holdMs = 3;                           // Coil remains on after completion
+// #define RECORD_PROFILE
+
+//******************************************************************************************************
+//                                  No need to edit below
+//******************************************************************************************************
+extern Dcc dcc;                  // This object is instantiated in DCC_Library.cpp
+extern Accessory accCmd;         // To retrieve data from accessory commands
+
+// ADC clock = F_CPU / 256. A 10 bit conversion takes 13 ADC clocks plus the sample duration.
+#define ADC_CLOCK        (F_CPU / 256)
+#define ADC_SAMPDUR      2
+#define SAMPLES_PER_MS   (ADC_CLOCK / (13 + ADC_SAMPDUR + 2) / 1000)
+
+#define QUEUE_SIZE 8
+uint8_t queue[QUEUE_SIZE];                           // Coil numbers (0..7) that must be activated
+uint8_t queueHead;
+uint8_t queueTail;
+
+CoilDetector detector;
+volatile uint8_t activeCoil = 255;                   // 255: no coil active
+volatile uint8_t lastResult;                         // Result of the last pulse
+volatile uint16_t lastSamples;                       // Length of the last pulse, in samples
+
+#if defined(RECORD_PROFILE)
+#define PROFILE_SIZE 1024
+uint16_t profile[PROFILE_SIZE];
+#endif
+
+
+//******************************************************************************************************
+// ADC ISR: one call per sample, while a coil is active
+//******************************************************************************************************
+ISR(ADC0_RESRDY_vect) {
+  uint16_t value = ADC0.RES;                         // Reading RES clears the interrupt flag
+  #if defined(RECORD_PROFILE)
+  if (detector.samples < PROFILE_SIZE) profile[detector.samples] = value;
+  #endif
+  uint8_t result = detector.sample(value);
+  if (result != CoilDetector::busy) {
+    VPORTA.OUT &= ~(1 << activeCoil);                // End the pulse immediately (coils are PA0..PA7)
+    ADC0.CTRLA &= ~ADC_FREERUN_bm;                   // Stop sampling
+    ADC0.INTCTRL = 0;
+    lastResult = result;
+    lastSamples = detector.samples;
+    activeCoil = 255;
+  }
+}
+
+
+void initAdc(void) {
+  VREF.ADC0REF = VREF_REFSEL_2V048_gc;
+  ADC0.CTRLA = ADC_RESSEL_10BIT_gc;
+  ADC0.CTRLC = ADC_PRESC_DIV256_gc;
+  ADC0.SAMPCTRL = ADC_SAMPDUR;
+  ADC0.MUXPOS = currentMux;
+  ADC0.CTRLA |= ADC_ENABLE_bm;
+}
+
+
+void startPulse(uint8_t coil) {
+  detector.begin(blankMs * SAMPLES_PER_MS, maxPulseMs * SAMPLES_PER_MS, holdMs * SAMPLES_PER_MS);
+  activeCoil = coil;
+  digitalWrite(coilPin[coil], HIGH);
+  ADC0.INTFLAGS = ADC_RESRDY_bm;
+  ADC0.INTCTRL = ADC_RESRDY_bm;
+  ADC0.CTRLA |= ADC_FREERUN_bm;
+  ADC0.COMMAND = ADC_STCONV_bm;
+}
+
+
+#if defined(RECORD_PROFILE)
+void printProfile(void) {
+  // Output can be stored as a file and given to coil_profile_replay
+  Serial.print("# samples per ms: ");
+  Serial.println(SAMPLES_PER_MS);
+  uint16_t n = lastSamples;
+  if (n > PROFILE_SIZE) n = PROFILE_SIZE;
+  for (uint16_t i = 0; i < n; i++) Serial.println(profile[i]);
+  Serial.println("# end");
+}
+#endif
+
+
+//******************************************************************************************************
+void setup() {
+  Serial.begin(115200);
+  for (uint8_t i = 0; i < 8; i++) pinMode(coilPin[i], OUTPUT);
+  pinMode(currentPin, INPUT);
+  initAdc();
+  dcc.attach(dccPin);
+  accCmd.myMaster = OpenDCC;
+  accCmd.setMyAddress(myDecoderAddress);
+}
+
+
+void loop() {
+  // Step 1: queue new commands. Device is 1..8: two coils per turnout
+  if (dcc.input()) {
+    if ((dcc.cmdType == Dcc::MyAccessoryCmd) && (accCmd.command == Accessory::basic) && accCmd.activate) {
+      uint8_t next = (queueHead + 1) % QUEUE_SIZE;
+      if (next != queueTail) {                       // If the queue is full, the command is dropped
+        queue[queueHead] = accCmd.device - 1;
+        queueHead = next;
+      }
+    }
+  }
+  // Step 2: start the next pulse as soon as the previous has ended
+  if ((activeCoil == 255) && (queueHead != queueTail)) {
+    if (lastSamples) {
+      Serial.print("Pulse ended after ");
+      Serial.print(lastSamples / SAMPLES_PER_MS);
+      if (lastResult == CoilDetector::completed) Serial.println(" ms (completed)");
+        else Serial.println(" ms (timeout)");
+      #if defined(RECORD_PROFILE)
+      printProfile();
+      #endif
+      lastSamples = 0;
+    }
+    startPulse(queue[queueTail]);
+    queueTail = (queueTail + 1) % QUEUE_SIZE;
+  }
+}
@@ -0,0 +1,102 @@
+//******************************************************************************************************
+//
+// file:      CoilDetector.h
+// purpose:   Detects the moment a solenoid (coil) has switched, from its current profile
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0 ap initial version
+//
+// If a coil is switched on, the current rises (limited by the coil's inductance). As soon as the
+// armature starts to move, the back-EMF of the moving armature gives a dip in the current. Once the
+// armature reaches its end stop, the movement (and thus the back-EMF) stops and the current rises
+// again. The minimum of the dip therefore marks the moment the switch has completed.
+//
+//   current
+//      |            peak
+//      |          .'''.                   ..'''''''''  <- saturation (fixed length pulse)
+//      |        .'     '.             ..''
+//      |      .'         '.   dip  ..'
+//      |    .'             '.....''    <- rises again: armature has stopped => end the pulse
+//      |  .'
+//      +-------------------------------------------------> time
+//
+// The detector works on (ADC) samples that arrive at a fixed rate, and only uses additions, shifts
+// and comparisons, so it can be called from the ADC ISR:
+// - The samples are smoothed by a first order filter (alpha = 1/4), in fixed point (x4).
+// - During the first "blank" samples no dip is accepted (switch on transients).
+// - A dip is detected if the current drops more than peak / 2^dipShift below the peak.
+// - Completion is detected if the current rises again by half that amount above the minimum.
+// - After completion, the coil stays on for "hold" samples, to ensure the armature latches.
+// - If no completion is detected within "max" samples, the pulse ends anyway (fallback).
+//
+// This file has no dependencies on Arduino, so it can also be used on a PC to validate the detector
+// against recorded current profiles (see extras/Host_Simulation/coil_profile_replay.cpp).
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#pragma once
+#include <stdint.h>
+
+
+class CoilDetector {
+  public:
+    typedef enum {
+      busy,                              // The pulse should continue
+      completed,                         // The armature has switched (and the hold time has passed)
+      timeout                            // Maximum pulse time reached, without detected completion
+    } Result_t;
+
+    void begin(uint16_t blank, uint16_t max, uint16_t hold, uint8_t dipShift = 3) {
+      _blank = blank;
+      _max = max;
+      _hold = hold;
+      _dipShift = dipShift;
+      _filtered = 0;
+      _peak = 0;
+      _valley = 0;
+      _state = rising;
+      samples = 0;
+      completedAt = 0;
+    }
+
+    Result_t sample(uint16_t value) {
+      samples++;
+      _filtered += value - (_filtered >> 2);             // _filtered is 4 x the average
+      if (samples >= _max) return timeout;
+      switch (_state) {
+        case rising:
+          if (_filtered > _peak) _peak = _filtered;
+          else if ((samples > _blank) && (_filtered < _peak - (_peak >> _dipShift))) {
+            _valley = _filtered;
+            _state = dip;
+          }
+        break;
+        case dip:
+          if (_filtered < _valley) _valley = _filtered;
+          else if (_filtered > _valley + (_peak >> (_dipShift + 1))) {
+            completedAt = samples;
+            _state = holding;
+          }
+        break;
+        case holding:
+          if (samples - completedAt >= _hold) return completed;
+        break;
+      }
+      return busy;
+    }
+
+    uint16_t samples;                    // Number of samples since begin()
+    uint16_t completedAt;                // Sample at which the end of the dip was detected (0 = not)
+
+  private:
+    typedef enum {rising, dip, holding} State_t;
+    State_t _state;
+    uint16_t _filtered;                  // 4 x the average; fits for ADC values upto 12 bits
+    uint16_t _peak;
+    uint16_t _valley;
+    uint16_t _blank;
+    uint16_t _max;
+    uint16_t _hold;
+    uint8_t _dipShift;
+};
@@ -0,0 +1,183 @@
+//******************************************************************************************************
+//
+//                  Turntable / stepper motion controller driven by accessory commands
+//
+// purpose:   This sketch shows how a stepper motor (turntable, traverser, ...) can be moved to
+//            positions that are selected by accessory commands, without blocking dcc.input().
+//            Step pulses are generated by hardware (TCA0 compare) and the acceleration and
+//            deceleration follow a trapezoidal profile, that is precomputed in setup().
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0 ap initial version
+//            2026-10-19 V1.1 ap Planner in StepPlanner.h; no overshoot on even distances; the
+//                               ramp table is sized to reach maxStepRate
+//
+// usage:     This sketch should declare the following objects:
+//            - extern Dcc           dcc;     // The main DCC object
+//            - extern Accessory     accCmd;  // To retrieve the data from accessory commands
+//
+//            Each turntable track has its own output address. A basic accessory command for
+//            output address (firstOutput + n) moves the turntable to track n. Alternatively an
+//            extended accessory command for firstOutput may be used, where signalHead is the track.
+//            A new command may arrive while the turntable is moving. In that case the motion is
+//            re-planned: if the new track lies in the same direction, the turntable continues (and
+//            decelerates in time); otherwise it decelerates to standstill and then reverses.
+//
+// howto:     TCA0 runs in single slope PWM mode. Each timer period gives exactly one step pulse on
+//            WO0, with a pulse width of CMP0 ticks. Thus the pulse width is timed by hardware, and
+//            only a single (short) ISR per step is needed. The overflow ISR counts the position and
+//            loads the period for the next step (PERBUF), that StepPlanner.h takes from the ramp
+//            table. Re-planning is done by the ISR as well: it compares the steps left with the steps
+//            needed to decelerate (which equals the current ramp index). The ISR does not use any
+//            division or floating point; all such calculations are done in setup().
+//            With a prescaler of 8 at 24 Mhz a tick is 1/3 us, so step rates up to several tens of
+//            kHz are possible. The DCC ISR should have level 1 priority, so it can interrupt the step
+//            ISR: uncomment DCC_ISR_LEVEL1 in sup_isr_MegaCoreX_DxCore.h.
+//            The ramp table needs maxStepRate^2 / (2 * acceleration) entries of 2 bytes. With the
+//            values below these are 1002 entries (2 KB of RAM): 20 kHz is reached after 1000 steps,
+//            thus after 0.1 s. If the table would not fit, lower maxStepRate or raise acceleration.
+//            Should the table nevertheless be too small, setup() prints the step rate that is
+//            reached on Serial. See extras/Host_Simulation/turntable_planner.cpp for a replay of
+//            the planner on a PC.
+//
+// hardware:  - ATmega 4808/4809 (MegaCoreX) or AVR DA / DB (DxCore)
+//            - TCB0 for DCC, TCA0 for the step pulses (thus no analogWrite() on TCA0 pins)
+//            - Step output: WO0 of TCA0 (PA0 with the default PORTMUX setting)
+//            - Direction and enable outputs on free pins
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#include <Arduino.h>
+#include <AP_DCC_library.h>
+#include "StepPlanner.h"
+
+const uint8_t dccPin = PIN_PD0;
+const uint8_t stepPin = PIN_PA0;                     // TCA0 WO0
+const uint8_t dirPin = PIN_PA1;
+const uint8_t enablePin = PIN_PA2;                   // Low = driver enabled
+
+const unsigned int firstOutput = 201;                // Output address for track 0
+const uint8_t numberOfTracks = 8;
+const int32_t trackPosition[numberOfTracks] = {      // Position of each track, in steps
+  0, 1600, 3200, 4800, 6400, 8000, 9600, 11200
+};
+
+constexpr float maxStepRate = 20000.0;               // Steps per second
+constexpr float minStepRate = 200.0;                 // Start / stop rate
+constexpr float acceleration = 200000.0;             // Steps per second^2
+constexpr float pulseWidthUs = 2.0;                  // Required by most stepper drivers
+
+//******************************************************************************************************
+//                                  No need to edit below
+//******************************************************************************************************
+extern Dcc dcc;                  // This object is instantiated in DCC_Library.cpp
+extern Accessory accCmd;         // To retrieve data from accessory commands
+
+#define TICKS_PER_SECOND (F_CPU / 8)                 // TCA0 prescaler is 8
+#define RAMP_SIZE ((uint16_t)(maxStepRate * maxStepRate / (2 * acceleration)) + 2)
+
+uint16_t ramp[RAMP_SIZE];                            // Period (in ticks) for each step of the ramp
+StepPlanner planner;                                 // Only accessed with interrupts disabled
+volatile bool lastStep;                              // The next period contains no pulse
+uint16_t pulseTicks;                                 // Width of the step pulse
+
+
+//******************************************************************************************************
+// The step ISR: one call per step
+//******************************************************************************************************
+// In single slope mode WO0 goes high at BOTTOM, thus each overflow starts a new step pulse. At that
+// moment the decision about the NEXT period must be taken: its length (PERBUF) and, if the target is
+// reached, that it should not contain a pulse (CMP0BUF = 0 gives a static low output). The timer
+// period is PER + 1 ticks.
+void nextStep(void) {
+  StepPlanner::Result_t result = planner.next();
+  if (result == StepPlanner::arrived) {              // Target reached: no pulse in the next period
+    TCA0.SINGLE.CMP0BUF = 0;
+    lastStep = true;
+    return;
+  }
+  if (result == StepPlanner::reverse) digitalWriteFast(dirPin, (planner.direction > 0) ? HIGH : LOW);
+  TCA0.SINGLE.PERBUF = planner.period() - 1;
+}
+
+
+void startMotion(void) {
+  // Called with interrupts disabled, from standstill
+  if (!planner.start()) return;
+  digitalWriteFast(dirPin, (planner.direction > 0) ? HIGH : LOW);
+  lastStep = false;
+  TCA0.SINGLE.CNT = 0;
+  TCA0.SINGLE.PER = planner.period() - 1;
+  TCA0.SINGLE.CMP0 = pulseTicks;
+  TCA0.SINGLE.CTRLB = TCA_SINGLE_WGMODE_SINGLESLOPE_gc | TCA_SINGLE_CMP0EN_bm;
+  nextStep();                                        // The first pulse starts once the timer runs
+  TCA0.SINGLE.CTRLA = TCA_SINGLE_CLKSEL_DIV8_gc | TCA_SINGLE_ENABLE_bm;
+}
+
+
+ISR(TCA0_OVF_vect) {
+  TCA0.SINGLE.INTFLAGS = TCA_SINGLE_OVF_bm;
+  if (lastStep) {                                    // The period without pulse has ended
+    TCA0.SINGLE.CTRLA = 0;                           // Stop the timer
+    planner.direction = 0;
+    startMotion();                                   // In case a new target arrived meanwhile
+    return;
+  }
+  nextStep();
+}
+
+
+void moveTo(int32_t newTarget) {
+  noInterrupts();
+  planner.target = newTarget;                        // The ISR re-plans with the new target
+  if (planner.direction == 0) startMotion();
+  interrupts();
+}
+
+
+void initStepTimer(void) {
+  #if defined(DXCORE)
+  takeOverTCA0();                                    // Tell DxCore we use TCA0 ourselves
+  #endif
+  TCA0.SINGLE.CTRLA = 0;
+  TCA0.SINGLE.CTRLESET = TCA_SINGLE_CMD_RESET_gc;
+  TCA0.SINGLE.CTRLD = 0;                             // Normal (not split) mode
+  pulseTicks = (uint16_t)(pulseWidthUs * TICKS_PER_SECOND / 1000000.0 + 1);
+  TCA0.SINGLE.INTCTRL = TCA_SINGLE_OVF_bm;
+  pinMode(stepPin, OUTPUT);
+}
+
+
+//******************************************************************************************************
+void setup() {
+  pinMode(dirPin, OUTPUT);
+  pinMode(enablePin, OUTPUT);
+  digitalWrite(enablePin, LOW);
+  // begin() assumes we start at track 0 (position 0)
+  if (!planner.begin(ramp, RAMP_SIZE, TICKS_PER_SECOND, minStepRate, maxStepRate, acceleration)) {
+    Serial.begin(115200);
+    Serial.print(F("Ramp table too small, maximum step rate: "));
+    Serial.println(TICKS_PER_SECOND / ramp[RAMP_SIZE - 1]);
+  }
+  initStepTimer();
+  dcc.attach(dccPin);
+  accCmd.myMaster = OpenDCC;
+  // One decoder address covers 4 outputs. Listen to all decoder addresses that contain our outputs
+  accCmd.setMyAddress((firstOutput - 1) / 4, (firstOutput + numberOfTracks - 2) / 4);
+}
+
+
+void loop() {
+  if (dcc.input()) {
+    if (dcc.cmdType == Dcc::MyAccessoryCmd) {
+      int track = -1;
+      if (accCmd.command == Accessory::basic) {
+        if (accCmd.activate && (accCmd.outputAddress >= firstOutput))
+          track = accCmd.outputAddress - firstOutput;
+      }
+      else if (accCmd.outputAddress == firstOutput) track = accCmd.signalHead;
+      if ((track >= 0) && (track < numberOfTracks)) moveTo(trackPosition[track]);
+    }
+  }
+}
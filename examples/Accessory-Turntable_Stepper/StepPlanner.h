@@ -0,0 +1,102 @@
+//******************************************************************************************************
+//
+// file:      StepPlanner.h
+// purpose:   Plans the trapezoidal motion of a stepper motor, one step at a time
+// author:    Aiko Pras
+// version:   2026-10-19 V1.0 ap initial version (taken out of Accessory-Turntable_Stepper.ino)
+//
+// The period between two steps is taken from a ramp table, that is computed once by begin(). With
+// constant acceleration a, step n (from standstill) occurs at time sqrt(2n/a). The period between
+// step n and n+1 is therefore sqrt(2(n+1)/a) - sqrt(2n/a). The first steps use at most the period
+// of minRate, the table ends once the period of maxRate is reached. Full speed is thus reached
+// after maxRate^2 / (2a) steps; the table should have (at least) that many entries, plus two.
+//
+// next() is called once per step, and decides the period until the next step. The ramp index is
+// the number of steps that are needed to decelerate to standstill. Let d be the steps left minus
+// the ramp index. Accelerating lowers d by 2, holding speed by 1 and decelerating leaves d as it is.
+// To stop exactly at the target, deceleration must start with d = 0. Therefore the planner only
+// accelerates if d is at least 2; with d = 1 it holds speed for one step. If the target changes
+// during the motion (re-planning), d may become negative: the planner decelerates, passes the
+// target, and reverses once it is slow enough.
+//
+// next() only uses additions and comparisons, so it can be called from the step ISR. This file
+// has no dependencies on Arduino, so the planner can also be replayed on a PC (see
+// extras/Host_Simulation/turntable_planner.cpp).
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#pragma once
+#include <stdint.h>
+#include <math.h>
+
+
+class StepPlanner {
+  public:
+    typedef enum {
+      step,                              // Make the next step, after period() ticks
+      reverse,                           // Change direction first, then the same as step
+      arrived                            // Target reached: no next step
+    } Result_t;
+
+    // Computes the ramp table. Returns false if the table is too small to reach maxRate
+    bool begin(uint16_t *ramp, uint16_t size, float ticksPerSecond, float minRate, float maxRate,
+               float acceleration) {
+      _ramp = ramp;
+      float minPeriod = ticksPerSecond / maxRate;
+      float maxPeriod = ticksPerSecond / minRate;
+      if (maxPeriod > 65535) maxPeriod = 65535;
+      float period = maxPeriod;
+      rampLength = 0;
+      while ((rampLength < size) && (period > minPeriod)) {
+        float n = rampLength;
+        period = (sqrt(2.0 * (n + 1) / acceleration) - sqrt(2.0 * n / acceleration)) * ticksPerSecond;
+        if (period > maxPeriod) period = maxPeriod;
+        if (period < minPeriod) period = minPeriod;
+        _ramp[rampLength++] = (uint16_t) period;
+      }
+      position = 0;
+      target = 0;
+      direction = 0;
+      rampIndex = 0;
+      return (period <= minPeriod);
+    }
+
+    // Starts a motion from standstill. Returns false if the target is already reached
+    bool start(void) {
+      int32_t distance = target - position;
+      if (distance == 0) return false;
+      direction = (distance > 0) ? 1 : -1;
+      rampIndex = 0;
+      return true;
+    }
+
+    // Called at each step. The step has already started, thus the position is updated first
+    Result_t next(void) {
+      position += direction;
+      int32_t remaining = (target - position) * direction;   // Steps left in the current direction
+      if (remaining <= 0) {                                  // At, or beyond, the (new) target
+        if (rampIndex == 0) {                                // Slow enough to stop or reverse
+          if (remaining == 0) return arrived;                // Caller sets direction to 0
+          direction = -direction;                            // Target is behind us
+          return reverse;
+        }
+        rampIndex--;                                         // Decelerate first
+      }
+      else if (remaining <= rampIndex) rampIndex--;          // Decelerate in time (d <= 0)
+      else if ((remaining > (int32_t) rampIndex + 1) && (rampIndex < rampLength - 1)) rampIndex++;
+      return step;                                           // Otherwise hold speed
+    }
+
+    uint16_t period(void) { return _ramp[rampIndex]; }      // Ticks until the next step
+
+    int32_t position;                    // Current position (steps)
+    int32_t target;                      // Requested position (steps)
+    int8_t direction;                    // +1, -1 or 0 (standstill)
+    uint16_t rampIndex;                  // Current entry of the ramp table
+    uint16_t rampLength;                 // Number of entries used
+
+  private:
+    uint16_t *_ramp;
+};
@@ -0,0 +1,105 @@
+//******************************************************************************************************
+//
+//                       Handling CV Access Commands with a CV schema
+//
+// purpose:   This sketch shows how the CVs of a decoder can be declared once, after which CV access
+//            commands (SM and PoM) are validated and executed by the schema (see sup_cv_schema.h)
+//            Results are displayed on the serial monitor
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0 ap initial version
+//            2026-10-18 V1.1 ap Bit fields of CV29 are declared in the schema
+//
+// usage:     This sketch should declare the following objects:
+//            - extern Dcc           dcc;      // The main DCC object
+//            - extern Loco          locoCmd;  // To set the Loco address (for PoM)
+//            - extern CvAccess      cvCmd;    // To retrieve the data from pom and sm commands
+//            Note the 'extern' keyword, since these objects are instantiated in DCC_Library.cpp
+//
+// hardware:  - Timer 2 or TCB0 is used
+//            - a free to chose interrupt pin (dccpin) for the DCC input signal
+//            - a free to chose digital output pin for the DCC-ACK signal
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#include <Arduino.h>
+#include <AP_DCC_library.h>
+
+const uint8_t dccPin = 3;        // Pin 3 on the UNO, Nano etc. is INT1
+const uint8_t ackPin = 7;        // On the UNO, Nano etc. we use Digital Pin 7
+
+extern Dcc dcc;                  // This object is instantiated in DCC_Library.cpp
+extern Loco locoCmd;             // To retrieve the data from loco commands  (7 & 14 bit)
+extern CvAccess cvCmd;           // To retrieve the data from pom and sm commands
+
+// The CVs of this decoder, sorted by CV number. The compiler checks the table
+constexpr CvDef myCvDefs[] PROGMEM = {
+// number default  min    max    flags
+  {1,     3,       1,     127,   0},                 // Primary address
+  {7,     10,      0,     255,   CV_READ_ONLY},      // Version
+  {8,     13,      0,     255,   CV_READ_ONLY},      // Manufacturer (13 = DIY)
+  {17,    0xD3,    0xC0,  0xE7,  0},                 // Long address, high byte (5000)
+  {18,    0x88,    0,     255,   0},                 // Long address, low byte
+  {29,    0b100010, 0,    255,   0},                 // Configuration: long address, 28/128 steps
+  {33,    25,      5,     100,   0}                  // Pulse time, in steps of 10 ms
+};
+
+// The bit fields within CVs. A field is identified by its index in this table
+enum {Direction, SpeedSteps, LongAddress};
+constexpr CvField myCvFields[] PROGMEM = {
+// number shift  width  max
+  {29,    0,     1,     1},                          // Direction: reversed
+  {29,    1,     1,     1},                          // SpeedSteps: 28/128
+  {29,    5,     1,     1}                           // LongAddress: CV17/18 instead of CV1
+};
+CvSchema<myCvDefs, sizeof(myCvDefs) / sizeof(CvDef),
+         myCvFields, sizeof(myCvFields) / sizeof(CvField)> cvs;
+
+const char *resultText[] = {"CV not supported", "Read only", "Out of range",
+                            "Verify failed", "Verified", "Written"};
+
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  Serial.println("Test DCC lib - CV schema");
+  dcc.attach(dccPin, ackPin);
+  if (cvs.field<LongAddress>()) locoCmd.setMyAddress(cvs.word<17, 18>() & 0x3FFF);
+  else locoCmd.setMyAddress(cvs.get<1>());
+}
+
+
+void cv_operation(bool serviceMode) {
+  Serial.print("CV");
+  Serial.print(cvCmd.number);
+  Serial.print(": ");
+  CvResult_t result = cvs.apply(cvCmd);
+  Serial.print(resultText[result]);
+  Serial.print(", value = ");
+  Serial.println(cvs.read(cvCmd.number));
+  // In SM we send back a DCC-ACK signal, in PoM mode a railcom reply (not implemented)
+  if (serviceMode && ((result == CvVerified) || (result == CvWritten))) dcc.sendAck();
+  if (result == CvWritten) {
+    Serial.print("Pulse time is now (ms): ");
+    Serial.println(cvs.get<33>() * 10);
+  }
+}
+
+
+void loop() {
+  if (dcc.input()) {
+    switch (dcc.cmdType) {
+      case Dcc::MyPomCmd :
+        cv_operation(false);
+      break;
+
+      case Dcc::SmCmd :
+        cv_operation(true);
+      break;
+
+      default:
+      break;
+    }
+  }
+}
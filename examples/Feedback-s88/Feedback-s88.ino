@@ -0,0 +1,79 @@
+//******************************************************************************************************
+//
+//                      Switch decoder that is also an s88-N feedback module
+//
+// purpose:   This sketch shows how a decoder can report its state via the s88-N feedback bus.
+//            Inputs 1..8 report the position of the four switches (two inputs per switch); if
+//            VOLTAGE_DETECTION is also defined, inputs 9..16 report the occupancy of eight blocks.
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0 ap initial version
+//
+// usage:     "S88_SLAVE" must be uncommented in AP_DCC_library.h
+//            This sketch should declare the following objects:
+//            - extern Dcc           dcc;     // The main DCC object
+//            - extern Accessory     accCmd;  // To retrieve the data from accessory commands
+//            - extern S88Slave      s88;     // The s88-N feedback interface
+//            Note the 'extern' keyword, since these objects are instantiated in DCC_Library.cpp
+//
+// hardware:  - MegaCoreX or DxCore processor. TCB0 is used for DCC, SPI0 for s88-N
+//            - s88 CLOCK to SCK, LOAD (PS) to SS, DATA IN to MOSI, DATA OUT to MISO (with pull-down)
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#include <Arduino.h>
+#include <AP_DCC_library.h>
+
+#if !defined(S88_SLAVE)
+#error "Uncomment S88_SLAVE in AP_DCC_library.h"
+#endif
+
+const uint8_t dccPin = PIN_PD0;
+const uint8_t myDecoderAddress = 24;                 // Switches 97..100 (OpenDCC / RCN-213)
+
+extern Dcc dcc;                  // This object is instantiated in DCC_Library.cpp
+extern Accessory accCmd;         // To retrieve data from accessory commands
+extern S88Slave s88;             // s88-N feedback interface
+
+#if defined(VOLTAGE_DETECTION)
+const uint8_t channels[8] = {0, 1, 2, 3, 4, 5, 6, 7}; // ADC channel (AINn) per block
+extern Occupancy occupancyCmd;
+#endif
+
+
+void setup() {
+  dcc.attach(dccPin);
+  accCmd.myMaster = OpenDCC;
+  accCmd.setMyAddress(myDecoderAddress);
+  s88.attach(2);                                     // 16 inputs
+  #if defined(VOLTAGE_DETECTION)
+  occupancyCmd.setReleaseDelay(500);
+  occupancyCmd.attach(channels, 8);
+  #endif
+}
+
+
+void loop() {
+  if (dcc.input()) {
+    switch (dcc.cmdType) {
+      case Dcc::MyAccessoryCmd :
+        if (accCmd.command == Accessory::basic) {
+          // Input 2n-1: switch n is curved; input 2n: switch n is straight
+          uint8_t input = (accCmd.turnout - 1) * 2 + 1;
+          s88.setInput(input, accCmd.position == 0);
+          s88.setInput(input + 1, accCmd.position == 1);
+        }
+      break;
+
+      #if defined(VOLTAGE_DETECTION)
+      case Dcc::OccupancyCmd :
+        s88.setInput(9 + occupancyCmd.block, occupancyCmd.occupied);
+      break;
+      #endif
+
+      default:
+      break;
+    }
+  }
+}
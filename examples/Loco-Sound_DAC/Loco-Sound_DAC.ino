@@ -0,0 +1,298 @@
+//******************************************************************************************************
+//
+//                  Sound playback from SPI flash via the DAC, next to the AP_DCC_library
+//
+// purpose:   This sketch shows how a sound decoder can be built on an AVR DA / DB processor, without
+//            disturbing the reception of DCC packets. Sound samples (8 bit, unsigned, 16 kHz) are
+//            streamed from an SPI flash chip into double buffers, two channels are mixed in fixed
+//            point and the result is written to the DAC.
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0 ap initial version
+//
+// usage:     This sketch should declare the following objects:
+//            - extern Dcc           dcc;      // The main DCC object
+//            - extern Loco          locoCmd;  // To retrieve the data from Loco commands
+//
+//            The sound that is played is selected by a state machine, which only reacts on changes
+//            of the speed step and function bits (MyLocoSpeedCmd, MyLocoF0F4Cmd). Retransmissions
+//            are already filtered by the library, so the state machine runs only if something changes.
+//            - Channel 0 (engine): idle, or one of three running sounds, depending on the speed step.
+//            - Channel 1 (effects): horn (F1, played once) and bell (F2, repeated while F2 is on).
+//
+// timing:    Three things run concurrently:
+//            1. The DCC ISR (TCB0). In sup_isr_MegaCoreX_DxCore.h DCC_ISR_LEVEL1 MUST be uncommented,
+//               which gives the DCC ISR level 1 priority. It can then interrupt the sample ISR.
+//            2. The sample ISR (TCB1, level 0, 16 kHz). It only mixes two samples from RAM and writes
+//               the DAC. If one half of a buffer is empty, it is handed over to loop().
+//            3. loop(): calls dcc.input() and refills empty buffer halves from the SPI flash.
+//               SPI bytes at 12 Mhz take less time than an interrupt entry and exit, so polled block
+//               transfers of 64 bytes are used instead of an interrupt per byte. A buffer half lasts
+//               4 ms, so loop() may be blocked by other code for almost 4 ms without audible effects.
+//
+//            The combined ISR budget is measured while running: at the end of the sample ISR, TCB1.CNT
+//            holds the number of clock ticks since the start of the sample period. This includes the
+//            time the sample ISR has been delayed by (and thus the load of) the DCC ISR. The maximum
+//            is printed every 5 seconds, together with the number of DCC packets with XOR errors.
+//            With a lossless DCC path, errorXOR remains 0 if the same sketch runs without sound.
+//            If MEASURE_PIN is defined, the pin is high while the sample ISR runs (for a scope).
+//
+// hardware:  - AVR DA / DB, DxCore board, 24 Mhz
+//            - TCB0 for DCC, TCB1 for the sample rate
+//            - DAC0 output on PD6
+//            - SPI flash (W25Qxx or similar) on the default SPI pins, chip select on flashCsPin
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#include <Arduino.h>
+#include <SPI.h>
+#include <AP_DCC_library.h>
+
+#define LocoAddress 3
+const uint8_t dccPin = PIN_PD0;
+const uint8_t flashCsPin = PIN_PA7;
+// #define MEASURE_PIN PIN_PC0
+
+// Location of the sounds within the SPI flash. Each sound is 8 bit unsigned PCM at 16 kHz.
+// The addresses depend on how the flash has been programmed.
+typedef struct {
+  uint32_t start;                                    // Byte address within the flash
+  uint32_t length;                                   // Number of samples
+  bool repeat;                                       // Repeat the sound until another is selected
+} Sound_t;
+
+const Sound_t sounds[] PROGMEM = {
+  {0x000000,  32000, true},                          // 0: Engine idle
+  {0x010000,  32000, true},                          // 1: Engine running, slow
+  {0x020000,  32000, true},                          // 2: Engine running, medium
+  {0x030000,  32000, true},                          // 3: Engine running, fast
+  {0x040000,  24000, false},                         // 4: Horn
+  {0x050000,  16000, true},                          // 5: Bell
+};
+const uint8_t NO_SOUND = 255;
+
+//******************************************************************************************************
+//                                  No need to edit below
+//******************************************************************************************************
+extern Dcc dcc;                  // This object is instantiated in DCC_Library.cpp
+extern Loco locoCmd;             // To retrieve the data from loco commands  (7 & 14 bit)
+
+#define SAMPLE_RATE 16000
+#define HALF_SIZE   64                               // Samples per buffer half (4 ms)
+#define CHANNELS    2
+
+struct Channel {
+  uint8_t buffer[2][HALF_SIZE];                      // Double buffer
+  volatile uint8_t playing;                          // Half that the ISR plays from (0 or 1)
+  volatile uint8_t index;                            // Next sample within that half
+  volatile uint8_t empty;                            // Bit mask of halves that must be refilled
+  volatile uint8_t volume;                           // 0..255, fixed point (256 = 1.0)
+  uint8_t sound;                                     // Sound being played, or NO_SOUND
+  uint8_t next;                                      // Sound to start once the current one wraps
+  uint32_t position;                                 // Next sample to read from the flash
+};
+Channel channel[CHANNELS];
+
+volatile uint16_t isrMaxTicks;                       // Measured: worst case end of the sample ISR
+unsigned long reportTime;
+
+
+//******************************************************************************************************
+// The sample ISR. Level 0, so the DCC ISR may interrupt it.
+//******************************************************************************************************
+ISR(TCB1_INT_vect) {
+  #if defined(MEASURE_PIN)
+  digitalWriteFast(MEASURE_PIN, HIGH);
+  #endif
+  TCB1.INTFLAGS = TCB_CAPT_bm;
+  int16_t mix = 0;
+  for (uint8_t c = 0; c < CHANNELS; c++) {
+    Channel &ch = channel[c];
+    if (ch.empty & (1 << ch.playing)) continue;      // Nothing to play (buffer underrun or silence)
+    int16_t sample = (int16_t) ch.buffer[ch.playing][ch.index] - 128;
+    mix += (sample * ch.volume) >> 8;
+    if (++ch.index == HALF_SIZE) {                   // This half is played; hand it to loop()
+      ch.index = 0;
+      ch.empty |= (1 << ch.playing);
+      ch.playing ^= 1;
+    }
+  }
+  if (mix > 127) mix = 127;
+  if (mix < -128) mix = -128;
+  DAC0.DATA = (uint16_t)(mix + 128) << 8;            // 10 bit DAC, left adjusted
+  uint16_t ticks = TCB1.CNT;
+  if (ticks > isrMaxTicks) isrMaxTicks = ticks;
+  #if defined(MEASURE_PIN)
+  digitalWriteFast(MEASURE_PIN, LOW);
+  #endif
+}
+
+
+void initSampleTimer(void) {
+  TCB1.CTRLA = 0;
+  TCB1.CTRLB = TCB_CNTMODE_INT_gc;                   // Periodic interrupt
+  TCB1.CCMP = (F_CPU / SAMPLE_RATE) - 1;
+  TCB1.CNT = 0;
+  TCB1.INTCTRL = TCB_CAPT_bm;
+  TCB1.CTRLA = TCB_ENABLE_bm;                        // CLK_PER, no prescaler
+}
+
+
+void initDac(void) {
+  VREF.DAC0REF = VREF_REFSEL_VDD_gc;
+  DAC0.CTRLA = DAC_ENABLE_bm | DAC_OUTEN_bm;
+  DAC0.DATA = 0x8000;                                // Mid level: silence
+}
+
+
+//******************************************************************************************************
+// Reading from the SPI flash (foreground)
+//******************************************************************************************************
+void flashRead(uint32_t address, uint8_t *data, uint8_t size) {
+  SPI.beginTransaction(SPISettings(12000000, MSBFIRST, SPI_MODE0));
+  digitalWrite(flashCsPin, LOW);
+  SPI.transfer(0x03);                                // Read Data command
+  SPI.transfer((uint8_t)(address >> 16));
+  SPI.transfer((uint8_t)(address >> 8));
+  SPI.transfer((uint8_t)(address));
+  memset(data, 0x80, size);                          // Silence, which is also clocked out
+  SPI.transfer(data, size);
+  digitalWrite(flashCsPin, HIGH);
+  SPI.endTransaction();
+}
+
+
+void fillHalf(Channel &ch, uint8_t half) {
+  uint8_t *data = ch.buffer[half];
+  uint8_t done = 0;
+  while (done < HALF_SIZE) {
+    if (ch.sound == NO_SOUND) {                      // Silence for the remaining part
+      memset(data + done, 0x80, HALF_SIZE - done);
+      return;
+    }
+    uint32_t start = pgm_read_dword(&sounds[ch.sound].start);
+    uint32_t length = pgm_read_dword(&sounds[ch.sound].length);
+    uint32_t left = length - ch.position;
+    uint8_t size = HALF_SIZE - done;
+    if (left < size) size = left;
+    flashRead(start + ch.position, data + done, size);
+    done += size;
+    ch.position += size;
+    if (ch.position >= length) {                     // End of the sound: switch or repeat
+      ch.position = 0;
+      if (ch.next != ch.sound) ch.sound = ch.next;
+      else if (!pgm_read_byte(&sounds[ch.sound].repeat)) ch.sound = ch.next = NO_SOUND;
+    }
+  }
+}
+
+
+void refillBuffers(void) {
+  for (uint8_t c = 0; c < CHANNELS; c++) {
+    Channel &ch = channel[c];
+    uint8_t empty = ch.empty;                        // Single byte: read atomically
+    if ((empty == 0) || (empty == 0b11 && ch.sound == NO_SOUND)) continue;
+    for (uint8_t half = 0; half < 2; half++) {
+      if (empty & (1 << half)) {
+        fillHalf(ch, half);
+        noInterrupts();
+        ch.empty &= ~(1 << half);
+        interrupts();
+      }
+    }
+  }
+}
+
+
+//******************************************************************************************************
+// Sound selection: change driven state machine
+//******************************************************************************************************
+void select(uint8_t c, uint8_t sound, bool immediately) {
+  Channel &ch = channel[c];
+  if (ch.next == sound) return;
+  ch.next = sound;
+  if (immediately || (ch.sound == NO_SOUND)) {      // Start from the next empty half
+    ch.sound = sound;
+    ch.position = 0;
+  }
+  // Otherwise the engine sound changes once the current sound wraps, to avoid clicks
+}
+
+
+uint8_t engineSound(uint8_t speed) {
+  if (speed == 0) return 0;
+  if (speed < 40) return 1;
+  if (speed < 80) return 2;
+  return 3;
+}
+
+
+void onLocoCommand(Dcc::CmdType_t cmdType) {
+  static uint8_t oldF0F4 = 0;
+  switch (cmdType) {
+    case Dcc::MyLocoSpeedCmd:
+    case Dcc::MyEmergencyStopCmd:
+      select(0, engineSound(locoCmd.speed), false);
+    break;
+    case Dcc::MyLocoF0F4Cmd: {
+      uint8_t changed = locoCmd.F0F4 ^ oldF0F4;
+      oldF0F4 = locoCmd.F0F4;
+      if ((changed & 0b0001) && (locoCmd.F0F4 & 0b0001)) select(1, 4, true);   // F1: horn
+      if (changed & 0b0010) {                                                  // F2: bell
+        if (locoCmd.F0F4 & 0b0010) select(1, 5, true);
+        else channel[1].next = NO_SOUND;             // Stop after the current bell sound
+      }
+    }
+    break;
+    case Dcc::ResetCmd:
+      select(0, 0, false);
+      channel[1].next = NO_SOUND;
+    break;
+    default:
+    break;
+  }
+}
+
+
+//******************************************************************************************************
+void setup() {
+  Serial.begin(115200);
+  Serial.println("Sound decoder - DAC");
+  pinMode(flashCsPin, OUTPUT);
+  digitalWrite(flashCsPin, HIGH);
+  #if defined(MEASURE_PIN)
+  pinMode(MEASURE_PIN, OUTPUT);
+  #endif
+  SPI.begin();
+  for (uint8_t c = 0; c < CHANNELS; c++) {
+    channel[c].empty = 0b11;
+    channel[c].sound = NO_SOUND;
+    channel[c].next = NO_SOUND;
+    channel[c].volume = 128;
+  }
+  select(0, 0, true);                                // Engine idle
+  initDac();
+  initSampleTimer();
+  dcc.attach(dccPin);
+  locoCmd.setMyAddress(LocoAddress);
+}
+
+
+void loop() {
+  if (dcc.input()) onLocoCommand(dcc.cmdType);
+  refillBuffers();
+  if ((millis() - reportTime) > 5000) {
+    reportTime = millis();
+    noInterrupts();
+    uint16_t ticks = isrMaxTicks;
+    isrMaxTicks = 0;
+    interrupts();
+    Serial.print("Sample ISR worst case end (us): ");
+    Serial.print(ticks / (F_CPU / 1000000));
+    Serial.print(" of ");
+    Serial.print(1000000 / SAMPLE_RATE);
+    Serial.print(" - DCC XOR errors: ");
+    Serial.println(dcc.errorXOR);
+  }
+}
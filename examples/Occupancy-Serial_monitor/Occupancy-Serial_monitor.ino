@@ -0,0 +1,75 @@
+//******************************************************************************************************
+//
+//                       Testing the Occupancy Detection part of the AP_DCC_library
+//
+// purpose:   This sketch shows the state changes of upto 16 track blocks
+//            Results are displayed on the serial monitor
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0 ap initial version
+//
+// usage:     "VOLTAGE_DETECTION" must be uncommented in AP_DCC_library.h
+//            This sketch should declare the following objects:
+//            - extern Dcc           dcc;          // The main DCC object
+//            - extern Occupancy     occupancyCmd; // To retrieve the block that changed
+//            Note the 'extern' keyword, since these objects are instantiated in DCC_Library.cpp
+//
+//            Setup() should call dcc.attach(dccPin) and occupancyCmd.attach(channels, blocks).
+//            The main loop() should call dcc.input() as often as possible. If there is input,
+//            dcc.cmdType tells what kind of command was received. In this sketch we react on
+//            OccupancyCmd. Every second the filtered levels are printed, to help choosing the
+//            on and off levels.
+//
+// hardware:  - Timer 2 or TCB0 is used, as well as the ADC
+//            - a free to chose interrupt pin (dccpin) for the DCC input signal
+//            - per block a sense resistor (or diodes), connected to an ADC input
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#include <Arduino.h>
+#include <AP_DCC_library.h>
+
+#if !defined(VOLTAGE_DETECTION)
+#error "Uncomment VOLTAGE_DETECTION in AP_DCC_library.h"
+#endif
+
+const uint8_t dccPin = PIN_PD0;
+const uint8_t blocks = 8;
+const uint8_t channels[blocks] = {0, 1, 2, 3, 4, 5, 6, 7};   // ADC channel (AINn) per block
+
+extern Dcc dcc;                  // This object is instantiated in DCC_Library.cpp
+extern Occupancy occupancyCmd;   // To retrieve the block that changed
+
+unsigned long lastPrint;
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  Serial.println("Test DCC lib - Occupancy detection");
+  dcc.attach(dccPin);
+  occupancyCmd.setLevels(40, 20);
+  occupancyCmd.setReleaseDelay(500);
+  occupancyCmd.attach(channels, blocks);
+}
+
+
+void loop() {
+  if (dcc.input()) {
+    if (dcc.cmdType == Dcc::OccupancyCmd) {
+      Serial.print("Block ");
+      Serial.print(occupancyCmd.block);
+      if (occupancyCmd.occupied) Serial.println(" occupied");
+        else Serial.println(" free");
+    }
+  }
+  if (millis() - lastPrint >= 1000) {
+    lastPrint = millis();
+    Serial.print("Levels:");
+    for (uint8_t i = 0; i < blocks; i++) {
+      Serial.print(' ');
+      Serial.print(occupancyCmd.level(i));
+    }
+    Serial.println();
+  }
+}
@@ -0,0 +1,255 @@
+//******************************************************************************************************
+//
+// file:      Arduino.cpp
+// purpose:   Host (PC) replacement for the Arduino core, driven by a virtual clock
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//            2026-10-18 V1.0.1 ap Print and Serial (output to stdout)
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#include <stdio.h>
+#include "Arduino.h"
+
+VirtualTime sim;
+
+
+//******************************************************************************************************
+//                                         The virtual clock
+//******************************************************************************************************
+VirtualTime::VirtualTime() {
+  reset();
+}
+
+
+void VirtualTime::reset(void) {
+  _now = 0;
+  _numSources = 0;
+  edgeTime = 0;
+  interruptsEnabled = true;
+  interruptsDelayed = 0;
+  interruptsLost = 0;
+  pinObserver = 0;
+  for (uint8_t i = 0; i < SIM_MAX_PINS; i++) {
+    level[i] = LOW;
+    mode[i] = INPUT;
+    _irq[i].isr = 0;
+    _irq[i].pending = false;
+  }
+}
+
+
+void VirtualTime::addSource(SimEdgeSource *source) {
+  if (_numSources < 4) _sources[_numSources++] = source;
+}
+
+
+void VirtualTime::attach(uint8_t pin, void (*isr)(void), int irqMode) {
+  if (pin >= SIM_MAX_PINS) return;
+  _irq[pin].isr = isr;
+  _irq[pin].mode = irqMode;
+  _irq[pin].pending = false;
+}
+
+
+void VirtualTime::detach(uint8_t pin) {
+  if (pin >= SIM_MAX_PINS) return;
+  _irq[pin].isr = 0;
+  _irq[pin].pending = false;
+}
+
+
+void VirtualTime::edge(uint8_t pin, uint8_t newLevel) {
+  // Called for every level change. Determines if an interrupt should be triggered
+  if (_irq[pin].isr == 0) return;
+  int m = _irq[pin].mode;
+  if ((m == RISING) && (newLevel == LOW)) return;
+  if ((m == FALLING) && (newLevel == HIGH)) return;
+  if (_irq[pin].pending) {                       // The previous edge has not been served yet
+    interruptsLost++;
+    _irq[pin].edgeTime = _now;                   // Like a TCB, the capture is overwritten
+    return;
+  }
+  if (!interruptsEnabled) {
+    interruptsDelayed++;
+    _irq[pin].pending = true;
+    _irq[pin].edgeTime = _now;
+    return;
+  }
+  // Interrupts are enabled. An ISR runs with interrupts disabled
+  interruptsEnabled = false;
+  edgeTime = _now;
+  _irq[pin].isr();
+  interruptsEnabled = true;
+}
+
+
+void VirtualTime::setPin(uint8_t pin, uint8_t newLevel) {
+  if (pin >= SIM_MAX_PINS) return;
+  newLevel = newLevel ? HIGH : LOW;
+  if (level[pin] == newLevel) return;
+  level[pin] = newLevel;
+  if (pinObserver) pinObserver(pin, newLevel);
+  edge(pin, newLevel);
+}
+
+
+void VirtualTime::enableInterrupts(void) {
+  interruptsEnabled = true;
+  // Serve pending interrupts, with the lowest pin number first
+  for (uint8_t i = 0; i < SIM_MAX_PINS; i++) {
+    if (_irq[i].pending && _irq[i].isr) {
+      _irq[i].pending = false;
+      interruptsEnabled = false;
+      edgeTime = _irq[i].edgeTime;
+      _irq[i].isr();
+      interruptsEnabled = true;
+    }
+  }
+}
+
+
+void VirtualTime::advanceTo(uint64_t ticks) {
+  // Apply all edges from all sources in time order, until "ticks" is reached
+  while (true) {
+    uint64_t first = ticks;
+    int8_t which = -1;
+    for (uint8_t i = 0; i < _numSources; i++) {
+      uint64_t t;
+      if (_sources[i]->peek(t) && (t <= first)) {
+        if ((which < 0) || (t < first)) {
+          first = t;
+          which = i;
+        }
+      }
+    }
+    if (which < 0) break;
+    if (first > _now) _now = first;
+    uint8_t newLevel = _sources[which]->pop();
+    setPin(_sources[which]->pin, newLevel);
+  }
+  if (ticks > _now) _now = ticks;
+}
+
+
+void VirtualTime::advance(uint64_t us) {
+  advanceTo(_now + usToTicks(us));
+}
+
+
+void VirtualTime::run(void (*loop)(void), uint64_t durationUs, uint32_t loopCostUs) {
+  if (loopCostUs == 0) loopCostUs = 1;          // Time must always pass
+  uint64_t end = _now + usToTicks(durationUs);
+  while (_now < end) {
+    loop();
+    advance(loopCostUs);
+  }
+}
+
+
+//******************************************************************************************************
+//                                      The Arduino functions
+//******************************************************************************************************
+unsigned long millis(void) {
+  return (unsigned long) (sim.now() / (F_CPU / 1000UL));
+}
+
+
+unsigned long micros(void) {
+  return (unsigned long) (sim.now() / (F_CPU / 1000000UL));
+}
+
+
+void delay(unsigned long ms) {
+  // Busy wait. Interrupts will still be served
+  sim.advance((uint64_t) ms * 1000);
+}
+
+
+void delayMicroseconds(unsigned int us) {
+  sim.advance(us);
+}
+
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin >= SIM_MAX_PINS) return;
+  sim.mode[pin] = mode;
+  if (mode == INPUT_PULLUP) sim.setPin(pin, HIGH);
+}
+
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  sim.setPin(pin, val);
+}
+
+
+int digitalRead(uint8_t pin) {
+  if (pin >= SIM_MAX_PINS) return LOW;
+  return sim.level[pin];
+}
+
+
+void attachInterrupt(uint8_t interruptNum, void (*isr)(void), int mode) {
+  sim.attach(interruptNum, isr, mode);
+}
+
+
+void detachInterrupt(uint8_t interruptNum) {
+  sim.detach(interruptNum);
+}
+
+
+void noInterrupts(void) {
+  sim.interruptsEnabled = false;
+}
+
+
+void interrupts(void) {
+  sim.enableInterrupts();
+}
+
+
+uint64_t simEdgeTime(void) {
+  return sim.edgeTime;
+}
+
+
+//******************************************************************************************************
+//                                               Print
+//******************************************************************************************************
+SimSerial Serial;
+
+
+size_t SimSerial::write(uint8_t c) {
+  if (c != '\r') putchar(c);
+  return 1;
+}
+
+
+size_t Print::print(const char *s) {
+  size_t n = 0;
+  while (*s) n += write((uint8_t) *s++);
+  return n;
+}
+
+
+size_t Print::print(unsigned long value, int base) {
+  char buffer[8 * sizeof(long) + 1];
+  char *p = &buffer[sizeof(buffer) - 1];
+  *p = 0;
+  if (base < 2) base = 10;
+  do {
+    uint8_t digit = value % base;
+    *--p = (digit < 10) ? ('0' + digit) : ('A' + digit - 10);
+    value /= base;
+  } while (value);
+  return print(p);
+}
+
+
+size_t Print::print(long value, int base) {
+  if ((base == 10) && (value < 0)) return print('-') + print(0UL - (unsigned long) value, base);
+  return print((unsigned long) value, base);
+}
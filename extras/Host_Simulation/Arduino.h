@@ -0,0 +1,170 @@
+//******************************************************************************************************
+//
+// file:      Arduino.h
+// purpose:   Host (PC) replacement for the Arduino core, driven by a virtual clock
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//            2026-10-18 V1.0.1 ap Print and Serial (output to stdout)
+//
+// usage:     This file is NOT part of the Arduino library itself, but allows the library sources
+//            (src/*.cpp) to be compiled on a PC. Compile with -DAP_DCC_HOST and put this directory
+//            in front of the include path. See README.md in this directory for details.
+//
+//            Only the Arduino calls that are used by the library are provided: millis(), micros(),
+//            delay(), delayMicroseconds(), pinMode(), digitalWrite(), digitalRead(),
+//            attachInterrupt(), detachInterrupt(), noInterrupts() and interrupts(). In addition,
+//            Print (for methods such as dump(Print &out)), with Serial writing to stdout.
+//            Time does not pass by itself: the simulation advances the virtual clock (sim.advance())
+//            and delay() advances the clock by the requested time. While the clock advances, pin
+//            changes are applied and the attached interrupt routines are called, unless interrupts
+//            are disabled. In that case the interrupt remains pending until interrupts() is called.
+//            Like on a real AVR, a second edge on a pending interrupt does not trigger another call.
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL                   // Defines the virtual tick (and RCN-210 thresholds)
+#endif
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH            1
+#define LOW             0
+#define INPUT           0
+#define OUTPUT          1
+#define INPUT_PULLUP    2
+#define CHANGE          1
+#define FALLING         2
+#define RISING          3
+
+#define SIM_MAX_PINS    64                 // Number of simulated pins
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+#define digitalPinToInterrupt(p) (p)
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define F(string) (string)
+#define DEC 10
+#define HEX 16
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void attachInterrupt(uint8_t interruptNum, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t interruptNum);
+void noInterrupts(void);
+void interrupts(void);
+
+// Virtual time (in F_CPU ticks) at which the edge that triggered the running ISR occured.
+// Comparable to the TCB capture register: the moment is exact, even if the ISR starts late.
+uint64_t simEdgeTime(void);
+
+
+//******************************************************************************************************
+//                                               Print
+//******************************************************************************************************
+// The part of the Arduino Print class used by the library. Serial writes to stdout.
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    size_t print(const char *s);
+    size_t print(char c) { return write((uint8_t) c); }
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned int value, int base = DEC) { return print((unsigned long) value, base); }
+    size_t print(int value, int base = DEC) { return print((long) value, base); }
+    size_t print(unsigned char value, int base = DEC) { return print((unsigned long) value, base); }
+    size_t println(void) { return print("\r\n"); }
+    template <typename T> size_t println(T value) { size_t n = print(value); return n + println(); }
+    template <typename T> size_t println(T value, int base) { size_t n = print(value, base); return n + println(); }
+};
+
+class SimSerial : public Print {
+  public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t c);
+};
+
+extern SimSerial Serial;
+
+
+//******************************************************************************************************
+//                                         Edge sources
+//******************************************************************************************************
+// An edge source generates level changes for a single pin, such as a DCC signal. Sources are polled
+// lazily, so an hour of traffic never needs to be stored in memory.
+class SimEdgeSource {
+  public:
+    virtual ~SimEdgeSource() {}
+    virtual bool peek(uint64_t &time) = 0;          // Time of the next edge. False if there is none
+    virtual uint8_t pop(void) = 0;                  // Consume the next edge and return the new level
+    uint8_t pin;                                    // The pin that is driven by this source
+};
+
+
+//******************************************************************************************************
+//                                         The virtual clock
+//******************************************************************************************************
+class VirtualTime {
+  public:
+    VirtualTime();
+    void reset(void);                               // Back to time 0, all pins low, no sources
+
+    uint64_t now(void) { return _now; }             // Current virtual time in F_CPU ticks
+    uint64_t usToTicks(uint64_t us) { return us * (F_CPU / 1000000UL); }
+    void advance(uint64_t us);                      // Let time pass, while serving interrupts
+    void advanceTo(uint64_t ticks);                 // Same, but to an absolute moment (in ticks)
+
+    // Runs the sketch loop until "durationUs" has passed. Each loop() iteration is assumed to
+    // take "loopCostUs" of (virtual) CPU time.
+    void run(void (*loop)(void), uint64_t durationUs, uint32_t loopCostUs = 10);
+
+    void addSource(SimEdgeSource *source);          // Register an edge source (max 4)
+    void setPin(uint8_t pin, uint8_t level);        // Change the level of an (input) pin
+    void (*pinObserver)(uint8_t pin, uint8_t level);// If set, called after each pin change
+
+    // Used by the shim functions
+    uint8_t level[SIM_MAX_PINS];
+    uint8_t mode[SIM_MAX_PINS];
+    bool interruptsEnabled;
+    void attach(uint8_t pin, void (*isr)(void), int mode);
+    void detach(uint8_t pin);
+    void enableInterrupts(void);
+    uint64_t edgeTime;                              // Edge time of the ISR that currently runs
+
+    // Statistics
+    uint32_t interruptsDelayed;                     // Edges that found interrupts disabled
+    uint32_t interruptsLost;                        // Edges that found the interrupt already pending
+
+  private:
+    struct {
+      void (*isr)(void);
+      int mode;
+      bool pending;
+      uint64_t edgeTime;
+    } _irq[SIM_MAX_PINS];
+    SimEdgeSource *_sources[4];
+    uint8_t _numSources;
+    uint64_t _now;
+    void edge(uint8_t pin, uint8_t level);
+};
+
+extern VirtualTime sim;
@@ -0,0 +1,107 @@
+//******************************************************************************************************
+//
+// file:      DccSignal.cpp
+// purpose:   Generates a (virtual) DCC track signal for the host simulation
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//            2026-10-18 V1.0.1 ap Different delays for rising and falling edges
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#include "DccSignal.h"
+
+
+DccSignal::DccSignal(uint8_t dccPin) {
+  pin = dccPin;
+  refill = 0;
+  oneHalfUs = 58;
+  zeroHalfUs = 100;
+  riseDelayNs = 0;
+  fallDelayNs = 0;
+  packetsSent = 0;
+  _nextEdge = 0;
+  _nextNominal = 0;
+  _level = LOW;
+  _started = false;
+}
+
+
+void DccSignal::bit(uint8_t value) {
+  uint32_t half = value ? oneHalfUs : zeroHalfUs;
+  _halfBits.push_back(half);
+  _halfBits.push_back(half);
+}
+
+
+void DccSignal::rawPacket(const uint8_t *data, uint8_t size, uint8_t preambleBits) {
+  for (uint8_t i = 0; i < preambleBits; i++) bit(1);
+  for (uint8_t i = 0; i < size; i++) {
+    bit(0);                                     // Packet start bit / data byte start bit
+    for (int8_t j = 7; j >= 0; j--) bit((data[i] >> j) & 1);
+  }
+  bit(1);                                       // Packet end bit
+  packetsSent++;
+}
+
+
+void DccSignal::packet(const uint8_t *data, uint8_t size, uint8_t preambleBits) {
+  uint8_t buffer[8];
+  uint8_t x = 0;
+  if (size > 7) size = 7;
+  for (uint8_t i = 0; i < size; i++) {
+    buffer[i] = data[i];
+    x ^= data[i];
+  }
+  buffer[size] = x;
+  rawPacket(buffer, size + 1, preambleBits);
+}
+
+
+void DccSignal::idle(void) {
+  const uint8_t idlePacket[2] = {0xFF, 0x00};
+  packet(idlePacket, 2);
+}
+
+
+void DccSignal::gap(uint32_t us) {
+  // Extends the time until the next edge
+  if (us == 0) return;
+  _halfBits.push_back(us);
+}
+
+
+uint64_t DccSignal::edgeDelay(void) {
+  // The next edge goes to the opposite of the current level
+  uint64_t ns = _level ? fallDelayNs : riseDelayNs;
+  return ns * (F_CPU / 1000000UL) / 1000;
+}
+
+
+bool DccSignal::peek(uint64_t &time) {
+  if (_halfBits.empty()) {
+    if (refill) refill(*this);
+    if (_halfBits.empty()) idle();
+  }
+  if (!_started) {                              // First edge: start from the current time
+    _nextNominal = sim.now() + sim.usToTicks(_halfBits.front());
+    _nextEdge = _nextNominal + edgeDelay();
+    _started = true;
+  }
+  time = _nextEdge;
+  return true;
+}
+
+
+uint8_t DccSignal::pop(void) {
+  _halfBits.pop_front();
+  _level = !_level;
+  if (_halfBits.empty()) {
+    if (refill) refill(*this);
+    if (_halfBits.empty()) idle();
+  }
+  _nextNominal += sim.usToTicks(_halfBits.front());
+  _nextEdge = _nextNominal + edgeDelay();
+  return _level;
+}
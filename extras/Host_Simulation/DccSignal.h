@@ -0,0 +1,55 @@
+//******************************************************************************************************
+//
+// file:      DccSignal.h
+// purpose:   Generates a (virtual) DCC track signal for the host simulation
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//            2026-10-18 V1.0.1 ap Different delays for rising and falling edges
+//
+// usage:     DccSignal track(dccPin);
+//            sim.addSource(&track);
+//            track.packet(data, size);       // data without XOR; the XOR byte is added
+//            If the queue runs empty, "refill" is called (if set), to allow a traffic generator
+//            to provide the next packet(s). If nothing is provided, idle packets are sent.
+//
+// Timing follows RCN-210: a 1 bit consists of two halves of 58us, a 0 bit of two halves of 100us.
+// The halves may be changed, for example to test the limits of the RCN-210 thresholds.
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#pragma once
+#include <deque>
+#include "Arduino.h"
+
+
+class DccSignal : public SimEdgeSource {
+  public:
+    DccSignal(uint8_t dccPin);
+
+    void packet(const uint8_t *data, uint8_t size, uint8_t preambleBits = 17);
+    void rawPacket(const uint8_t *data, uint8_t size, uint8_t preambleBits = 17); // No XOR added
+    void idle(void);                            // Queue a single idle packet
+    void gap(uint32_t us);                      // Signal stays at the current level for some time
+    uint32_t queued(void) { return _halfBits.size(); }
+
+    void (*refill)(DccSignal &signal);          // Called if the queue is empty
+    uint32_t oneHalfUs;                         // Default 58
+    uint32_t zeroHalfUs;                        // Default 100
+    uint32_t riseDelayNs;                       // Delay of rising edges, such as by an optocoupler (0)
+    uint32_t fallDelayNs;                       // Delay of falling edges (0)
+    uint32_t packetsSent;                       // Number of packets that have been put on the track
+
+    bool peek(uint64_t &time);
+    uint8_t pop(void);
+
+  private:
+    std::deque<uint32_t> _halfBits;             // Duration (in us) before the next edge
+    uint64_t _nextEdge;                         // Virtual time of the next edge
+    uint64_t _nextNominal;                      // Same, without edge delay
+    uint8_t _level;
+    bool _started;
+    void bit(uint8_t value);
+    uint64_t edgeDelay(void);                   // Of the next edge, in ticks
+};
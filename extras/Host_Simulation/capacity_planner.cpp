@@ -0,0 +1,378 @@
+//******************************************************************************************************
+//
+// file:      capacity_planner.cpp
+// purpose:   Determines the packet queue depth and accessory repeat cache size a layout needs
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// A sketch that is busy (display, servos, EEPROM, delay()) does not call dcc.input() for a while.
+// Packets that arrive in the meantime are lost, unless they are queued (PacketQueueSize). Command
+// stations that interleave the copies of several accessory commands (route setting) need more than
+// one previous command to filter retransmissions (AccRepeatCache). Both cost RAM.
+//
+// This program replays a bus trace through the library, while the "sketch" is busy according to a
+// service pattern, for every combination of queue depth and cache size. For each combination it
+// prints the accessory commands lost, the commands delivered twice (retransmissions that were not
+// filtered), the packets dropped because the queue was full, and the latency percentiles (from the
+// start of the first copy on the track until dcc.input() returns it). Finally it recommends the
+// combination with the least RAM that meets the target loss rate (and p99 latency, if given).
+//
+// Compile with the largest sizes that should be tried, for example (on one line):
+//   g++ -O2 -std=c++11 -DAP_DCC_HOST -DPacketQueueSize=16 -DAccRepeatCache=8 -I extras/Host_Simulation
+//       -I src src/*.cpp extras/Host_Simulation/Arduino.cpp extras/Host_Simulation/DccSignal.cpp
+//       extras/Host_Simulation/capacity_planner.cpp -o capacity_planner
+//
+// usage:     capacity_planner [options] trace.txt | -s
+//              -p periodic|bursty|blocked   service pattern (default periodic)
+//              -i ms     periodic: busy every i ms; bursty: on average every i ms (default 100)
+//              -b ms     periodic, bursty: busy time (bursty: on average); blocked: time the
+//                        sketch blocks after each accessory command it receives (default 20)
+//              -t 0.1    target loss rate, in percent of the accessory commands
+//              -l ms     target p99 latency (default none)
+//              -w n      copies of a command that are more than n packets apart are different
+//                        commands (default 40)
+//              -s        use a synthetic trace instead of a file
+// A trace file contains one packet per line, as hexadecimal bytes including the XOR byte, as most
+// DCC sniffers print them ("8A F8 72"). Text after '#' is ignored. Packets are replayed back to back.
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+#include "Arduino.h"
+#include "DccSignal.h"
+#include "AP_DCC_library.h"
+#include "sup_isr.h"
+
+#if (PacketQueueSize < 2) || (AccRepeatCache < 2)
+#error "Compile with for example -DPacketQueueSize=16 -DAccRepeatCache=8"
+#endif
+
+extern Dcc dcc;
+extern Accessory accCmd;
+extern DccMessage dccMessage;
+
+const uint8_t dccPin = 2;
+const uint8_t queueDepths[] = {1, 2, 3, 4, 6, 8, 12, 16, 24, 32};
+const uint8_t cacheSizes[] = {1, 2, 3, 4, 6, 8, 12, 16};
+
+struct TracePacket {
+  uint8_t size;
+  uint8_t data[MaxDccSize];
+  int32_t command;                               // Accessory command this packet is a copy of, or -1
+};
+
+struct Result {
+  uint8_t queue;
+  uint8_t cache;
+  uint16_t ram;
+  uint32_t lost;
+  uint32_t duplicates;
+  uint32_t dropped;
+  double p50, p95, p99;                          // ms
+};
+
+std::vector<TracePacket> trace;
+uint32_t commands;                               // Number of different accessory commands in the trace
+
+// Service pattern
+enum { Periodic, Bursty, Blocked } pattern = Periodic;
+uint32_t intervalMs = 100;
+uint32_t busyMs = 20;
+
+// State of a single run
+DccSignal *track;
+uint32_t next;                                   // Next trace packet to send
+std::map<uint64_t, int32_t> lastSent;            // Packet contents -> last command sent with it
+std::vector<uint64_t> sentUs;                    // Per command: start of its first copy
+std::vector<bool> delivered;
+std::vector<double> latencies;
+uint32_t duplicates;
+uint64_t nextBusyUs;
+uint32_t seed;
+
+
+uint32_t random32(void) {
+  seed = seed * 1103515245UL + 12345UL;
+  return seed >> 8;
+}
+
+
+uint64_t key(const volatile uint8_t *data, uint8_t size) {
+  uint64_t k = size;
+  for (uint8_t i = 0; i < size; i++) k = (k << 8) | data[i];
+  return k;
+}
+
+
+bool isAccessoryCommand(const TracePacket &p) {
+  // Basic (3 bytes) or extended (4 bytes) accessory command; not CV access or NOP
+  if ((p.data[0] & 0b11000000) != 0b10000000) return false;
+  if (p.size == 3) return (p.data[1] & 0b10000000);
+  if (p.size == 4) return ((p.data[1] & 0b10001001) == 0b00000001);
+  return false;
+}
+
+
+//******************************************************************************************************
+// The trace
+//******************************************************************************************************
+void addPacket(const uint8_t *data, uint8_t size, bool addXor) {
+  TracePacket p;
+  uint8_t x = 0;
+  for (uint8_t i = 0; i < size; i++) { p.data[i] = data[i]; x ^= data[i]; }
+  if (addXor) p.data[size++] = x;
+  p.size = size;
+  p.command = -1;
+  trace.push_back(p);
+}
+
+
+bool readTrace(const char *name) {
+  FILE *f = fopen(name, "r");
+  if (f == 0) { perror(name); return false; }
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    char *comment = strchr(line, '#');
+    if (comment) *comment = 0;
+    uint8_t data[MaxDccSize];
+    uint8_t size = 0;
+    for (char *token = strtok(line, " \t\r\n,"); token; token = strtok(0, " \t\r\n,")) {
+      if (size == MaxDccSize) { size++; break; }
+      data[size++] = strtoul(token, 0, 16);
+    }
+    if ((size >= 3) && (size <= MaxDccSize)) addPacket(data, size, false);
+  }
+  fclose(f);
+  return true;
+}
+
+
+void syntheticTrace(void) {
+  // Speed and F0-F4 refreshes for 20 locos. Now and then a route is set: upto 6 turnouts, whose
+  // three copies are interleaved, with loco packets in between, as some command stations do.
+  // Each command changes the position of its turnout
+  seed = 2024;
+  uint8_t loco = 0;
+  uint8_t position[64 * 4] = {0};
+  while (trace.size() < 25000) {
+    if ((random32() % 150) == 0) {
+      uint8_t turnouts = 1 + random32() % 6;
+      uint8_t acc[6][2];
+      uint16_t outputs[6];
+      for (uint8_t t = 0; t < turnouts; t++) {
+        uint16_t output = random32() % (64 * 4);
+        for (uint8_t u = 0; u < t; u++) if (outputs[u] == output) { output = (output + 1) % (64 * 4); u = 255; }
+        outputs[t] = output;
+        uint16_t address = 1 + output / 4;       // Decoder address (OpenDCC coding)
+        position[output] ^= 1;
+        acc[t][0] = 0b10000000 | (address & 0b00111111);
+        acc[t][1] = 0b10001000 | ((~address >> 2) & 0b01110000) | ((output % 4) << 1) | position[output];
+      }
+      for (uint8_t copy = 0; copy < 3; copy++) {
+        for (uint8_t t = 0; t < turnouts; t++) {
+          addPacket(acc[t], 2, true);
+          const uint8_t speed[2] = {(uint8_t)(1 + loco), 0b01100000};
+          addPacket(speed, 2, true);
+          loco = (loco + 1) % 20;
+        }
+      }
+    }
+    const uint8_t speed[2] = {(uint8_t)(1 + loco), (uint8_t)(0b01100000 | (loco & 0x0F))};
+    const uint8_t f0f4[2] = {(uint8_t)(1 + loco), 0b10010000};
+    addPacket(speed, 2, true);
+    addPacket(f0f4, 2, true);
+    loco = (loco + 1) % 20;
+  }
+}
+
+
+void findCommands(uint32_t window) {
+  // A copy of an accessory packet that was sent less than window packets before belongs to the
+  // same command; otherwise it is a new command
+  commands = 0;
+  for (uint32_t i = 0; i < trace.size(); i++) {
+    if (!isAccessoryCommand(trace[i])) continue;
+    uint64_t k = key(trace[i].data, trace[i].size);
+    for (uint32_t j = i; (j > 0) && (i - j < window); j--) {
+      const TracePacket &p = trace[j - 1];
+      if ((p.command >= 0) && (key(p.data, p.size) == k)) { trace[i].command = p.command; break; }
+    }
+    if (trace[i].command < 0) trace[i].command = commands++;
+  }
+}
+
+
+//******************************************************************************************************
+// A single run
+//******************************************************************************************************
+void replay(DccSignal &signal) {
+  if (next >= trace.size()) return;              // Idle packets from now on
+  const TracePacket &p = trace[next++];
+  if (p.command >= 0) {
+    if (sentUs[p.command] == 0) sentUs[p.command] = micros();
+    lastSent[key(p.data, p.size)] = p.command;
+  }
+  signal.rawPacket(p.data, p.size);
+}
+
+
+void busy(uint32_t ms) {
+  // The sketch does something else; the ISR continues
+  sim.advance((uint64_t) ms * 1000);
+}
+
+
+void loop() {
+  if (dcc.input() && (dcc.cmdType == Dcc::MyAccessoryCmd)) {
+    std::map<uint64_t, int32_t>::iterator found = lastSent.find(key(dccMessage.data, dccMessage.size));
+    if (found != lastSent.end()) {
+      int32_t command = found->second;
+      if (delivered[command]) duplicates++;
+      else {
+        delivered[command] = true;
+        latencies.push_back((micros() - sentUs[command]) / 1000.0);
+      }
+    }
+    if (pattern == Blocked) busy(busyMs);
+  }
+  if ((pattern != Blocked) && (micros() >= nextBusyUs)) {
+    if (pattern == Periodic) {
+      busy(busyMs);
+      nextBusyUs += (uint64_t) intervalMs * 1000;
+    }
+    else {
+      busy(random32() % (2 * busyMs + 1));
+      nextBusyUs = micros() + (uint64_t)(random32() % (2 * intervalMs + 1)) * 1000;
+    }
+  }
+}
+
+
+double percentile(double fraction) {
+  if (latencies.empty()) return 0;
+  uint32_t i = (uint32_t)(fraction * (latencies.size() - 1) + 0.5);
+  return latencies[i];
+}
+
+
+Result run(uint8_t queue, uint8_t cache) {
+  sim.reset();
+  DccSignal signal(dccPin);
+  track = &signal;
+  sim.addSource(track);
+  track->refill = replay;
+  next = 0;
+  lastSent.clear();
+  sentUs.assign(commands, 0);
+  delivered.assign(commands, false);
+  latencies.clear();
+  duplicates = 0;
+  seed = 4711;
+  nextBusyUs = (uint64_t) intervalMs * 1000;
+  dcc.setQueueDepth(queue);
+  dcc.attach(dccPin);
+  accCmd.myMaster = OpenDCC;
+  accCmd.setMyAddress(0, 511);
+  accCmd.setRepeatCache(cache);
+  while (next < trace.size()) sim.run(loop, 100000UL, 10);
+  sim.run(loop, 1000000UL, 10);                  // Let the last packets be handled
+  dcc.detach();
+
+  Result r;
+  r.queue = queue;
+  r.cache = cache;
+  // Queue: size and data per entry, plus 6 bytes; cache: decoder address and two bytes per entry
+  r.ram = ((queue > 1) ? queue * (MaxDccSize + 1) + 6 : 0) + cache * 4;
+  r.lost = commands - latencies.size();
+  r.duplicates = duplicates;
+  r.dropped = dcc.queueOverflows();
+  std::sort(latencies.begin(), latencies.end());
+  r.p50 = percentile(0.50);
+  r.p95 = percentile(0.95);
+  r.p99 = percentile(0.99);
+  return r;
+}
+
+
+//******************************************************************************************************
+// Main
+//******************************************************************************************************
+int main(int argc, char *argv[]) {
+  bool synthetic = false;
+  double target = 0.1;
+  double latency = 0;
+  uint32_t window = 40;
+  int i = 1;
+  for (; i < argc; i++) {
+    if (argv[i][0] != '-') break;
+    if (strcmp(argv[i], "-s") == 0) { synthetic = true; continue; }
+    if (i + 1 >= argc) break;
+    const char *value = argv[++i];
+    switch (argv[i - 1][1]) {
+      case 'p':
+        if (strcmp(value, "periodic") == 0) pattern = Periodic;
+        else if (strcmp(value, "bursty") == 0) pattern = Bursty;
+        else if (strcmp(value, "blocked") == 0) pattern = Blocked;
+        else { fprintf(stderr, "unknown pattern %s\n", value); return 1; }
+        break;
+      case 'i': intervalMs = atoi(value); break;
+      case 'b': busyMs = atoi(value); break;
+      case 't': target = atof(value); break;
+      case 'l': latency = atof(value); break;
+      case 'w': window = atoi(value); break;
+      default: fprintf(stderr, "unknown option %s\n", argv[i - 1]); return 1;
+    }
+  }
+  if (synthetic) syntheticTrace();
+  else if (i < argc) { if (!readTrace(argv[i])) return 1; }
+  else {
+    fprintf(stderr, "usage: %s [-p periodic|bursty|blocked] [-i ms] [-b ms] [-t percent] [-l ms] [-w packets] "
+      "trace.txt | -s\n", argv[0]);
+    return 1;
+  }
+  if (intervalMs == 0) intervalMs = 1;
+  findCommands(window);
+  if (commands == 0) { fprintf(stderr, "The trace contains no accessory commands\n"); return 1; }
+
+  printf("Trace:    %s, %u packets, %u accessory commands\n", synthetic ? "synthetic" : argv[i],
+    (unsigned) trace.size(), commands);
+  if (pattern == Periodic) printf("Sketch:   busy %u ms every %u ms\n", busyMs, intervalMs);
+  if (pattern == Bursty) printf("Sketch:   busy 0..%u ms, every 0..%u ms\n", 2 * busyMs, 2 * intervalMs);
+  if (pattern == Blocked) printf("Sketch:   blocked %u ms after each accessory command\n", busyMs);
+  printf("Queue Cache   RAM   Lost%%    Dup%%  Dropped   p50 ms   p95 ms   p99 ms\n");
+  std::vector<Result> results;
+  for (uint8_t q = 0; q < sizeof(queueDepths); q++) {
+    if (queueDepths[q] > PacketQueueSize) break;
+    for (uint8_t c = 0; c < sizeof(cacheSizes); c++) {
+      if (cacheSizes[c] > AccRepeatCache) break;
+      Result r = run(queueDepths[q], cacheSizes[c]);
+      results.push_back(r);
+      printf("%5u %5u %5u %7.2f %7.2f %8u %8.1f %8.1f %8.1f\n", r.queue, r.cache, r.ram,
+        100.0 * r.lost / commands, 100.0 * r.duplicates / commands, r.dropped, r.p50, r.p95, r.p99);
+    }
+  }
+
+  // The smallest configuration that meets the target, for lost as well as duplicated commands
+  const Result *best = 0;
+  for (uint32_t n = 0; n < results.size(); n++) {
+    const Result &r = results[n];
+    if (100.0 * r.lost / commands > target) continue;
+    if (100.0 * r.duplicates / commands > target) continue;
+    if ((latency > 0) && (r.p99 > latency)) continue;
+    if ((best == 0) || (r.ram < best->ram) || ((r.ram == best->ram) && (r.p99 < best->p99))) best = &r;
+  }
+  if (best == 0) {
+    printf("No configuration meets the targets; try larger sizes or a lighter sketch\n");
+    return 2;
+  }
+  printf("Recommended: #define PacketQueueSize %u, #define AccRepeatCache %u (%u bytes RAM)\n",
+    best->queue, best->cache, best->ram);
+  return 0;
+}
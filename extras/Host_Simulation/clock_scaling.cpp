@@ -0,0 +1,129 @@
+//******************************************************************************************************
+//
+// file:      clock_scaling.cpp
+// purpose:   Changes the (virtual) main clock while packets arrive (CLOCK_SCALING and DCC_CLOCK)
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//            2026-10-18 V1.0.1 ap Counting starts and stops at packet boundaries
+//
+// First the clock is set, one after the other, to all values an AVR Dx supports. Each time, loco
+// traffic is sent for 2 seconds, and the clock is changed 100ms after the start. Then only idle
+// packets are sent until the last loco packet has arrived, so each loco packet is counted at the
+// clock it was sent at. Then, during ten virtual minutes, the clock scaler runs automatic
+// between 4 and 16 MHz: in between loco traffic for other decoders, now and then a burst of one to
+// five commands for the own accessory decoder (address 10) arrives. The program prints how many
+// loco packets were received at each clock, how many own commands got lost, the part of the time at
+// the low clock, and the largest difference between dccClock.millis() and the (virtual) millis().
+// Compile with -DDCC_CLOCK -DCLOCK_SCALING.
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include "Arduino.h"
+#include "DccSignal.h"
+#include "AP_DCC_library.h"
+#include "sup_isr.h"
+
+extern Dcc dcc;
+extern Accessory accCmd;
+extern DccClock dccClock;
+extern ClockScaler clockScaler;
+extern DccMessage dccMessage;                      // The last packet received
+
+const uint8_t dccPin = 2;
+const uint8_t myDecoder = 10;
+const uint8_t clocks[] = {1, 2, 3, 4, 8, 12, 16, 20, 24};
+
+DccSignal track(dccPin);
+bool sending = true;                               // False: only idle packets
+uint32_t locoSent, locoReceived;
+uint8_t position[4];
+uint8_t burstLeft;                                 // Own commands still to send in this burst
+unsigned long nextOwn = 3000;
+uint32_t ownSent, ownReceived;
+unsigned long lastLoop, lowTime, maxDrift;
+
+
+void accessory(uint16_t decoder, uint8_t port, uint8_t pos) {
+  uint16_t raw = decoder + 1;                      // myMaster = Lenz
+  uint8_t data[2] = {(uint8_t)(0x80 | (raw & 0x3F)),
+                     (uint8_t)(0x80 | ((~raw >> 2) & 0x70) | 0x08 | (port << 1) | pos)};
+  for (uint8_t i = 0; i < 4; i++) track.packet(data, 2);
+}
+
+
+void traffic(DccSignal &signal) {
+  if (!sending) {
+    signal.idle();
+    return;
+  }
+  unsigned long now = millis();
+  if (burstLeft && (now >= nextOwn)) {
+    uint8_t t = rand() % 4;
+    position[t] ^= 1;
+    accessory(myDecoder, t, position[t]);
+    ownSent++;
+    burstLeft--;
+    nextOwn = now + (burstLeft ? 100 + rand() % 200 : 3000 + rand() % 17000);
+    return;
+  }
+  if (!burstLeft && (now >= nextOwn)) burstLeft = 1 + rand() % 5;
+  if (rand() % 8 == 0) {
+    accessory(20 + rand() % 40, rand() % 4, rand() % 2);
+    return;
+  }
+  uint8_t loco[3] = {(uint8_t)(1 + rand() % 100), 0x3F, (uint8_t)(rand() & 0xFF)};
+  signal.packet(loco, 3);
+  locoSent++;
+}
+
+
+void loop() {
+  unsigned long now = millis();
+  if (clockScaler.clock() == 4) lowTime += now - lastLoop;
+  lastLoop = now;
+  long drift = (long)(dccClock.millis() - now);
+  if ((unsigned long)labs(drift) > maxDrift) maxDrift = labs(drift);
+  if (!dcc.input()) return;
+  if ((dccMessage.data[0] >= 1) && (dccMessage.data[0] <= 100)) locoReceived++;
+  if ((dcc.cmdType == Dcc::MyAccessoryCmd) && (accCmd.decoderAddress == myDecoder)) ownReceived++;
+}
+
+
+int main() {
+  srand(1);
+  sim.addSource(&track);
+  track.idle();
+  track.refill = traffic;
+  dcc.attach(dccPin);
+  accCmd.setMyAddress(myDecoder);
+  // Fixed clocks
+  for (uint8_t i = 0; i < sizeof(clocks); i++) {
+    locoSent = 0;
+    locoReceived = 0;
+    sending = true;
+    sim.run(loop, 100000ULL, 10);
+    clockScaler.setClock(clocks[i]);
+    sim.run(loop, 1900000ULL, 10);
+    sending = false;
+    sim.run(loop, 50000ULL, 10);                   // The last loco packets arrive
+    printf("%2u MHz: loco packets sent %u, received %u\n", clocks[i], locoSent, locoReceived);
+  }
+  sending = true;
+  // Automatic
+  clockScaler.setClock(16);
+  ownSent = 0;
+  ownReceived = 0;
+  lowTime = 0;
+  lastLoop = millis();
+  nextOwn = millis() + 3000;
+  clockScaler.automatic(4, 16, 500, 2);
+  sim.run(loop, 600000000ULL, 10);                 // Ten minutes
+  printf("Automatic 4 / 16 MHz: own commands sent %u, received %u\n", ownSent, ownReceived);
+  printf("Clock changes: %u, time at 4 MHz: %.1f%%\n", clockScaler.changes(), lowTime / 6000.0);
+  printf("Largest difference between dccClock.millis() and millis(): %lu ms\n", maxDrift);
+  return 0;
+}
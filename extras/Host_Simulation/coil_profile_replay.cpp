@@ -0,0 +1,159 @@
+//******************************************************************************************************
+//
+// file:      coil_profile_replay.cpp
+// purpose:   Replays recorded coil current profiles through the CoilDetector, to validate its
+//            parameters before they are used on a real decoder
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0 ap initial version
+//
+// usage:     coil_profile_replay [-b blankMs] [-m maxMs] [-h holdMs] [-d dipShift] [-r samplesPerMs]
+//                                file1.csv [file2.csv ...]
+//            coil_profile_replay -s    (synthetic profiles, see below)
+//
+//            Each file contains one ADC sample per line, as printed by the Accessory-Coil_Current
+//            sketch if RECORD_PROFILE is defined. Lines starting with '#' are ignored; the line
+//            "# samples per ms: N" sets the sample rate. A file may contain multiple profiles,
+//            separated by "# end". For each profile the length of the recording, the moment the
+//            detector would have ended the pulse and the result are printed.
+//
+//            With -s the detector is run on synthetic profiles. These are a crude RL model of a coil,
+//            with a dip at a variable moment, and only demonstrate the usage of this program. Its
+//            results say nothing about real coils: always validate against recorded profiles.
+//
+// compile:   g++ -O2 -std=c++11 extras/Host_Simulation/coil_profile_replay.cpp -o coil_profile_replay
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include "../../examples/Accessory-Coil_Current/CoilDetector.h"
+
+unsigned int blankMs = 5;
+unsigned int maxMs = 100;
+unsigned int holdMs = 3;
+unsigned int dipShift = 3;
+unsigned int samplesPerMs = 17;                    // 24Mhz, prescaler 256, as in the sketch
+
+unsigned int profiles;
+unsigned int completions;
+double savedMs;                                    // Sum of (maxMs - pulse length)
+
+
+void replay(const char *name, const std::vector<uint16_t> &profile) {
+  CoilDetector detector;
+  detector.begin(blankMs * samplesPerMs, maxMs * samplesPerMs, holdMs * samplesPerMs, dipShift);
+  uint8_t result = CoilDetector::busy;
+  size_t i = 0;
+  while ((result == CoilDetector::busy) && (i < profile.size())) result = detector.sample(profile[i++]);
+  profiles++;
+  printf("%-24s length %6.1f ms  ", name, (double) profile.size() / samplesPerMs);
+  if (result == CoilDetector::completed) {
+    completions++;
+    double cutoff = (double) detector.samples / samplesPerMs;
+    savedMs += maxMs - cutoff;
+    printf("completed at %6.1f ms, cut off at %6.1f ms\n",
+      (double) (detector.completedAt) / samplesPerMs, cutoff);
+  }
+  else if (result == CoilDetector::timeout) printf("timeout (fixed length)\n");
+  else printf("recording too short\n");
+}
+
+
+void replayFile(const char *fileName) {
+  FILE *f = fopen(fileName, "r");
+  if (f == NULL) {
+    perror(fileName);
+    return;
+  }
+  std::vector<uint16_t> profile;
+  char line[128];
+  char name[64];
+  unsigned int number = 0;
+  while (fgets(line, sizeof(line), f)) {
+    if (line[0] == '#') {
+      unsigned int rate;
+      if (sscanf(line, "# samples per ms: %u", &rate) == 1) samplesPerMs = rate;
+      else if ((strncmp(line, "# end", 5) == 0) && !profile.empty()) {
+        snprintf(name, sizeof(name), "%.16s[%u]", fileName, number++);
+        replay(name, profile);
+        profile.clear();
+      }
+      continue;
+    }
+    char *end;
+    long value = strtol(line, &end, 10);
+    if (end != line) profile.push_back((uint16_t) value);
+  }
+  if (!profile.empty()) {
+    snprintf(name, sizeof(name), "%.16s[%u]", fileName, number);
+    replay(name, profile);
+  }
+  fclose(f);
+}
+
+
+//******************************************************************************************************
+// Synthetic profiles (demonstration only)
+//******************************************************************************************************
+// The current rises with time constant tau towards the saturation value. Between dipStart and
+// dipEnd the back-EMF of the moving armature lowers the current. Some noise is added.
+void replaySynthetic(void) {
+  unsigned int seed = 1;
+  for (unsigned int dipEnd = 10; dipEnd <= 60; dipEnd += 10) {
+    std::vector<uint16_t> profile;
+    double tau = 4.0;                              // ms
+    double dipStart = dipEnd * 0.4;
+    for (unsigned int i = 0; i < maxMs * samplesPerMs + 1; i++) {
+      double t = (double) i / samplesPerMs;
+      double current = 800.0 * (1.0 - exp(-t / tau));
+      if ((t > dipStart) && (t < dipEnd)) current -= 300.0 * sin(M_PI * (t - dipStart) / (dipEnd - dipStart));
+      seed = seed * 1103515245 + 12345;
+      current += (int) ((seed >> 16) % 21) - 10;
+      if (current < 0) current = 0;
+      profile.push_back((uint16_t) current);
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "synthetic dip %u ms", dipEnd);
+    replay(name, profile);
+  }
+}
+
+
+int main(int argc, char *argv[]) {
+  bool synthetic = false;
+  int i = 1;
+  for (; i < argc; i++) {
+    if (argv[i][0] != '-') break;
+    if (strcmp(argv[i], "-s") == 0) { synthetic = true; continue; }
+    if (i + 1 >= argc) break;
+    unsigned int value = atoi(argv[i + 1]);
+    switch (argv[i][1]) {
+      case 'b': blankMs = value; break;
+      case 'm': maxMs = value; break;
+      case 'h': holdMs = value; break;
+      case 'd': dipShift = value; break;
+      case 'r': samplesPerMs = value; break;
+      default: fprintf(stderr, "unknown option %s\n", argv[i]); return 1;
+    }
+    i++;
+  }
+  if (!synthetic && (i >= argc)) {
+    fprintf(stderr, "usage: %s [-b blankMs] [-m maxMs] [-h holdMs] [-d dipShift] [-r samplesPerMs] "
+      "file.csv ... | -s\n", argv[0]);
+    return 1;
+  }
+  if (synthetic) {
+    printf("Synthetic profiles: these only demonstrate the program, not the behaviour of real coils\n");
+    replaySynthetic();
+  }
+  for (; i < argc; i++) replayFile(argv[i]);
+  printf("%u profiles, %u completed", profiles, completions);
+  if (completions) printf(", on average %.1f ms shorter than the fixed %u ms pulse", savedMs / completions, maxMs);
+  printf("\n");
+  return 0;
+}
@@ -0,0 +1,94 @@
+//******************************************************************************************************
+//
+// file:      edge_skew.cpp
+// purpose:   Shows the edge delay compensation, with an optocoupler that is slower for falling edges
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//            2026-10-18 V1.0.1 ap Counting starts and stops at packet boundaries
+//
+// Many optocouplers switch on faster than off. The falling edge delay given on the command line
+// (default 10000ns; the rising edge delay is 1000ns) makes every one half bit ending on a rising
+// edge that much shorter, and every half bit ending on a falling edge that much longer. The program
+// sends accessory commands for one minute without correction, calibrates, and sends them for another
+// minute. After each minute only idle packets are sent for 50ms, so that the commands that are still
+// on their way are counted in that minute. Compile with -DDCC_EDGE_COMPENSATION.
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include "Arduino.h"
+#include "DccSignal.h"
+#include "AP_DCC_library.h"
+
+extern Dcc dcc;
+extern Accessory accCmd;
+
+const uint8_t dccPin = 2;
+
+DccSignal track(dccPin);
+bool sending;                                    // False: only idle packets
+uint32_t sequence;
+uint32_t sent;
+uint32_t received;
+
+
+void traffic(DccSignal &signal) {
+  if (sending) {
+    sequence++;
+    sent++;
+    uint8_t data[2];
+    uint16_t address = 1 + (sequence % 255);
+    data[0] = 0b10000000 | (address & 0b00111111);
+    data[1] = 0b10001000 | ((~address >> 2) & 0b01110000) | (sequence & 0b00000111);
+    signal.packet(data, 2);
+  }
+  signal.idle();
+}
+
+
+void loop() {
+  if (dcc.input()) {
+    if ((dcc.cmdType == Dcc::MyAccessoryCmd) || (dcc.cmdType == Dcc::AnyAccessoryCmd)) received++;
+  }
+}
+
+
+void measure(uint64_t duration) {
+  // Counts the commands sent during duration (us), and received up to 50ms later
+  sent = 0;
+  received = 0;
+  sending = true;
+  sim.run(loop, duration, 10);
+  sending = false;
+  sim.run(loop, 50000UL, 10);
+}
+
+
+int main(int argc, char *argv[]) {
+  track.riseDelayNs = 1000;
+  track.fallDelayNs = (argc > 1) ? atoi(argv[1]) : 10000;
+  sim.addSource(&track);
+  track.idle();                                  // The decoder synchronises on the first packet
+  track.refill = traffic;
+  dcc.attach(dccPin);
+  accCmd.myMaster = OpenDCC;
+  accCmd.setMyAddress(0, 511);
+  printf("Edge delay:           rising %u ns, falling %u ns\n", track.riseDelayNs, track.fallDelayNs);
+  measure(60000000UL);                           // 1 minute without correction
+  printf("Without correction:   %u of %u commands received\n", received, sent);
+  unsigned long start = millis();
+  sending = true;
+  dcc.calibrateEdges();
+  while (!dcc.edgesCalibrated() && (millis() - start < 1000UL)) sim.run(loop, 1000, 10);
+  if (dcc.edgesCalibrated()) printf("Calibrated after:     %lu ms, correction %d ticks (%.2f us)\n",
+    millis() - start, dcc.edgeSkew(), dcc.edgeSkew() / (F_CPU / 1000000.0));
+  else printf("Not calibrated:       the difference is too large\n");
+  sending = false;
+  sim.run(loop, 50000UL, 10);
+  measure(60000000UL);                           // 1 minute with correction
+  printf("With correction:      %u of %u commands received\n", received, sent);
+  return 0;
+}
@@ -0,0 +1,90 @@
+//******************************************************************************************************
+//
+// file:      flight_recorder.cpp
+// purpose:   Shows the flight recorder, frozen by an XOR error burst, an emergency stop and the watchdog
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//            2026-10-19 V1.0.1 ap Reconstructed emergency stop (PACKET_RECONSTRUCTION)
+//
+// Loco 3 receives speed commands. Three events follow, and after each the recorder is dumped and
+// resumed: a few packets are corrupted (a noisy track section), the command station sends an
+// emergency stop, and the DCC signal disappears. Compile with -DFLIGHT_RECORDER. If also compiled
+// with -DPACKET_RECONSTRUCTION, a fourth event follows: an emergency stop of which each copy has
+// another bit error, so it only arrives as a reconstructed packet.
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#include <stdio.h>
+#include "Arduino.h"
+#include "DccSignal.h"
+#include "AP_DCC_library.h"
+
+extern Dcc dcc;
+extern Loco locoCmd;
+extern FlightRecorder flightRecorder;
+
+const uint8_t dccPin = 2;
+
+DccSignal track(dccPin);
+uint8_t speed;
+
+
+void speedCommand(void) {
+  uint8_t data[3] = {3, 0b00111111, (uint8_t)(0x80 | (++speed & 0x7F))};
+  track.packet(data, 3);
+  track.idle();
+}
+
+
+void loop() {
+  dcc.input();
+}
+
+
+void event(const char *name) {
+  // Let the event happen, wait until the recorder is frozen, and show what it recorded
+  printf("\n%s\n", name);
+  while (!flightRecorder.frozen() && (millis() < 600000UL)) sim.run(loop, 1000, 10);
+  flightRecorder.dump(Serial);
+  flightRecorder.resume();
+}
+
+
+int main() {
+  sim.addSource(&track);
+  dcc.attach(dccPin);
+  locoCmd.setMyAddress(3);
+  flightRecorder.xorErrors = 3;
+  flightRecorder.xorWindow = 8;
+  flightRecorder.watchdogMs = 100;
+  // Normal traffic, then three corrupted copies among correct ones
+  for (uint8_t i = 0; i < 20; i++) speedCommand();
+  uint8_t bad[4] = {3, 0b00111111, 0x85, 0x00};
+  for (uint8_t i = 0; i < 3; i++) {
+    track.rawPacket(bad, 4);
+    speedCommand();
+  }
+  event("Event 1: XOR errors");
+  // Emergency stop for all locos
+  for (uint8_t i = 0; i < 5; i++) speedCommand();
+  uint8_t stop[2] = {0, 0b01000001};
+  track.packet(stop, 2);
+  event("Event 2: emergency stop");
+  // The signal disappears
+  for (uint8_t i = 0; i < 5; i++) speedCommand();
+  track.gap(200000);
+  event("Event 3: no DCC signal");
+  #if defined(PACKET_RECONSTRUCTION)
+  // Emergency stop on a noisy track section: no copy is received without errors
+  for (uint8_t i = 0; i < 5; i++) speedCommand();
+  uint8_t noisyStop[3][3] = {{0, 0b01000011, 0b01000001}, {0, 0b01000001, 0b01010001}, {0, 0b01001001, 0b01000001}};
+  for (uint8_t i = 0; i < 3; i++) {
+    track.rawPacket(noisyStop[i], 3);
+    speedCommand();
+  }
+  event("Event 4: reconstructed emergency stop");
+  #endif
+  return 0;
+}
@@ -0,0 +1,128 @@
+//******************************************************************************************************
+//
+// file:      hour_of_traffic.cpp
+// purpose:   Simulates one hour of layout traffic, faster than real time, using the virtual clock
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// The traffic consists of speed and function refreshes for a number of locos, accessory commands
+// (each sent multiple times, like command stations do) and, every few minutes, a Service Mode
+// session (reset packets, followed by SM write commands that are acknowledged with dcc.sendAck()).
+// A fixed pseudo random generator is used, so every run gives exactly the same results. The
+// results can therefore be compared between versions of the library (performance regression).
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#include <stdio.h>
+#include <time.h>
+#include "Arduino.h"
+#include "DccSignal.h"
+#include "AP_DCC_library.h"
+
+extern Dcc dcc;
+extern Accessory accCmd;
+extern Loco locoCmd;
+extern CvAccess cvCmd;
+
+const uint8_t dccPin = 2;
+const uint8_t ackPin = 3;
+
+DccSignal track(dccPin);
+uint32_t counts[Dcc::SmCmd + 1];
+uint32_t acks;
+uint32_t seed = 12345;
+
+
+uint32_t random32(void) {
+  seed = seed * 1103515245UL + 12345UL;
+  return seed >> 8;
+}
+
+
+//******************************************************************************************************
+// The traffic generator: called by the track each time its queue becomes empty
+//******************************************************************************************************
+void traffic(DccSignal &signal) {
+  static uint32_t step = 0;
+  static uint8_t smPackets = 0;
+  step++;
+  if (smPackets) {                               // Service Mode session in progress
+    smPackets--;
+    if (smPackets > 8) {                         // First some reset packets
+      const uint8_t reset[2] = {0x00, 0x00};
+      signal.packet(reset, 2);
+    }
+    else {                                       // Write byte: CV 1 = 3
+      const uint8_t write[3] = {0b01111100, 0x00, 0x03};
+      signal.packet(write, 3);
+    }
+    return;
+  }
+  if ((step % 40000) == 0) {                     // Every few minutes: a Service Mode session
+    smPackets = 14;
+    return;
+  }
+  uint32_t r = random32();
+  if ((r % 50) == 0) {                           // Accessory command, repeated four times
+    uint16_t decoder = 1 + (r >> 8) % 128;
+    uint8_t byte0 = 0b10000000 | (decoder & 0b00111111);
+    uint8_t byte1 = 0b10001000 | ((~decoder >> 2) & 0b01110000) | ((r >> 16) & 0b00000111);
+    const uint8_t acc[2] = {byte0, byte1};
+    for (uint8_t i = 0; i < 4; i++) signal.packet(acc, 2);
+    return;
+  }
+  uint8_t loco = 1 + (r >> 4) % 20;              // Locos 1..20
+  if (r & 1) {                                   // 28 speed steps, forward
+    uint8_t speed = (r >> 12) % 16;
+    const uint8_t packet[2] = {loco, (uint8_t)(0b01100000 | speed)};
+    signal.packet(packet, 2);
+  }
+  else {                                         // F0..F4
+    const uint8_t packet[2] = {loco, (uint8_t)(0b10000000 | ((r >> 12) & 0b00011111))};
+    signal.packet(packet, 2);
+  }
+}
+
+
+//******************************************************************************************************
+// The sketch
+//******************************************************************************************************
+void setup() {
+  dcc.attach(dccPin, ackPin);
+  accCmd.setMyAddress(1, 32);
+  accCmd.myMaster = OpenDCC;
+  locoCmd.setMyAddress(5);
+}
+
+
+void loop() {
+  if (dcc.input()) {
+    counts[dcc.cmdType]++;
+    if (dcc.cmdType == Dcc::SmCmd) {
+      dcc.sendAck();
+      acks++;
+    }
+  }
+}
+
+
+int main(void) {
+  track.refill = traffic;
+  sim.addSource(&track);
+  clock_t start = clock();
+  setup();
+  sim.run(loop, 3600ULL * 1000000ULL, 10);       // One hour, each loop() takes 10us
+  double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  printf("Simulated time:         %lu ms\n", millis());
+  printf("Wall clock time:        %.2f s\n", seconds);
+  printf("Packets on the track:   %u\n", track.packetsSent);
+  printf("XOR errors:             %u\n", dcc.errorXOR);
+  printf("Interrupts delayed:     %u\n", sim.interruptsDelayed);
+  printf("Interrupts lost:        %u\n", sim.interruptsLost);
+  printf("SM acknowledgements:    %u\n", acks);
+  for (uint8_t i = 0; i <= Dcc::SmCmd; i++) printf("cmdType %2u:             %u\n", i, counts[i]);
+  return 0;
+}
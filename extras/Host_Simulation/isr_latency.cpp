@@ -0,0 +1,89 @@
+//******************************************************************************************************
+//
+// file:      isr_latency.cpp
+// purpose:   Shows the interrupt latency monitor, with another "ISR" that blocks the DCC ISR
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// Next to the DCC ISR, many sketches run other ISRs (sound, steppers, serial). While such an ISR
+// runs, the DCC ISR has to wait. This program simulates such an ISR: every 500us interrupts are
+// disabled for a random time upto the value given on the command line (default 40us). It prints
+// the latency histogram of the DCC ISR, the overruns, and how many accessory commands got through.
+// Compile with -DISR_LATENCY_MONITOR, and try for example 20, 40, 60 and 100us.
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include "Arduino.h"
+#include "DccSignal.h"
+#include "AP_DCC_library.h"
+
+extern Dcc dcc;
+extern Accessory accCmd;
+extern LatencyMonitor isrMonitor;
+
+const uint8_t dccPin = 2;
+const uint32_t commands = 5000;
+
+DccSignal track(dccPin);
+uint32_t sent;
+uint32_t received;
+uint32_t blockUs = 40;
+unsigned long lastBlock;
+uint32_t seed = 4711;
+
+
+uint32_t random32(void) {
+  seed = seed * 1103515245UL + 12345UL;
+  return seed >> 8;
+}
+
+
+void traffic(DccSignal &signal) {
+  if (sent >= commands) return;                  // Idle packets from now on
+  sent++;
+  uint8_t data[2];
+  uint16_t address = 1 + (sent % 255);
+  data[0] = 0b10000000 | (address & 0b00111111);
+  data[1] = 0b10001000 | ((~address >> 2) & 0b01110000) | (sent & 0b00000111);
+  signal.packet(data, 2);
+  signal.idle();
+}
+
+
+void loop() {
+  if (dcc.input()) {
+    if ((dcc.cmdType == Dcc::MyAccessoryCmd) || (dcc.cmdType == Dcc::AnyAccessoryCmd)) received++;
+  }
+  if (micros() - lastBlock >= 500) {             // The other ISR
+    lastBlock = micros();
+    noInterrupts();
+    sim.advance(random32() % (blockUs + 1));
+    interrupts();
+  }
+}
+
+
+int main(int argc, char *argv[]) {
+  if (argc > 1) blockUs = atoi(argv[1]);
+  sim.addSource(&track);
+  track.refill = traffic;
+  dcc.attach(dccPin);
+  accCmd.myMaster = OpenDCC;
+  accCmd.setMyAddress(0, 511);
+  sim.run(loop, 60000000UL, 10);                 // 1 minute
+  printf("Other ISR:            0..%u us, every 500 us\n", blockUs);
+  printf("Latency (us)          Edges\n");
+  for (uint8_t i = 0; i < isrMonitor.buckets(); i++) {
+    if (i < isrMonitor.buckets() - 1) printf("  < %3u               %9u\n", isrMonitor.bucketLimit(i), isrMonitor.count(i));
+    else printf("  larger              %9u\n", isrMonitor.count(i));
+  }
+  printf("Maximum latency:      %u us%s\n", isrMonitor.maximum(), isrMonitor.warning() ? " (warning)" : "");
+  printf("Overruns:             %u\n", isrMonitor.overruns());
+  printf("Commands sent:        %u\n", sent);
+  printf("Commands received:    %u\n", received);
+  return 0;
+}
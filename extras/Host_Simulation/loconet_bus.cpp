@@ -0,0 +1,302 @@
+//******************************************************************************************************
+//
+// file:      loconet_bus.cpp
+// purpose:   Compares the delay of commands via LocoNet and via the track (LOCONET)
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// A simple command station model drives a LocoNet bus as well as the track. Every one to three seconds
+// a throttle changes a turnout, or the speed, direction and F0, or F5-F8 of loco 3. The LocoNet message
+// goes over the bus (16667 baud), after which the command station updates its state and, after a
+// scheduling delay of 20 upto "maxDelay" ms, puts the new command on the track (a few copies). In
+// between it refreshes locos 3 and 1234 with their current state. Besides, the bus carries input
+// reports, which are not translated, and some messages are corrupted (checksum or framing errors).
+// The decoder listens to loco 3 and all accessory addresses. The sketch checks each command it gets:
+// new commands should come exactly once, with the right values, whatever input was first.
+// usage:     loconet_bus [track] [maxDelay]   With "track" the LocoNet input is not used.
+// Compile with -DLOCONET.
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include "Arduino.h"
+#include "DccSignal.h"
+#include "AP_DCC_library.h"
+#include "sup_loconet.h"
+
+extern Dcc dcc;
+extern Accessory accCmd;
+extern Loco locoCmd;
+extern LocoNet loconet;
+
+const uint8_t dccPin = 2;
+const uint64_t byteTime = 600;                     // us: 10 bits at 16667 baud
+const uint8_t slot3 = 5;                           // LocoNet slots of loco 3 and loco 1234
+const uint8_t slot1234 = 6;
+
+DccSignal track(dccPin);
+bool useLocoNet = true;
+unsigned maxDelay = 300;
+
+// The command station
+struct {
+  uint8_t spd;                                     // Loco 3, as LocoNet codes
+  uint8_t dirf;
+  uint8_t snd;
+  uint8_t position[32];                            // Switches 0..31
+} cs = {20, 0, 0, {0}};
+
+struct Bus { uint64_t time; uint8_t value; bool framingError; };
+std::deque<Bus> bus;                               // LocoNet bytes, in the order of their time
+uint64_t busFree;                                  // us: the bus is idle from this moment
+
+struct TrackCmd { uint64_t due; uint8_t data[5]; uint8_t size; uint8_t copies; };
+std::deque<TrackCmd> trackCmds;                    // New commands, waiting for the track
+uint8_t refresh;
+uint64_t stateTime;                                // us: the new state applies from this moment
+uint8_t nextSpd, nextDirf, nextSnd;
+
+// The current event, and what the sketch should get
+uint64_t eventTime;
+uint64_t nextEvent = 500000;
+uint8_t expected, seen;                            // Bit 0: accessory, 1: speed, 2: F0-F4, 3: F5-F8
+uint8_t switchNumber;
+uint32_t events, missing, duplicates, wrong, viaLocoNet, corrupted;
+uint64_t latencySum, latencyMax;
+uint32_t latencyCount;
+
+
+uint64_t nowUs(void) { return sim.now() / (F_CPU / 1000000UL); }
+
+
+//******************************************************************************************************
+void loconetSend(const uint8_t *message, uint8_t size) {
+  uint8_t chk = 0xFF;
+  for (uint8_t i = 0; i < size; i++) chk ^= message[i];
+  uint64_t t = (busFree > nowUs()) ? busFree : nowUs();
+  int noise = rand() % 100;
+  uint8_t broken = rand() % (size + 1);
+  for (uint8_t i = 0; i <= size; i++) {
+    uint8_t value = (i < size) ? message[i] : chk;
+    bool framingError = false;
+    if ((noise < 2) && (i == broken)) value ^= 0x01;             // Checksum error
+    if ((noise >= 2) && (noise < 3) && (i == broken)) framingError = true;  // Collision
+    bus.push_back({t += byteTime, value, framingError});
+  }
+  if (noise < 3) corrupted++;
+  busFree = t + 2 * byteTime;
+}
+
+
+void loconetDeliver(void) {
+  while (!bus.empty() && (bus.front().time <= nowUs())) {
+    if (useLocoNet) loconetMessage.receive(bus.front().value, bus.front().framingError);
+    bus.pop_front();
+  }
+}
+
+
+void slotRead(uint8_t slot, uint16_t address) {
+  uint8_t m[13] = {0xE7, 0x0E, slot, 0x33, (uint8_t)(address & 0x7F), cs.spd, cs.dirf, 0x07, 0,
+                   (uint8_t)(address >> 7), cs.snd, 0, 0};
+  loconetSend(m, 13);
+}
+
+
+//******************************************************************************************************
+uint8_t locoPacket(uint8_t *data, uint16_t address) {
+  if (address < 128) {
+    data[0] = address;
+    return 1;
+  }
+  data[0] = 0xC0 | (address >> 8);
+  data[1] = address & 0xFF;
+  return 2;
+}
+
+
+void queueTrack(const uint8_t *data, uint8_t size, uint64_t due, uint8_t copies) {
+  TrackCmd c;
+  memcpy(c.data, data, size);
+  c.size = size;
+  c.due = due;
+  c.copies = copies;
+  trackCmds.push_back(c);
+}
+
+
+void trackTraffic(DccSignal &signal) {
+  if (nowUs() >= stateTime) {
+    cs.spd = nextSpd;
+    cs.dirf = nextDirf;
+    cs.snd = nextSnd;
+  }
+  if (!trackCmds.empty() && (trackCmds.front().due <= nowUs())) {
+    TrackCmd &c = trackCmds.front();
+    signal.packet(c.data, c.size);
+    if (--c.copies == 0) trackCmds.pop_front();
+    return;
+  }
+  uint8_t data[5];
+  uint8_t n;
+  switch (refresh++ % 4) {
+    case 0:
+      n = locoPacket(data, 3);
+      data[n++] = 0x3F;
+      data[n++] = ((cs.dirf & 0x20) ? 0 : 0x80) | cs.spd;
+      break;
+    case 1:
+      n = locoPacket(data, 3);
+      data[n++] = 0x80 | (cs.dirf & 0x1F);
+      break;
+    case 2:
+      n = locoPacket(data, 1234);
+      data[n++] = 0x3F;
+      data[n++] = 0x80 | 40;
+      break;
+    default:
+      n = locoPacket(data, 3);
+      data[n++] = 0xB0 | cs.snd;
+  }
+  signal.packet(data, n);
+}
+
+
+//******************************************************************************************************
+void newEvent(void) {
+  if (events && (seen != expected)) missing++;
+  events++;
+  eventTime = nowUs();
+  seen = 0;
+  nextSpd = cs.spd;
+  nextDirf = cs.dirf;
+  nextSnd = cs.snd;
+  uint8_t m[3];
+  uint8_t data[5];
+  uint8_t n;
+  switch (rand() % 4) {
+    case 0:                                        // Toggle a switch
+      switchNumber = rand() % 32;
+      cs.position[switchNumber] ^= 1;
+      m[0] = 0xB0;
+      m[1] = switchNumber;
+      m[2] = 0x10 | (cs.position[switchNumber] << 5);
+      data[0] = 0x80 | (((switchNumber >> 2) + 1) & 0x3F);
+      data[1] = 0xF8 | ((switchNumber & 3) << 1) | cs.position[switchNumber];
+      n = 2;
+      expected = 1;
+      break;
+    case 1:                                        // Speed
+      do nextSpd = 2 + rand() % 126; while (nextSpd == cs.spd);
+      m[0] = 0xA0; m[1] = slot3; m[2] = nextSpd;
+      n = locoPacket(data, 3);
+      data[n++] = 0x3F;
+      data[n++] = ((cs.dirf & 0x20) ? 0 : 0x80) | nextSpd;
+      expected = 2;
+      break;
+    case 2:                                        // Direction and F0
+      nextDirf = cs.dirf ^ 0x30;
+      m[0] = 0xA1; m[1] = slot3; m[2] = nextDirf;
+      n = locoPacket(data, 3);
+      data[n++] = 0x3F;
+      data[n++] = ((nextDirf & 0x20) ? 0 : 0x80) | cs.spd;
+      expected = 6;
+      break;
+    default:                                       // One of F5-F8
+      nextSnd = cs.snd ^ (1 << (rand() % 4));
+      m[0] = 0xA2; m[1] = slot3; m[2] = nextSnd;
+      n = locoPacket(data, 3);
+      data[n++] = 0xB0 | nextSnd;
+      expected = 8;
+  }
+  loconetSend(m, 3);
+  stateTime = busFree + 2000;                      // Processed 2 ms after the message
+  uint64_t due = stateTime + 1000ULL * (20 + rand() % (maxDelay - 19));
+  queueTrack(data, n, due, (expected == 1) ? 4 : 2);
+  if (expected == 6) {
+    n = locoPacket(data, 3);
+    data[n++] = 0x80 | (nextDirf & 0x1F);
+    queueTrack(data, n, due, 2);
+  }
+}
+
+
+bool correct(uint8_t kind) {
+  switch (kind) {
+    case 1: return (accCmd.decoderAddress == (switchNumber >> 2)) && (accCmd.turnout == (switchNumber & 3) + 1) &&
+                   (accCmd.position == cs.position[switchNumber]);
+    case 2: return (locoCmd.speed == nextSpd - 1) && (locoCmd.forward == !(nextDirf & 0x20));
+    case 4: return (locoCmd.F0F4 == (nextDirf & 0x1F));
+    default: return (locoCmd.F5F8 == nextSnd);
+  }
+}
+
+
+void loop() {
+  loconetDeliver();
+  if (nowUs() >= nextEvent) {
+    newEvent();
+    nextEvent = nowUs() + 1000000ULL + 1000ULL * (rand() % 2000);
+  }
+  if (!dcc.input()) return;
+  uint8_t kind = 0;
+  switch (dcc.cmdType) {
+    case Dcc::MyAccessoryCmd: kind = 1; break;
+    case Dcc::MyLocoSpeedCmd: kind = 2; break;
+    case Dcc::MyLocoF0F4Cmd: kind = 4; break;
+    case Dcc::MyLocoF5F8Cmd: kind = 8; break;
+    default: return;
+  }
+  if (!events) return;                             // The initial state of loco 3
+  if (!(expected & kind) || (seen & kind)) duplicates++;
+  else if (!correct(kind)) wrong++;
+  else {
+    seen |= kind;
+    if (dcc.fromLocoNet) viaLocoNet++;
+    uint64_t latency = nowUs() - eventTime;
+    latencySum += latency;
+    if (latency > latencyMax) latencyMax = latency;
+    latencyCount++;
+  }
+}
+
+
+int main(int argc, char *argv[]) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "track") == 0) useLocoNet = false;
+      else maxDelay = atoi(argv[i]);
+  }
+  if (maxDelay < 20) maxDelay = 20;
+  srand(1);
+  nextSpd = cs.spd;
+  sim.addSource(&track);
+  track.idle();
+  track.refill = trackTraffic;
+  dcc.attach(dccPin);
+  accCmd.setMyAddress(0, 510);
+  locoCmd.setMyAddress(3);
+  loconet.attach();
+  slotRead(slot3, 3);
+  slotRead(slot1234, 1234);
+  for (uint32_t s = 0; s < 600; s++) {             // Ten minutes, with input reports every 100 ms
+    for (uint8_t i = 0; i < 10; i++) {
+      uint8_t report[3] = {0xB2, (uint8_t)(rand() & 0x7F), (uint8_t)(rand() & 0x3F)};
+      loconetSend(report, 3);
+      sim.run(loop, 100000, 10);
+    }
+  }
+  if (seen != expected) missing++;
+  printf("Input: %s, track delay upto %u ms\n", useLocoNet ? "LocoNet and track" : "track only", maxDelay);
+  printf("Events: %u, commands reported: %u (%u via LocoNet)\n", events, latencyCount, viaLocoNet);
+  printf("Missing: %u, duplicates: %u, wrong values: %u\n", missing, duplicates, wrong);
+  printf("Delay until reported: average %.1f ms, maximum %.1f ms\n",
+         latencyCount ? latencySum / 1000.0 / latencyCount : 0.0, latencyMax / 1000.0);
+  printf("LocoNet messages: %u, errors: %u (%u messages corrupted)\n", loconet.messages(), loconet.errors(),
+         corrupted);
+  return 0;
+}
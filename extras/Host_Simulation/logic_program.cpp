@@ -0,0 +1,109 @@
+//******************************************************************************************************
+//
+// file:      logic_program.cpp
+// purpose:   Runs a user logic program (see sup_vm.cpp) on simulated accessory commands
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// The program below drives a turnout with two coils (pins 10 and 11). On an accessory command with
+// activate set, the coil for the requested position is switched on for 250 ms. Variable v0 acts as
+// interlock: while a coil is on, new commands are refused and counted in v1. The traffic generator
+// sends a new command every 100 ms, thus some commands arrive while a coil is still on.
+// Compile with -DLOGIC_VM. The program prints every coil pulse, with its length.
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#include <stdio.h>
+#include "Arduino.h"
+#include "DccSignal.h"
+#include "AP_DCC_library.h"
+#include "sup_vm.h"
+
+extern Dcc dcc;
+extern Accessory accCmd;
+extern Logic logic;
+
+const uint8_t dccPin = 2;
+const uint8_t coilPin[2] = {10, 11};
+
+const uint8_t program[] PROGMEM = {
+  74, 0,                                         // Size
+  1,                                             // One handler
+  Dcc::MyAccessoryCmd, 6, 0,                     // Handler at 6
+  VM_LDF,   0, VM_F_ACTIVATE,                    //  6: r0 = accCmd.activate
+  VM_JZ,    0, 73, 0,                            //  9: not activated: end
+  VM_LDV,   1, 0,                                // 13: r1 = v0 (a coil is on)
+  VM_JNZ,   1, 64, 0,                            // 16: busy: refuse
+  VM_LDI,   1, 1,                                // 20: v0 = 1
+  VM_STV,   0, 1,                                // 23
+  VM_LDF,   2, VM_F_POSITION,                    // 26: r2 = accCmd.position
+  VM_JNZ,   2, 48, 0,                            // 29: position 1: coil 2
+  VM_OUT,   10, 1,                               // 33: coil 1 on
+  VM_WAITI, 250, 0,                              // 36
+  VM_LDI,   0, 0,                                // 39: coil 1 off
+  VM_OUT,   10, 0,                               // 42
+  VM_JMP,   60, 0,                               // 45
+  VM_OUT,   11, 1,                               // 48: coil 2 on
+  VM_WAITI, 250, 0,                              // 51
+  VM_LDI,   0, 0,                                // 54: coil 2 off
+  VM_OUT,   11, 0,                               // 57
+  VM_STV,   0, 0,                                // 60: v0 = 0
+  VM_END,                                        // 63
+  VM_LDV,   1, 1,                                // 64: v1++
+  VM_ADDI,  1, 1,                                // 67
+  VM_STV,   1, 1,                                // 70
+  VM_END                                         // 73
+};
+
+DccSignal track(dccPin);
+unsigned long lastCommand;
+uint8_t commands;
+uint8_t coilLevel[2];
+unsigned long coilOn[2];
+
+
+void traffic(DccSignal &signal) {
+  if ((commands >= 20) || (millis() - lastCommand < 100)) {
+    signal.idle();
+    return;
+  }
+  lastCommand = millis();
+  commands++;
+  // Basic accessory command for (raw) decoder address 1, activate, alternating positions
+  uint8_t data[2];
+  data[0] = 0b10000001;
+  data[1] = 0b11111000 | (commands & 0b00000001);
+  for (uint8_t copy = 0; copy < 3; copy++) signal.packet(data, 2);
+}
+
+
+void loop() {
+  dcc.input();
+  for (uint8_t i = 0; i < 2; i++) {
+    uint8_t level = digitalRead(coilPin[i]);
+    if (level == coilLevel[i]) continue;
+    coilLevel[i] = level;
+    if (level) coilOn[i] = millis();
+    else printf("%6lu ms: coil %u on for %lu ms\n", coilOn[i], i + 1, millis() - coilOn[i]);
+  }
+}
+
+
+int main(void) {
+  sim.addSource(&track);
+  track.refill = traffic;
+  dcc.attach(dccPin);
+  accCmd.myMaster = OpenDCC;
+  accCmd.setMyAddress(0);                        // Raw address 1
+  if (!logic.loadProgmem(program)) {
+    printf("Program rejected\n");
+    return 1;
+  }
+  sim.run(loop, 3000000UL, 10);                  // 3 seconds
+  printf("Commands sent:        %u\n", commands);
+  printf("Commands refused:     %d (v1)\n", logic.variable(1));
+  printf("Commands dropped:     %u (all tasks busy)\n", logic.dropped());
+  return 0;
+}
@@ -0,0 +1,132 @@
+//******************************************************************************************************
+//
+// file:      master_detect.cpp
+// purpose:   Shows the detection of the accessory address variant (myMaster = AutoDetect)
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// For each scenario, a command station of the given variant switches turnouts with handheld addresses
+// within a range. Like for routes, the next command is often for the next handheld address. The
+// decoder starts with AutoDetect and listens to all addresses. The program shows the detected variant,
+// after how many commands, and how many commands were reported with an output address different from
+// the handheld address (before and after detection).
+// Compile with -DACC_AUTO_DETECT.
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include "Arduino.h"
+#include "DccSignal.h"
+#include "AP_DCC_library.h"
+
+extern Dcc dcc;
+extern Accessory accCmd;
+
+const uint8_t dccPin = 2;
+const char *names[] = {"Roco", "Lenz", "OpenDCC", "undetected"};
+
+struct Scenario {
+  uint8_t variant;
+  uint16_t first;                              // Handheld addresses used on the layout
+  uint16_t last;
+};
+
+Scenario scenarios[] = {
+  {Roco,       1,   48},
+  {Roco,     100,  300},
+  {Lenz,       1,  200},
+  {Lenz,       1,  400},
+  {Lenz,     200, 1024},
+  {OpenDCC,    1,  200},
+  {OpenDCC,    1, 2048},
+  {OpenDCC,  500, 2048},
+};
+
+Scenario *current;
+uint16_t handheld;                             // Address of the last command sent
+uint32_t sent;
+uint32_t detectedAfter;
+uint32_t wrongBefore;
+uint32_t wrongAfter;
+
+
+void rawAddress(uint8_t variant, uint16_t address, uint8_t &msb, uint8_t &lsb, uint8_t &turnout) {
+  // The address bits a command station of this variant uses for a handheld address (1..2048)
+  uint16_t raw;
+  switch (variant) {
+    case Roco:
+      raw = (address - 1) >> 2;
+      turnout = (address - 1) & 3;
+      break;
+    case Lenz:
+      raw = ((address - 1) >> 2) + 1;
+      turnout = (address - 1) & 3;
+      if ((raw & 0x3F) == 0) raw -= 64;        // 253..256 => 0, 509..512 => 256 + 0, ...
+      break;
+    default:
+      raw = ((address + 3) >> 2) & 0x1FF;      // 2041..2044 => 511 (broadcast), 2045..2048 => 0
+      turnout = (address + 3) & 3;
+      break;
+  }
+  msb = raw >> 6;
+  lsb = raw & 0x3F;
+}
+
+
+void traffic(DccSignal &signal) {
+  sent++;
+  if ((rand() % 4 == 0) || (handheld < current->first) || (handheld >= current->last))
+    handheld = current->first + (rand() % (current->last - current->first + 1));
+  else handheld++;
+  if ((current->variant == OpenDCC) && (handheld >= 2041) && (handheld <= 2044)) handheld = 2045;
+  uint8_t msb, lsb, turnout;
+  rawAddress(current->variant, handheld, msb, lsb, turnout);
+  uint8_t data[2];
+  data[0] = 0b10000000 | lsb;
+  data[1] = 0b10001000 | ((~msb & 0b111) << 4) | (turnout << 1) | (rand() & 1);
+  signal.packet(data, 2);
+  signal.packet(data, 2);                      // Retransmission
+  signal.idle();
+}
+
+
+void loop() {
+  if (dcc.input() && (dcc.cmdType == Dcc::MyAccessoryCmd)) {
+    bool detected = (accCmd.myMaster != AutoDetect);
+    if (detected && (detectedAfter == 0)) detectedAfter = sent;
+    if (accCmd.outputAddress != handheld) {
+      if (detected) wrongAfter++;
+      else wrongBefore++;
+    }
+  }
+}
+
+
+int main() {
+  printf("Command station  Handheld    Detected    After  Wrong before / after\n");
+  for (Scenario &scenario : scenarios) {
+    current = &scenario;
+    sent = 0;
+    detectedAfter = 0;
+    wrongBefore = 0;
+    wrongAfter = 0;
+    srand(1);
+    handheld = 0;
+    sim.reset();
+    DccSignal track(dccPin);
+    track.refill = traffic;
+    sim.addSource(&track);
+    dcc.attach(dccPin);
+    accCmd.setMyAddress(0, 511);
+    accCmd.myMaster = AutoDetect;
+    sim.run(loop, 600000000UL, 10);            // 10 minutes
+    dcc.detach();
+    uint8_t result = (accCmd.myMaster == AutoDetect) ? 3 : accCmd.myMaster;
+    printf("%-15s  %4u-%-4u   %-10s  %6u  %6u / %u   (of %u)\n", names[scenario.variant],
+      scenario.first, scenario.last, names[result], detectedAfter, wrongBefore, wrongAfter, sent);
+  }
+  return 0;
+}
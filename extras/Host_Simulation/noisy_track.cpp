@@ -0,0 +1,81 @@
+//******************************************************************************************************
+//
+// file:      noisy_track.cpp
+// purpose:   Simulates a noisy track section, on which every copy of a command may be corrupted
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// Accessory commands are sent three times (like most command stations do). Each copy gets, with a
+// certain probability, a single bit error in one of its data bytes. The program counts how many
+// commands reach the sketch. Compile once without and once with -DPACKET_RECONSTRUCTION to see the
+// effect of the majority vote reconstruction (see Dcc::reconstruct() in AP_DCC_library.cpp).
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#include <stdio.h>
+#include "Arduino.h"
+#include "DccSignal.h"
+#include "AP_DCC_library.h"
+
+extern Dcc dcc;
+extern Accessory accCmd;
+
+const uint8_t dccPin = 2;
+const uint32_t commands = 10000;
+const uint32_t errorRate = 60;                   // Percentage of copies with a bit error
+
+DccSignal track(dccPin);
+uint32_t sent;
+uint32_t received;
+uint32_t seed = 4711;
+
+
+uint32_t random32(void) {
+  seed = seed * 1103515245UL + 12345UL;
+  return seed >> 8;
+}
+
+
+void traffic(DccSignal &signal) {
+  if (sent >= commands) return;                  // Idle packets from now on
+  sent++;
+  // Basic accessory command, decoder address 1..255, with a different output each time
+  uint8_t data[3];
+  uint16_t address = 1 + (sent % 255);
+  data[0] = 0b10000000 | (address & 0b00111111);
+  data[1] = 0b10001000 | ((~address >> 2) & 0b01110000) | (sent & 0b00000111);
+  data[2] = data[0] ^ data[1];
+  for (uint8_t copy = 0; copy < 3; copy++) {
+    uint8_t packet[3] = {data[0], data[1], data[2]};
+    if ((random32() % 100) < errorRate)
+      packet[1 + random32() % 2] ^= 1 << (random32() % 8);
+    signal.rawPacket(packet, 3);
+  }
+  signal.idle();
+}
+
+
+void loop() {
+  if (dcc.input()) {
+    if ((dcc.cmdType == Dcc::MyAccessoryCmd) || (dcc.cmdType == Dcc::AnyAccessoryCmd)) received++;
+  }
+}
+
+
+int main(void) {
+  sim.addSource(&track);
+  track.refill = traffic;
+  dcc.attach(dccPin);
+  accCmd.myMaster = OpenDCC;
+  accCmd.setMyAddress(0, 511);
+  sim.run(loop, 300000000UL, 10);                // 5 minutes
+  printf("Commands sent:        %u (%u%% of the copies corrupted)\n", sent, errorRate);
+  printf("Commands received:    %u\n", received);
+  printf("XOR errors:           %u (8 bit counter)\n", dcc.errorXOR);
+  #if defined(PACKET_RECONSTRUCTION)
+  printf("Reconstructed:        %u (8 bit counter)\n", dcc.reconstructed);
+  #endif
+  return 0;
+}
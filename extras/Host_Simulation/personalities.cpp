@@ -0,0 +1,105 @@
+//******************************************************************************************************
+//
+// file:      personalities.cpp
+// purpose:   Shows a board that acts as several accessory decoders (AccPersonalities)
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// Four personalities are defined, with different address ranges, variants and output types. A basic
+// accessory command is sent for every address code (MSB + LSB), and for each command the personality
+// and decoder address reported by the library are compared with a straightforward search through
+// all ranges. Compile with -DAccPersonalities=4.
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#include <stdio.h>
+#include "Arduino.h"
+#include "DccSignal.h"
+#include "AP_DCC_library.h"
+
+extern Dcc dcc;
+extern Accessory accCmd;
+
+const uint8_t dccPin = 2;
+const char *types[] = {"coil", "servo", "signal", "relay"};
+
+struct Personality {
+  unsigned int first;
+  unsigned int last;
+  uint8_t master;
+  Accessory::Output_t type;
+};
+
+Personality board[AccPersonalities] = {
+  {  0,   3, Lenz,    Accessory::coil},
+  { 63,  64, Lenz,    Accessory::servo},         // Around the Lenz correction (handheld 253..260)
+  {100, 107, OpenDCC, Accessory::signal},
+  {509, 511, Roco,    Accessory::relay},
+};
+
+DccSignal track(dccPin);
+uint16_t code;                                 // Address code of the last command sent
+uint32_t commands[AccPersonalities];
+uint32_t errors;
+
+
+bool expected(uint16_t code, uint8_t &number, unsigned int &address) {
+  // Search all ranges; the highest personality wins
+  for (int8_t p = AccPersonalities - 1; p >= 0; p--) {
+    unsigned int a;
+    switch (board[p].master) {
+      case Roco: a = code; break;
+      case OpenDCC: a = (code - 1) & 0x1FF; break;
+      default: a = ((code & 0x3F) == 0) ? code + 63 : code - 1; break;
+    }
+    if ((a >= board[p].first) && (a <= board[p].last)) {
+      number = p;
+      address = a;
+      return true;
+    }
+  }
+  return false;
+}
+
+
+void traffic(DccSignal &signal) {
+  if (code == 510) return;                     // 511 is the broadcast address
+  code++;
+  uint8_t data[2];
+  data[0] = 0b10000000 | (code & 0x3F);
+  data[1] = 0b10001000 | ((~code >> 2) & 0b01110000);
+  signal.packet(data, 2);
+  signal.idle();
+}
+
+
+void loop() {
+  if (dcc.input() && ((dcc.cmdType == Dcc::MyAccessoryCmd) || (dcc.cmdType == Dcc::AnyAccessoryCmd))) {
+    uint8_t number;
+    unsigned int address;
+    bool mine = expected(code, number, address);
+    if (mine != (dcc.cmdType == Dcc::MyAccessoryCmd)) errors++;
+    else if (mine && ((number != accCmd.personality) || (address != accCmd.decoderAddress))) errors++;
+    else if (mine) commands[number]++;
+  }
+}
+
+
+int main() {
+  sim.addSource(&track);
+  track.refill = traffic;
+  code = 65535;                                // The first command is for address code 0
+  dcc.attach(dccPin);
+  for (uint8_t p = 0; p < AccPersonalities; p++)
+    accCmd.setPersonality(p, board[p].first, board[p].last, board[p].master, board[p].type);
+  sim.run(loop, 10000000UL, 10);
+  printf("Personality  Decoders  Variant  Output  Commands\n");
+  for (uint8_t p = 0; p < AccPersonalities; p++)
+    printf("%11u  %3u-%-3u   %-7s  %-6s  %8u\n", p, board[p].first, board[p].last,
+      (board[p].master == Roco) ? "Roco" : (board[p].master == Lenz) ? "Lenz" : "OpenDCC",
+      types[board[p].type], commands[p]);
+  printf("Mismatches with a search through all ranges: %u\n", errors);
+  return 0;
+}
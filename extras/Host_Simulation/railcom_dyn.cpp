@@ -0,0 +1,117 @@
+//******************************************************************************************************
+//
+// file:      railcom_dyn.cpp
+// purpose:   Shows the RailCom channel 2 answers with dynamic variables (RAILCOM)
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// The command station sends speed commands to locos 3, 4, 5 and 6, of which a certain percentage
+// (default 5, or the first command line argument) is corrupted. The decoder has address 3, and also
+// reports a temperature. After each answer, the six channel 2 bytes are 4/8 decoded and checked.
+// At the end the program prints how many answers were sent (and should have been sent), and the last
+// value of each variable. Since a host has no USART, the library hands over each answer at once.
+// Compile with -DRAILCOM.
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include "Arduino.h"
+#include "DccSignal.h"
+#include "AP_DCC_library.h"
+#include "sup_loco.h"
+#include "sup_railcom.h"
+
+extern Dcc dcc;
+extern Loco locoCmd;
+extern RailCom railcom;
+
+const uint8_t dccPin = 2;
+const uint8_t code48[64] = {
+  0xAC, 0xAA, 0xA9, 0xA5, 0xA3, 0xA6, 0x9C, 0x9A, 0x99, 0x95, 0x93, 0x96, 0x8E, 0x8D, 0x8B, 0xB1,
+  0xB2, 0xB4, 0xB8, 0x74, 0x72, 0x6C, 0x6A, 0x69, 0x65, 0x63, 0x66, 0x5C, 0x5A, 0x59, 0x55, 0x53,
+  0x56, 0x4E, 0x4D, 0x4B, 0x47, 0x71, 0xE8, 0xE4, 0xE2, 0xD1, 0xC9, 0xC5, 0xD8, 0xD4, 0xD2, 0xCA,
+  0xC6, 0xCC, 0x78, 0x17, 0x1B, 0x1D, 0x1E, 0x2E, 0x36, 0x3A, 0x27, 0x2B, 0x2D, 0x35, 0x39, 0x33
+};
+
+DccSignal track(dccPin);
+unsigned errorRate = 5;
+uint32_t packets;
+uint32_t corrupted;
+uint32_t forMe;                                    // Correct packets to loco 3
+bool pending;                                      // The packet being sent is one of these
+uint16_t replies;
+uint32_t invalid;                                  // Answers that could not be decoded
+int16_t lastValue[64];                             // Per subindex; -1: never received
+uint32_t received[64];
+
+
+void traffic(DccSignal &signal) {
+  if (pending) forMe++;                            // Counted once it was sent completely
+  uint8_t loco = 3 + (packets % 4);
+  uint8_t data[4] = {loco, 0b00111111, (uint8_t)(0x80 | (packets % 100)), 0};
+  data[3] = data[0] ^ data[1] ^ data[2];
+  packets++;
+  if ((unsigned)(rand() % 100) < errorRate) {
+    data[1 + rand() % 2] ^= 1 << (rand() % 8);     // The XOR is not corrected
+    corrupted++;
+  }
+  pending = ((data[3] == (data[0] ^ data[1] ^ data[2])) && (loco == 3));
+  signal.rawPacket(data, 4);
+}
+
+
+int8_t decode(uint8_t code) {
+  for (uint8_t i = 0; i < 64; i++) if (code48[i] == code) return i;
+  return -1;
+}
+
+
+void check(const uint8_t *reply) {
+  for (uint8_t d = 0; d < 2; d++) {
+    int8_t s0 = decode(reply[3 * d]);
+    int8_t s1 = decode(reply[3 * d + 1]);
+    int8_t s2 = decode(reply[3 * d + 2]);
+    if ((s0 < 0) || (s1 < 0) || (s2 < 0) || ((s0 >> 2) != 7)) {
+      invalid++;
+      continue;
+    }
+    uint8_t value = ((s0 & 0x03) << 6) | s1;
+    lastValue[s2] = value;
+    received[s2]++;
+  }
+}
+
+
+void loop() {
+  if (dcc.input()) {
+    if (railcom.replies() != replies) {
+      replies = railcom.replies();
+      check(railcomMessage.reply);
+    }
+    if (dcc.cmdType == Dcc::MyLocoSpeedCmd) railcom.setTemperature(20 + locoCmd.speed / 10);
+  }
+}
+
+
+int main(int argc, char *argv[]) {
+  if (argc > 1) errorRate = atoi(argv[1]);
+  srand(1);
+  for (uint8_t i = 0; i < 64; i++) lastValue[i] = -1;
+  sim.addSource(&track);
+  track.idle();                                    // The decoder misses the start of the signal
+  track.refill = traffic;
+  dcc.attach(dccPin);
+  locoCmd.setMyAddress(3);
+  railcom.attach();
+  sim.run(loop, 60000000UL, 10);                   // One minute
+  printf("Packets sent:         %u (%u corrupted)\n", packets, corrupted);
+  printf("Channel 2 answers:    %u (correct packets to loco 3: %u)\n", replies, forMe);
+  printf("Invalid datagrams:    %u\n", invalid);
+  printf("Subindex  Received  Last value\n");
+  for (uint8_t i = 0; i < 64; i++)
+    if (received[i]) printf("%8u  %8u  %10d\n", i, received[i], lastValue[i]);
+  return 0;
+}
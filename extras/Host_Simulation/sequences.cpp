@@ -0,0 +1,146 @@
+//******************************************************************************************************
+//
+// file:      sequences.cpp
+// purpose:   Runs many sequences (SEQUENCES) at the same time, and checks their timing
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// During ten virtual minutes the command station sends commands for four turnouts (decoder address
+// 10) and, sometimes, shortly after such a command, a command for the signal that protects them
+// (decoder address 11). Each turnout command starts a sequence: the coil is switched on for 50 ms,
+// a servo sequence moves the point in 10 steps of 20 ms, and then the sequence waits for the signal
+// command, at most one second. If it doesn't come, the signal is set to red. In between the DCC
+// signal carries loco traffic. The program checks that each wait ends on time, that no command got
+// lost, and prints how the sequences ended.
+// Compile with -DSEQUENCES.
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include "Arduino.h"
+#include "DccSignal.h"
+#include "AP_DCC_library.h"
+
+extern Dcc dcc;
+extern Accessory accCmd;
+extern Sequencer sequencer;
+
+const uint8_t dccPin = 2;
+const uint8_t turnoutDecoder = 10;
+const uint8_t signalDecoder = 11;
+
+DccSignal track(dccPin);
+uint8_t position[4];
+unsigned long nextCommand = 200;
+unsigned long signalDue;                           // 0: no signal command planned
+uint32_t sent, received, refused, servoRefused;
+uint32_t started, bySignal, byTimeout, late, servoSteps;
+unsigned long maxLate;
+
+
+void accessory(uint16_t decoder, uint8_t port, uint8_t pos) {
+  uint16_t raw = decoder + 1;                      // myMaster = Lenz
+  uint8_t data[2] = {(uint8_t)(0x80 | (raw & 0x3F)),
+                     (uint8_t)(0x80 | ((~raw >> 2) & 0x70) | 0x08 | (port << 1) | pos)};
+  for (uint8_t i = 0; i < 4; i++) track.packet(data, 2);
+  sent++;
+}
+
+
+void traffic(DccSignal &signal) {
+  unsigned long now = millis();
+  if (now >= nextCommand) {
+    uint8_t t = rand() % 4;
+    position[t] ^= 1;
+    accessory(turnoutDecoder, t, position[t]);
+    nextCommand = now + 100 + rand() % 1500;
+    if (rand() % 2) signalDue = now + 300 + rand() % 1000;
+    return;
+  }
+  if (signalDue && (now >= signalDue)) {
+    accessory(signalDecoder, 0, rand() % 2);
+    signalDue = 0;
+    return;
+  }
+  uint8_t loco[3] = {(uint8_t)(1 + rand() % 100), 0x3F, (uint8_t)(rand() & 0xFF)};
+  signal.packet(loco, 3);
+}
+
+
+void checkTime(unsigned long due) {
+  // A wait ends at the first dcc.input() at or after the moment it should end
+  unsigned long now = millis();
+  if (now > due + 1) {
+    late++;
+    if (now - due > maxLate) maxLate = now - due;
+  }
+}
+
+
+void servo(Sequence &seq) {
+  static unsigned long step[SequenceFrames];       // Local variables lose their value while waiting
+  SEQ_BEGIN(seq);
+  for (seq.var[0] = 0; seq.var[0] < 10; seq.var[0]++) {
+    servoSteps++;                                  // Here the servo would move one step
+    step[seq.number] = millis();
+    SEQ_WAIT_MS(seq, 20);
+    checkTime(step[seq.number] + 20);
+  }
+  SEQ_END(seq);
+}
+
+
+void turnout(Sequence &seq) {
+  static unsigned long coilOn[SequenceFrames];
+  SEQ_BEGIN(seq);
+  coilOn[seq.number] = millis();                   // Coil on
+  SEQ_WAIT_MS(seq, 50);
+  checkTime(coilOn[seq.number] + 50);              // Coil off
+  seq.var[0] = sequencer.start(servo, seq.arg);    // Same as SEQ_CALL, but counts refusals
+  if (seq.var[0] == NoSequence) servoRefused++;
+  SEQ_WAIT_SEQUENCE(seq, seq.var[0]);
+  while (true) {
+    SEQ_WAIT_CMD_MS(seq, Dcc::MyAccessoryCmd, 1000);
+    if (seq.timedOut) {
+      byTimeout++;                                 // Signal to red
+      break;
+    }
+    if (accCmd.decoderAddress == signalDecoder) {
+      bySignal++;                                  // Signal as commanded
+      break;
+    }
+  }
+  SEQ_END(seq);
+}
+
+
+void loop() {
+  if (dcc.input() && (dcc.cmdType == Dcc::MyAccessoryCmd)) {
+    received++;
+    if (accCmd.decoderAddress == turnoutDecoder) {
+      if (sequencer.start(turnout, accCmd.turnout) == NoSequence) refused++;
+        else started++;
+    }
+  }
+}
+
+
+int main() {
+  srand(1);
+  sim.addSource(&track);
+  track.idle();
+  track.refill = traffic;
+  dcc.attach(dccPin);
+  accCmd.setMyAddress(turnoutDecoder, signalDecoder);
+  sim.run(loop, 600000000ULL, 10);                 // Ten minutes
+  printf("Accessory commands sent: %u, received: %u\n", sent, received);
+  printf("Sequences started: %u, refused (all %u frames in use): %u\n", started, SequenceFrames, refused);
+  printf("Ended by the signal command: %u, by the timeout: %u, still running: %u\n", bySignal, byTimeout,
+         SequenceFrames - sequencer.free());
+  printf("Servo sequences refused: %u, servo steps: %u\n", servoRefused, servoSteps);
+  printf("Waits that ended late: %u (at most %lu ms)\n", late, maxLate);
+  return 0;
+}
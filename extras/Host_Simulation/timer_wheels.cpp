@@ -0,0 +1,122 @@
+//******************************************************************************************************
+//
+// file:      timer_wheels.cpp
+// purpose:   Checks the timer wheels of the time base (TIME_BASE) against the expected expiry times
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// All TimeBaseTimers timers are created. During one virtual hour, the sketch randomly starts timers
+// (one-shot or periodic, from 1 ms upto a minute), restarts and stops them, and sometimes blocks the
+// main loop for upto 50 ms. Each callback checks that it is called at the millisecond the timer
+// should expire. The program prints how often timers fired, and how many of these were not on time.
+// Compile with -DTIME_BASE.
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include "Arduino.h"
+#include "AP_DCC_library.h"
+
+extern Dcc dcc;
+extern TimeBase timeBase;
+
+#if (TimeBaseTimers > 8)
+#error "This program has callbacks for upto 8 timers"
+#endif
+
+const uint8_t dccPin = 2;
+
+struct Expected {
+  uint8_t timer;
+  bool running;
+  unsigned long expires;
+  unsigned int period;
+  uint32_t fired;
+};
+
+Expected expected[TimeBaseTimers];
+uint32_t fired;
+uint32_t late;
+uint32_t wrongState;                               // running() differs from the expected state
+uint32_t early;
+uint32_t blocked;
+
+
+void check(uint8_t i) {
+  Expected &e = expected[i];
+  fired++;
+  e.fired++;
+  if (!e.running) early++;                         // Should not have fired at all
+  else if (timeBase.now() > e.expires) late++;
+  else if (timeBase.now() < e.expires) early++;
+  if (e.period) e.expires += e.period;
+    else e.running = false;
+}
+
+
+// The callbacks have no parameters; one per timer
+void fired0() { check(0); }
+void fired1() { check(1); }
+void fired2() { check(2); }
+void fired3() { check(3); }
+void fired4() { check(4); }
+void fired5() { check(5); }
+void fired6() { check(6); }
+void fired7() { check(7); }
+void (*callbacks[8])(void) = {fired0, fired1, fired2, fired3, fired4, fired5, fired6, fired7};
+
+
+unsigned int randomDelay() {
+  switch (rand() % 3) {
+    case 0: return rand() % 10;                     // Wheel 0 (0 is handled as 1 ms)
+    case 1: return rand() % 100;                    // Wheel 1
+    default: return rand() % 60000;                 // Wheel 2, upto a minute
+  }
+}
+
+
+void loop() {
+  dcc.input();                                     // Advances the time base
+  int r = rand() % 10000;
+  if (r < 50) {                                    // (Re)start a timer
+    Expected &e = expected[rand() % TimeBaseTimers];
+    unsigned int ms = randomDelay();
+    unsigned int period = (rand() % 2) ? (randomDelay() + 1) : 0;
+    timeBase.start(e.timer, ms, period);
+    e.running = true;
+    e.expires = timeBase.now() + ((ms == 0) ? 1 : ms);
+    e.period = period;
+  }
+  else if (r < 70) {                               // Stop a timer
+    Expected &e = expected[rand() % TimeBaseTimers];
+    timeBase.stop(e.timer);
+    e.running = false;
+  }
+  else if (r < 71) {                               // Block the main loop
+    delay(rand() % 50);
+    blocked++;
+  }
+  for (uint8_t i = 0; i < TimeBaseTimers; i++) {
+    if (timeBase.running(expected[i].timer) != expected[i].running) wrongState++;
+  }
+}
+
+
+int main() {
+  srand(1);
+  dcc.attach(dccPin);
+  for (uint8_t i = 0; i < TimeBaseTimers; i++) {
+    expected[i].timer = timeBase.create(callbacks[i]);
+    if (expected[i].timer == NoTimer) printf("Timer %u could not be created\n", i);
+  }
+  if (timeBase.create(fired0) != NoTimer) printf("More than TimeBaseTimers timers could be created\n");
+  sim.run(loop, 3600000000ULL, 10);                // One hour
+  printf("Time base after one hour: %lu ms, main loop blocked %u times\n", timeBase.now(), blocked);
+  printf("Timer  Fired\n");
+  for (uint8_t i = 0; i < TimeBaseTimers; i++) printf("%5u  %5u\n", i, expected[i].fired);
+  printf("Fired %u times, too early %u, too late %u, wrong running() %u\n", fired, early, late, wrongState);
+  return 0;
+}
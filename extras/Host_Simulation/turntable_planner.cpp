@@ -0,0 +1,152 @@
+//******************************************************************************************************
+//
+// file:      turntable_planner.cpp
+// purpose:   Replays the StepPlanner of the Accessory-Turntable_Stepper example over a range of
+//            distances and re-plans, and checks that each motion ends exactly at its target
+// author:    Aiko Pras
+// version:   2026-10-19 V1.0 ap initial version
+//
+// usage:     turntable_planner [-r maxStepRate] [-m minStepRate] [-a acceleration] [-f mhz]
+//                              [-d maxDistance]
+//
+//            The defaults are those of the sketch (20 kHz, 200 Hz, 200000 steps/s^2, 24 MHz). The
+//            program first moves from standstill over each distance from 1 to maxDistance, in both
+//            directions. The motion must end at the target, without passing it. Then, for several
+//            distances, the target is changed after each possible number of steps: further away,
+//            closer by, or behind. If the turntable can still stop in time (the steps left are at
+//            least the steps needed to decelerate), it must not pass the new target either;
+//            otherwise it may pass the target, but must return to it. The program prints the ramp,
+//            the move times for some distances and the number of errors. The exit code is 1 if an
+//            error was found.
+//
+// compile:   g++ -O2 -std=c++11 extras/Host_Simulation/turntable_planner.cpp -o turntable_planner
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../examples/Accessory-Turntable_Stepper/StepPlanner.h"
+
+float maxStepRate = 20000.0;
+float minStepRate = 200.0;
+float acceleration = 200000.0;
+unsigned int mhz = 24;                             // TCA0 prescaler is 8, as in the sketch
+int32_t maxDistance = 3000;
+
+StepPlanner planner;
+uint16_t *ramp;
+float ticksPerSecond;
+
+unsigned int moves;
+unsigned int errors;
+
+
+// Runs the planner until it has arrived. Before step number replanAt the target changes to
+// newTarget. Returns the number of ticks; passed tells how far the position got beyond the target.
+double run(int32_t target, int32_t replanAt, int32_t newTarget, int32_t &passed, int32_t &stopSteps) {
+  planner.target = target;
+  planner.start();
+  passed = 0;
+  stopSteps = 0;
+  double ticks = 0;
+  int32_t steps = 0;
+  for (;;) {
+    if (steps == replanAt) {
+      planner.target = newTarget;
+      stopSteps = planner.rampIndex;
+    }
+    int8_t direction = planner.direction;
+    StepPlanner::Result_t result = planner.next();
+    steps++;
+    int32_t beyond = (planner.position - planner.target) * direction;
+    if (beyond > passed) passed = beyond;
+    if (result == StepPlanner::arrived) break;
+    ticks += planner.period();
+    if (steps > 10 * (maxDistance + 2 * planner.rampLength) + 100) {
+      printf("Target %d not reached\n", planner.target);
+      errors++;
+      break;
+    }
+  }
+  planner.direction = 0;
+  moves++;
+  return ticks;
+}
+
+
+void check(int32_t from, int32_t target, int32_t passed, bool mayPass) {
+  if ((planner.position == target) && ((passed == 0) || mayPass)) return;
+  if (errors < 10) printf("Error: from %d to %d ended at %d, passed the target by %d steps\n",
+    from, target, planner.position, passed);
+  errors++;
+}
+
+
+int main(int argc, char *argv[]) {
+  for (int i = 1; i < argc; i++) {
+    if ((argv[i][0] != '-') || (i + 1 >= argc)) {
+      fprintf(stderr, "usage: %s [-r maxStepRate] [-m minStepRate] [-a acceleration] [-f mhz] "
+        "[-d maxDistance]\n", argv[0]);
+      return 1;
+    }
+    double value = atof(argv[i + 1]);
+    switch (argv[i][1]) {
+      case 'r': maxStepRate = value; break;
+      case 'm': minStepRate = value; break;
+      case 'a': acceleration = value; break;
+      case 'f': mhz = (unsigned int) value; break;
+      case 'd': maxDistance = (int32_t) value; break;
+      default: fprintf(stderr, "unknown option %s\n", argv[i]); return 1;
+    }
+    i++;
+  }
+  // The ramp table, sized as in the sketch
+  ticksPerSecond = mhz * 1000000.0 / 8;
+  uint16_t size = (uint16_t)(maxStepRate * maxStepRate / (2 * acceleration)) + 2;
+  ramp = new uint16_t[size];
+  bool reached = planner.begin(ramp, size, ticksPerSecond, minStepRate, maxStepRate, acceleration);
+  printf("Ramp table: %u entries, %u used, first step %.0f Hz, full speed %.0f Hz%s\n", size,
+    planner.rampLength, ticksPerSecond / ramp[0], ticksPerSecond / ramp[planner.rampLength - 1],
+    reached ? "" : " (maxStepRate NOT reached)");
+  if (!reached) errors++;
+  // Moves from standstill
+  int32_t passed, stopSteps;
+  for (int32_t distance = 1; distance <= maxDistance; distance++) {
+    for (int8_t sign = 1; sign >= -1; sign -= 2) {
+      planner.position = 0;
+      double ticks = run(sign * distance, -1, 0, passed, stopSteps);
+      check(0, sign * distance, passed, false);
+      if ((sign > 0) && ((distance == 1) || (distance == 10) || (distance == 100) ||
+        (distance % 1600 == 0))) printf("Distance %5d: %7.1f ms\n", distance, ticks / ticksPerSecond * 1000);
+    }
+  }
+  printf("Moves from standstill: %u, errors %u\n", moves, errors);
+  // Re-plans
+  unsigned int replans = 0;
+  unsigned int passes = 0;
+  const int32_t distances[] = {2, 3, 10, 11, 100, 101, 1600, maxDistance};
+  for (unsigned int d = 0; d < sizeof(distances) / sizeof(distances[0]); d++) {
+    int32_t distance = distances[d];
+    if (distance > maxDistance) continue;
+    for (int32_t at = 1; at < distance; at++) {
+      int32_t targets[] = {distance + 1, distance + 2, distance + 100, at + 1, at + 2, at, at - 1, -distance};
+      for (unsigned int t = 0; t < sizeof(targets) / sizeof(targets[0]); t++) {
+        planner.position = 0;
+        run(distance, at, targets[t], passed, stopSteps);
+        // At the re-plan, the position is "at" and the next step has already been planned. The
+        // target can be passed only if it is behind, or closer than the steps needed to stop
+        bool mayPass = (targets[t] - (at + 1) < stopSteps);
+        check(0, targets[t], passed, mayPass);
+        replans++;
+        if (passed) passes++;
+      }
+    }
+  }
+  printf("Re-plans: %u, of which %u passed the new target and returned, errors %u\n",
+    replans, passes, errors);
+  delete[] ramp;
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,82 @@
+#*******************************************************************************************************
+#
+# file:      __init__.py
+# purpose:   Decodes recorded DCC signals with the decoder core of the AP_DCC_library
+# author:    Aiko Pras
+# version:   2026-10-18 V1.0.0 ap initial version
+#
+# usage:     import numpy as np, ap_dcc
+#            packets, commands = ap_dcc.decode_durations(halfbits_us)
+#            packets, commands = ap_dcc.decode_samples(levels, rate=1e6)
+#            speeds = commands[commands['cmd'] == ap_dcc.CMD_TYPES.index('MyLocoSpeedCmd')]
+#
+# The decoding is done in C++ (ap_dcc_decoder.cpp). The results are numpy structured arrays with
+# the dtypes below. They share memory with the bytes objects returned by the extension, and are
+# therefore read only. Without numpy, the raw bytes and the dtype description are returned.
+#
+# This source file is subject of the GNU general public license 3,
+# that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+#
+#*******************************************************************************************************
+from . import _decoder
+
+try:
+  import numpy
+except ImportError:
+  numpy = None
+
+# Values for master (accCmd.myMaster), see AP_DCC_library.h
+ROCO = 0
+LENZ = 1
+OPENDCC = 2
+
+# Same order as Dcc::CmdType_t in AP_DCC_library.h
+CMD_TYPES = ('Unknown', 'IgnoreCmd', 'ResetCmd', 'SomeLocoSpeedFlag', 'SomeLocoMovesFlag',
+             'MyLocoSpeedCmd', 'MyEmergencyStopCmd', 'MyLocoF0F4Cmd', 'MyLocoF5F8Cmd',
+             'MyLocoF9F12Cmd', 'MyLocoF13F20Cmd', 'MyLocoF21F28Cmd', 'MyLocoF29F36Cmd',
+             'MyLocoF37F44Cmd', 'MyLocoF45F52Cmd', 'MyLocoF53F60Cmd', 'MyLocoF61F68Cmd',
+             'AnyAccessoryCmd', 'MyAccessoryCmd', 'MyPomCmd', 'SmCmd', 'OccupancyCmd')
+
+# Packet flags
+XOR_OK = 0x01               # The checksum is correct
+COMMAND = 0x02              # The packet resulted in a command (retransmissions and idle packets do not)
+
+# Command flags
+LONG_ADDRESS = 0x01
+FORWARD = 0x02
+ACTIVATE = 0x04
+EXTENDED = 0x08
+EMERGENCY_STOP = 0x10
+
+# Every packet: the moment (in us) its end bit was received, size (including XOR) and bytes
+PACKET_DTYPE = [('time', '<u8'), ('size', 'u1'), ('data', 'u1', (6,)), ('flags', 'u1')]
+
+# Every command (dcc.cmdType is not IgnoreCmd). The meaning of the fields depends on cmd:
+# - loco commands:    address = loco address, value = speed or the bits of the function group
+# - MyAccessoryCmd:   address = decoder address, number = output address,
+#                     value = position (basic) or signal head (extended), extra = device
+# - MyPomCmd / SmCmd: address = loco or decoder address (PoM), number = CV number, value = CV value,
+#                     extra = operation (1 = verify byte, 2 = bit manipulation, 3 = write byte)
+COMMAND_DTYPE = [('time', '<u8'), ('cmd', 'u1'), ('flags', 'u1'), ('address', '<u2'),
+                 ('number', '<u2'), ('value', 'u1'), ('extra', 'u1')]
+
+
+def _arrays(result):
+  packets, commands = result
+  if numpy is None:
+    return (packets, PACKET_DTYPE), (commands, COMMAND_DTYPE)
+  return (numpy.frombuffer(packets, dtype=PACKET_DTYPE),
+          numpy.frombuffer(commands, dtype=COMMAND_DTYPE))
+
+
+def decode_durations(durations, unit=1e-6, master=LENZ):
+  """Decodes an array with the durations of successive half bits (the time between two edges).
+  unit is the unit of the durations, in seconds (default us). Any one dimensional, contiguous
+  array of integers or floats can be used (numpy, array.array, memoryview)."""
+  return _arrays(_decoder.decode_durations(durations, _decoder.F_CPU * unit, master))
+
+
+def decode_samples(samples, rate, master=LENZ):
+  """Decodes an array with samples of the DCC signal (0 = low, anything else = high), such as a
+  channel of a logic analyser recording. rate is the sample rate in Hz."""
+  return _arrays(_decoder.decode_samples(samples, rate, master))
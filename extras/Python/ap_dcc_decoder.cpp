@@ -0,0 +1,318 @@
+//******************************************************************************************************
+//
+// file:      ap_dcc_decoder.cpp
+// purpose:   Python extension that decodes recorded DCC signals with the decoder core of the library
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//            2026-10-18 V1.0.1 ap Each call resets all decoder state
+//            2026-10-19 V1.0.2 ap No warnings with -Wall -Wextra
+//
+// The library is compiled for the host (AP_DCC_HOST, see extras/Host_Simulation), and the recorded
+// edges are fed directly to the capture routine of the host variant (dccHostEdge()), without the
+// virtual time simulation in between. Each time a packet is complete, dcc.input() analyses it.
+// Every packet and every command is written as a fixed size record into a bytes object; the Python
+// package (ap_dcc/__init__.py) turns these into numpy structured arrays, without copying. There is
+// therefore no Python overhead per packet.
+//
+// Since the library uses global objects, decoding is not thread safe; the GIL is kept.
+// Both functions start with a fresh decoder, in the same state as after power-up: loco speed,
+// direction and functions, the accessory repeat cache and Service Mode are reset, so decoding the
+// same signal twice gives the same result. All loco and accessory addresses are "my" addresses.
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <vector>
+#include "Arduino.h"
+#include "AP_DCC_library.h"
+#include "sup_isr.h"
+#include "sup_acc.h"
+#include "sup_loco.h"
+#include "sup_cv.h"
+
+extern Dcc dcc;
+extern Accessory accCmd;
+extern Loco locoCmd;
+extern CvAccess cvCmd;
+extern DccMessage dccMessage;
+extern AccMessage accMessage;
+extern LocoMessage locoMessage;
+extern CvMessage cvMessage;
+void dccHostEdge(uint64_t edgeTime);             // sup_isr_Host.h
+
+const uint8_t dccPin = 2;
+
+// Record layouts. These must be equal to PACKET_DTYPE and COMMAND_DTYPE in ap_dcc/__init__.py
+#define PacketRecordSize   16                    // time u8, size u1, data u1[6], flags u1
+#define CommandRecordSize  16                    // time u8, cmd u1, flags u1, address u2, number u2,
+                                                 // value u1, extra u1
+#define FlagXorOk          0x01                  // Packet: checksum is correct
+#define FlagCommand        0x02                  // Packet: resulted in a command record
+#define FlagLongAddress    0x01                  // Command: loco used a 14 bit address
+#define FlagForward        0x02                  // Command: loco direction
+#define FlagActivate       0x04                  // Command: accessory output activated
+#define FlagExtended       0x08                  // Command: extended accessory command
+#define FlagEmergencyStop  0x10                  // Command: loco emergency stop
+
+struct Decoder {
+  std::vector<uint8_t> packets;
+  std::vector<uint8_t> commands;
+};
+
+
+//******************************************************************************************************
+// Records
+//******************************************************************************************************
+static void put16(uint8_t *p, uint16_t value) {
+  p[0] = value & 0xFF;
+  p[1] = value >> 8;
+}
+
+
+static void put64(uint8_t *p, uint64_t value) {
+  for (uint8_t i = 0; i < 8; i++) p[i] = (value >> (8 * i)) & 0xFF;
+}
+
+
+static void addCommand(Decoder &decoder, uint64_t us) {
+  uint8_t r[CommandRecordSize] = {0};
+  bool accessory = ((dccMessage.data[0] & 0b11000000) == 0b10000000);
+  put64(r, us);
+  r[8] = dcc.cmdType;
+  switch (dcc.cmdType) {
+    case Dcc::MyAccessoryCmd:
+      if (accCmd.command == Accessory::extended) r[9] |= FlagExtended;
+      if (accCmd.activate) r[9] |= FlagActivate;
+      put16(r + 10, accCmd.decoderAddress);
+      put16(r + 12, accCmd.outputAddress);
+      r[14] = (accCmd.command == Accessory::extended) ? accCmd.signalHead : accCmd.position;
+      r[15] = accCmd.device;
+      break;
+    case Dcc::MyPomCmd:
+      put16(r + 10, accessory ? accCmd.decoderAddress : locoCmd.address);
+      if (!accessory && locoCmd.longAddress) r[9] |= FlagLongAddress;
+      put16(r + 12, cvCmd.number);
+      r[14] = cvCmd.value;
+      r[15] = cvCmd.operation;
+      break;
+    case Dcc::SmCmd:
+      put16(r + 12, cvCmd.number);
+      r[14] = cvCmd.value;
+      r[15] = cvCmd.operation;
+      break;
+    case Dcc::ResetCmd:
+      break;
+    default:                                     // Loco speed and function commands
+      put16(r + 10, locoCmd.address);
+      if (locoCmd.longAddress) r[9] |= FlagLongAddress;
+      if (locoCmd.forward) r[9] |= FlagForward;
+      if (locoCmd.emergencyStop) r[9] |= FlagEmergencyStop;
+      switch (dcc.cmdType) {
+        case Dcc::MyLocoF0F4Cmd:   r[14] = locoCmd.F0F4;   break;
+        case Dcc::MyLocoF5F8Cmd:   r[14] = locoCmd.F5F8;   break;
+        case Dcc::MyLocoF9F12Cmd:  r[14] = locoCmd.F9F12;  break;
+        case Dcc::MyLocoF13F20Cmd: r[14] = locoCmd.F13F20; break;
+        case Dcc::MyLocoF21F28Cmd: r[14] = locoCmd.F21F28; break;
+        case Dcc::MyLocoF29F36Cmd: r[14] = locoCmd.F29F36; break;
+        case Dcc::MyLocoF37F44Cmd: r[14] = locoCmd.F37F44; break;
+        case Dcc::MyLocoF45F52Cmd: r[14] = locoCmd.F45F52; break;
+        case Dcc::MyLocoF53F60Cmd: r[14] = locoCmd.F53F60; break;
+        case Dcc::MyLocoF61F68Cmd: r[14] = locoCmd.F61F68; break;
+        default:                   r[14] = locoCmd.speed;  break;
+      }
+      break;
+  }
+  decoder.commands.insert(decoder.commands.end(), r, r + CommandRecordSize);
+}
+
+
+static void addPacket(Decoder &decoder, uint64_t us, bool command) {
+  uint8_t r[PacketRecordSize] = {0};
+  uint8_t x = 0;
+  put64(r, us);
+  r[8] = dccMessage.size;
+  for (uint8_t i = 0; (i < dccMessage.size) && (i < MaxDccSize); i++) {
+    r[9 + i] = dccMessage.data[i];
+    x ^= dccMessage.data[i];
+  }
+  if (x == 0) r[15] |= FlagXorOk;
+  if (command) r[15] |= FlagCommand;
+  decoder.packets.insert(decoder.packets.end(), r, r + PacketRecordSize);
+}
+
+
+//******************************************************************************************************
+// Decoding
+//******************************************************************************************************
+static void start(uint8_t master) {
+  sim.reset();
+  dcc.attach(dccPin);
+  accCmd.myMaster = master;
+  accCmd.setMyAddress(0, 511);
+  accMessage.setRepeatCache(1);                  // Empties the repeat cache
+  locoCmd.setMyAddress(1, 10239);
+  locoCmd.address = 65535;                       // As set by the LocoMessage constructor
+  locoCmd.longAddress = false;
+  locoCmd.emergencyStop = false;
+  locoMessage.reset_speed();                     // Speed, direction, F0..F28
+  locoCmd.F29F36 = 0;
+  locoCmd.F37F44 = 0;
+  locoCmd.F45F52 = 0;
+  locoCmd.F53F60 = 0;
+  locoCmd.F61F68 = 0;
+  cvMessage.inServiceMode = false;
+}
+
+
+static void edge(Decoder &decoder, uint64_t ticks) {
+  // Same as an interrupt at this moment; dcc.input() uses the virtual time for Service Mode timeouts
+  dccHostEdge(ticks);
+  if (!dccMessage.isReady) return;
+  sim.advanceTo(ticks);
+  dcc.input();
+  bool command = (dcc.cmdType != Dcc::IgnoreCmd) && (dcc.cmdType != Dcc::Unknown);
+  uint64_t us = ticks / (F_CPU / 1000000UL);
+  addPacket(decoder, us, command);
+  if (command) addCommand(decoder, us);
+}
+
+
+template <typename T>
+static void decodeDurations(Decoder &decoder, const T *duration, Py_ssize_t n, double ticksPerUnit) {
+  double time = 0;
+  for (Py_ssize_t i = 0; i < n; i++) {
+    time += duration[i] * ticksPerUnit;
+    edge(decoder, (uint64_t)(time + 0.5));
+  }
+}
+
+
+template <typename T>
+static void decodeSamples(Decoder &decoder, const T *sample, Py_ssize_t n, double ticksPerSample) {
+  if (n == 0) return;
+  bool level = (sample[0] != 0);
+  for (Py_ssize_t i = 1; i < n; i++) {
+    if ((sample[i] != 0) == level) continue;
+    level = !level;
+    edge(decoder, (uint64_t)(i * ticksPerSample + 0.5));
+  }
+}
+
+
+// Calls the decode template for the element type of the buffer
+#define DISPATCH(function, view, factor)                                                          \
+  switch (format) {                                                                               \
+    case 'b': function(decoder, (const int8_t *) view.buf, count, factor); break;                \
+    case 'B': case '?': function(decoder, (const uint8_t *) view.buf, count, factor); break;     \
+    case 'h': function(decoder, (const int16_t *) view.buf, count, factor); break;               \
+    case 'H': function(decoder, (const uint16_t *) view.buf, count, factor); break;              \
+    case 'i': function(decoder, (const int32_t *) view.buf, count, factor); break;               \
+    case 'I': function(decoder, (const uint32_t *) view.buf, count, factor); break;              \
+    case 'q': function(decoder, (const int64_t *) view.buf, count, factor); break;               \
+    case 'Q': function(decoder, (const uint64_t *) view.buf, count, factor); break;              \
+    case 'f': function(decoder, (const float *) view.buf, count, factor); break;                 \
+    case 'd': function(decoder, (const double *) view.buf, count, factor); break;                \
+  }
+
+
+static char elementType(Py_buffer &view) {
+  // Returns the struct format character of a one dimensional buffer, or 0 if not supported.
+  // 'l' and 'L' are mapped on their fixed size equivalents
+  const char *f = view.format ? view.format : "B";
+  if ((*f == '@') || (*f == '=') || (*f == '<')) f++;
+  if (f[0] == 0 || f[1] != 0) return 0;
+  char c = f[0];
+  if ((c == 'l') || (c == 'L')) c = (view.itemsize == 8) ? ((c == 'l') ? 'q' : 'Q') : ((c == 'l') ? 'i' : 'I');
+  if ((c == 'n') || (c == 'N')) c = (view.itemsize == 8) ? ((c == 'n') ? 'q' : 'Q') : ((c == 'n') ? 'i' : 'I');
+  if (strchr("bB?hHiIqQfd", c) == 0) return 0;
+  return c;
+}
+
+
+static PyObject *result(Decoder &decoder) {
+  return Py_BuildValue("(y#y#)",
+    (const char *) decoder.packets.data(), (Py_ssize_t) decoder.packets.size(),
+    (const char *) decoder.commands.data(), (Py_ssize_t) decoder.commands.size());
+}
+
+
+static PyObject *decode_durations(PyObject *self, PyObject *args) {
+  (void) self;                                   // Module function: self is the module
+  PyObject *object;
+  double ticksPerUnit = F_CPU / 1000000.0;       // Default unit: microseconds
+  unsigned char master = Lenz;
+  if (!PyArg_ParseTuple(args, "O|db", &object, &ticksPerUnit, &master)) return NULL;
+  Py_buffer view;
+  if (PyObject_GetBuffer(object, &view, PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) < 0) return NULL;
+  char format = elementType(view);
+  if (format == 0) {
+    PyBuffer_Release(&view);
+    PyErr_SetString(PyExc_TypeError, "durations must be a one dimensional array of numbers");
+    return NULL;
+  }
+  Py_ssize_t count = view.len / view.itemsize;
+  Decoder decoder;
+  decoder.packets.reserve(count / 20 * PacketRecordSize);
+  start(master);
+  DISPATCH(decodeDurations, view, ticksPerUnit)
+  PyBuffer_Release(&view);
+  return result(decoder);
+}
+
+
+static PyObject *decode_samples(PyObject *self, PyObject *args) {
+  (void) self;
+  PyObject *object;
+  double rate;
+  unsigned char master = Lenz;
+  if (!PyArg_ParseTuple(args, "Od|b", &object, &rate, &master)) return NULL;
+  if (rate <= 0) {
+    PyErr_SetString(PyExc_ValueError, "the sample rate must be positive");
+    return NULL;
+  }
+  Py_buffer view;
+  if (PyObject_GetBuffer(object, &view, PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) < 0) return NULL;
+  char format = elementType(view);
+  if (format == 0) {
+    PyBuffer_Release(&view);
+    PyErr_SetString(PyExc_TypeError, "samples must be a one dimensional array of numbers");
+    return NULL;
+  }
+  Py_ssize_t count = view.len / view.itemsize;
+  Decoder decoder;
+  start(master);
+  DISPATCH(decodeSamples, view, F_CPU / rate)
+  PyBuffer_Release(&view);
+  return result(decoder);
+}
+
+
+//******************************************************************************************************
+// The module
+//******************************************************************************************************
+static PyMethodDef methods[] = {
+  {"decode_durations", decode_durations, METH_VARARGS,
+   "decode_durations(durations, ticks_per_unit=16.0, master=1) -> (packets, commands) as bytes"},
+  {"decode_samples", decode_samples, METH_VARARGS,
+   "decode_samples(samples, rate, master=1) -> (packets, commands) as bytes"},
+  {NULL, NULL, 0, NULL}
+};
+
+
+static struct PyModuleDef module = {
+  PyModuleDef_HEAD_INIT, "_decoder", "DCC decoder core of the AP_DCC_library", -1, methods,
+  NULL, NULL, NULL, NULL                         // No slots, traverse, clear or free
+};
+
+
+PyMODINIT_FUNC PyInit__decoder(void) {
+  PyObject *m = PyModule_Create(&module);
+  if (m == NULL) return NULL;
+  PyModule_AddIntConstant(m, "F_CPU", F_CPU);
+  PyModule_AddIntConstant(m, "PACKET_RECORD_SIZE", PacketRecordSize);
+  PyModule_AddIntConstant(m, "COMMAND_RECORD_SIZE", CommandRecordSize);
+  return m;
+}
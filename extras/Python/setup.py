@@ -0,0 +1,42 @@
+#*******************************************************************************************************
+#
+# file:      setup.py
+# purpose:   Builds the ap_dcc Python package, with the decoder core of the AP_DCC_library
+# author:    Aiko Pras
+# version:   2026-10-18 V1.0.0 ap initial version
+#
+# usage:     cd extras/Python
+#            pip install .                       (or: python3 setup.py build_ext --inplace)
+#
+# The extension is compiled from the library sources (src/*.cpp) and the Arduino shim of
+# extras/Host_Simulation, with AP_DCC_HOST defined. Changes to the library therefore become
+# available to Python after a rebuild.
+#
+# This source file is subject of the GNU general public license 3,
+# that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+#
+#*******************************************************************************************************
+import glob
+import os
+from setuptools import setup, Extension
+
+here = os.path.dirname(os.path.abspath(__file__))    # Absolute: objects stay in build/
+library = os.path.join(here, '..', '..', 'src')
+shim = os.path.join(here, '..', 'Host_Simulation')
+
+decoder = Extension(
+  'ap_dcc._decoder',
+  sources=[os.path.join(here, 'ap_dcc_decoder.cpp'), os.path.join(shim, 'Arduino.cpp')] +
+          sorted(glob.glob(os.path.join(library, '*.cpp'))),
+  include_dirs=[shim, library],                 # The shim must come first (Arduino.h)
+  define_macros=[('AP_DCC_HOST', None)],
+  extra_compile_args=['-std=c++11', '-O2'],
+  language='c++')
+
+setup(
+  name='ap_dcc',
+  version='1.0.0',
+  description='Decodes recorded DCC signals with the decoder core of the AP_DCC_library',
+  license='GPL-3.0',
+  packages=['ap_dcc'],
+  ext_modules=[decoder])
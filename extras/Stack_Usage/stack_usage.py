@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+#*******************************************************************************************************
+#
+# file:      stack_usage.py
+# purpose:   Worst case (static) stack usage of dcc.input() and the ISRs, from avr-gcc -fstack-usage
+# author:    Aiko Pras
+# version:   2026-10-18 V1.0.0 ap initial version
+#
+# avr-gcc -fstack-usage writes for every compiled file a .su file, with the stack frame of each
+# function (including saved registers and the return address). The worst case stack of a function
+# is its own frame plus the worst case of the functions it calls. The calls are taken from the
+# disassembly (avr-objdump) of the final .elf file, so functions that were inlined or removed by the
+# linker are handled correctly.
+#
+# usage:     Compile the sketch with the extra flags "-fstack-usage -fno-lto", for example:
+#              arduino-cli compile --fqbn MegaCoreX:megaavr:4808 --build-path build \
+#                --build-property "compiler.c.extra_flags=-fstack-usage -fno-lto" \
+#                --build-property "compiler.cpp.extra_flags=-fstack-usage -fno-lto" MySketch
+#              python3 stack_usage.py build
+#            Or let this script call arduino-cli:
+#              python3 stack_usage.py --fqbn MegaCoreX:megaavr:4808 --sketch MySketch build
+#            LTO must be switched off, since with LTO the compiler writes no .su files per source
+#            file. Without LTO the compiler inlines a bit less, so the numbers are slightly pessimistic.
+#
+# The report shows the worst case for dcc.input(), for each ISR (__vector_N), and for any extra
+# function given with --root. The RAM the library needs on top of the stack of the sketch, at the
+# place where dcc.input() is called, is dcc.input() plus the largest ISR: ISRs are not nested on AVR,
+# except for a level 1 ISR on megaAVR 0 / AVR Dx (DCC_ISR_LEVEL1), which may come on top.
+# Indirect calls (function pointers, virtual functions), recursion and dynamic stack frames can not
+# be determined statically; functions that contain them are marked.
+#
+# This source file is subject of the GNU general public license 3,
+# that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+#
+#*******************************************************************************************************
+import argparse
+import glob
+import os
+import re
+import subprocess
+import sys
+
+SU_LINE = re.compile(r'^(.*):(\d+):(\d+):(.*)\t(\d+)\t(\S+)$')
+FUNCTION = re.compile(r'^[0-9a-f]+ <(.+)>:$')
+CALL = re.compile(r'\s(call|rcall|jmp|rjmp)\s.*<([^>]+)>\s*$')
+INDIRECT = re.compile(r'\s(icall|eicall|ijmp|eijmp)\b|\scall\s+\*')
+
+
+def normalise(name):
+  # "Dcc::CmdType_t LocoMessage::analyse()" and "LocoMessage::analyse()" -> "LocoMessage::analyse"
+  name = name.split('(')[0].strip()
+  depth = 0
+  start = 0
+  for i, c in enumerate(name):
+    if c == '<':
+      depth += 1
+    elif c == '>':
+      depth -= 1
+    elif (c == ' ') and (depth == 0):
+      start = i + 1
+  return name[start:]
+
+
+def read_su(build):
+  frames = {}                                       # name -> (bytes, qualifier)
+  for path in glob.glob(os.path.join(build, '**', '*.su'), recursive=True):
+    with open(path) as f:
+      for line in f:
+        m = SU_LINE.match(line.rstrip('\n'))
+        if not m:
+          continue
+        name = normalise(m.group(4))
+        size = int(m.group(5))
+        if (name not in frames) or (frames[name][0] < size):
+          frames[name] = (size, m.group(6))
+  return frames
+
+
+def read_calls(elf, objdump):
+  calls = {}                                        # name -> set of called functions
+  indirect = set()
+  output = subprocess.run([objdump, '-d', '-C', elf], capture_output=True, text=True, check=True)
+  current = None
+  for line in output.stdout.splitlines():
+    m = FUNCTION.match(line)
+    if m:
+      current = normalise(m.group(1))
+      calls.setdefault(current, set())
+      continue
+    if current is None:
+      continue
+    m = CALL.search(line)
+    if m and ('+' not in m.group(2)):               # "<func+0x12>" is a jump within a function
+      target = normalise(m.group(2))
+      if target != current:
+        calls[current].add(target)
+      else:
+        indirect.add(current)                        # Recursion
+    elif INDIRECT.search(line):
+      indirect.add(current)
+  return calls, indirect
+
+
+def worst_case(name, frames, calls, memo, stack=()):
+  # Returns (bytes, path). Recursion is cut off (and reported by read_calls)
+  if name in memo:
+    return memo[name]
+  own = frames.get(name, (0, 'unknown'))[0]
+  best = (0, [])
+  for callee in calls.get(name, ()):
+    if callee in stack:
+      continue
+    result = worst_case(callee, frames, calls, memo, stack + (name,))
+    if result[0] > best[0]:
+      best = result
+  memo[name] = (own + best[0], [name] + best[1])
+  return memo[name]
+
+
+def remarks(path, frames, indirect):
+  notes = []
+  for name in path:
+    if name not in frames:
+      notes.append(name + ': no .su data')
+    elif frames[name][1] != 'static':
+      notes.append(name + ': ' + frames[name][1])
+    if name in indirect:
+      notes.append(name + ': indirect call or recursion')
+  return notes
+
+
+def main():
+  parser = argparse.ArgumentParser(description='Worst case stack usage of the AP_DCC_library')
+  parser.add_argument('build', help='build directory with the .su files and the .elf file')
+  parser.add_argument('--elf', help='the .elf file (default: the first .elf in the build directory)')
+  parser.add_argument('--objdump', default='avr-objdump', help='objdump to use (default avr-objdump)')
+  parser.add_argument('--root', action='append', default=[], help='extra function to report')
+  parser.add_argument('--fqbn', help='compile first with arduino-cli, for this board')
+  parser.add_argument('--sketch', help='sketch to compile with arduino-cli')
+  args = parser.parse_args()
+
+  if args.fqbn and args.sketch:
+    flags = '-fstack-usage -fno-lto'
+    subprocess.run(['arduino-cli', 'compile', '--fqbn', args.fqbn, '--build-path', args.build,
+                    '--build-property', 'compiler.c.extra_flags=' + flags,
+                    '--build-property', 'compiler.cpp.extra_flags=' + flags, args.sketch], check=True)
+
+  elf = args.elf
+  if elf is None:
+    found = glob.glob(os.path.join(args.build, '*.elf'))
+    if not found:
+      sys.exit('No .elf file found in ' + args.build)
+    elf = found[0]
+  frames = read_su(args.build)
+  if not frames:
+    sys.exit('No .su files found in ' + args.build + ' (compile with -fstack-usage -fno-lto)')
+  calls, indirect = read_calls(elf, args.objdump)
+
+  roots = ['Dcc::input'] + sorted(n for n in calls if n.startswith('__vector_')) + args.root
+  memo = {}
+  print('Worst case stack usage (bytes) of ' + os.path.basename(elf))
+  worst_isr = 0
+  for root in roots:
+    if root not in calls:
+      print('  %-28s not found' % root)
+      continue
+    size, path = worst_case(root, frames, calls, memo)
+    if root.startswith('__vector_'):
+      worst_isr = max(worst_isr, size)
+    print('  %-28s %5d   %s' % (root, size, ' -> '.join(path)))
+    for note in remarks(path, frames, indirect):
+      print('  %-28s         ! %s' % ('', note))
+  if 'Dcc::input' in memo:
+    total = memo['Dcc::input'][0] + worst_isr
+    print('dcc.input() + largest ISR:   %5d   (on top of the stack where the sketch calls dcc.input())'
+          % total)
+
+
+if __name__ == '__main__':
+  main()
@@ -4,6 +4,24 @@
 // purpose:   DCC library for ATmega AVRs (16, 328, 2560, ...)
 // author:    Aiko Pras
 // version:   2021-06-01 V1.0.2 ap initial version
+//            2026-10-18 V1.1.0 ap Occupancy detection (VOLTAGE_DETECTION)
+//            2026-10-18 V1.1.1 ap s88-N feedback slave (S88_SLAVE)
+//            2026-10-18 V1.1.2 ap Majority vote reconstruction of corrupted packets (PACKET_RECONSTRUCTION)
+//            2026-10-18 V1.1.3 ap SUSI master (SUSI_MASTER)
+//            2026-10-18 V1.1.4 ap Bytecode interpreter for user logic (LOGIC_VM)
+//            2026-10-18 V1.1.6 ap Interrupt latency monitor (ISR_LATENCY_MONITOR)
+//            2026-10-18 V1.1.7 ap Stack depth monitor (STACK_MONITOR)
+//            2026-10-18 V1.1.8 ap Packet queue (PacketQueueSize) and accessory repeat cache (AccRepeatCache)
+//            2026-10-18 V1.1.9 ap Edge delay compensation (DCC_EDGE_COMPENSATION)
+//            2026-10-18 V1.1.11 ap Flight recorder of the last packets (FLIGHT_RECORDER)
+//            2026-10-18 V1.1.12 ap Multiple accessory decoder personalities (AccPersonalities)
+//            2026-10-18 V1.1.13 ap Loco addresses are matched on the raw packet bytes
+//            2026-10-18 V1.1.14 ap Time base with hierarchical timer wheels (TIME_BASE)
+//            2026-10-18 V1.1.15 ap RailCom channel 2 feedback of dynamic variables (RAILCOM)
+//            2026-10-18 V1.1.16 ap LocoNet messages as second command input (LOCONET)
+//            2026-10-18 V1.1.17 ap Stackless sequences (coroutines) for the main sketch (SEQUENCES)
+//            2026-10-18 V1.1.18 ap The DCC input timer as clock of the library (DCC_CLOCK)
+//            2026-10-18 V1.1.19 ap Runtime change of the main clock (CLOCK_SCALING)
 //
 // history:   This is a further development of the OpenDecoder 2 software, as developed by W. Kufer.
 //            It has been rewritten, such that it can be used for Arduino (Atmel AVR) environments.
@@ -33,6 +51,35 @@
 #include "sup_acc.h"
 #include "sup_loco.h"
 #include "sup_cv.h"
+#if defined(VOLTAGE_DETECTION)
+#include "sup_occupancy.h"
+#endif
+#if defined(S88_SLAVE)
+#include "sup_s88.h"
+#endif
+#if defined(SUSI_MASTER)
+#include "sup_susi.h"
+#endif
+#if defined(LOGIC_VM)
+#include "sup_vm.h"
+#endif
+#include "sup_stack.h"
+#if defined(FLIGHT_RECORDER)
+#include "sup_recorder.h"
+#endif
+#include "sup_timer.h"
+#if defined(RAILCOM)
+#include "sup_railcom.h"
+#endif
+#if defined(LOCONET)
+#include "sup_loconet.h"
+#endif
+#if defined(SEQUENCES)
+#include "sup_sequence.h"
+#endif
+#if defined(CLOCK_SCALING)
+#include "sup_scaler.h"
+#endif
 
 // The following objects must be visible for the main sketch. These objects are declared here,
 // thus the main sketch doesn't need to bother about declaring these necessary objects itself.
@@ -42,13 +89,97 @@ Dcc           dcc;              // Interface to the main sketch
 Accessory     accCmd;           // Interface to the main sketch for accessory commands
 Loco          locoCmd;          // Interface to the main sketch for loco commands
 CvAccess      cvCmd;            // Interface to the main sketch for CV commands (POM and SM)
+#if defined(VOLTAGE_DETECTION)
+Occupancy     occupancyCmd;     // Interface to the main sketch for occupancy detection
+#endif
+#if defined(S88_SLAVE)
+S88Slave      s88;              // Interface to the main sketch for s88-N feedback
+#endif
+#if defined(SUSI_MASTER)
+SusiMaster    susi;             // Interface to the main sketch for SUSI modules
+#endif
+#if defined(LOGIC_VM)
+Logic         logic;            // Interface to the main sketch for user logic programs
+#endif
+#if defined(ISR_LATENCY_MONITOR)
+LatencyMonitor isrMonitor;      // Interface to the main sketch for the DCC ISR latency
+#endif
+#if defined(STACK_MONITOR)
+StackMonitor  stackMonitor;     // Interface to the main sketch for the stack depth
+#endif
+#if defined(FLIGHT_RECORDER)
+FlightRecorder flightRecorder;  // Interface to the main sketch for the last packets
+#endif
+#if defined(TIME_BASE)
+TimeBase      timeBase;         // Interface to the main sketch for timers
+#endif
+#if defined(RAILCOM)
+RailCom       railcom;          // Interface to the main sketch for RailCom feedback
+#endif
+#if defined(LOCONET)
+LocoNet       loconet;          // Interface to the main sketch for LocoNet input
+#endif
+#if defined(SEQUENCES)
+Sequencer     sequencer;        // Interface to the main sketch for sequences
+#endif
+#if defined(DCC_CLOCK)
+DccClock      dccClock;         // Interface to the main sketch for the time of the DCC input timer
+#endif
+#if defined(CLOCK_SCALING)
+ClockScaler   clockScaler;      // Interface to the main sketch for changes of the main clock
+#endif
 
 // The following objects should NOT be used by the main sketch, but are instead used by this
 // c++ file as interface to the various support files.
 DccMessage    dccMessage;       // Interface to sup_isr
+#if (PacketQueueSize > 1)
+DccQueue      dccQueue;         // Interface to sup_isr, packets not yet handled by input()
+#endif
 AccMessage    accMessage;       // Interface to sup_acc
 LocoMessage   locoMessage;      // Interface to sup_loco
 CvMessage     cvMessage;        // Interface to sup_cv
+#if defined(VOLTAGE_DETECTION)
+OccupancyMessage occupancyMessage; // Interface to sup_occupancy
+#endif
+#if defined(S88_SLAVE)
+S88Message    s88Message;       // Interface to sup_s88
+#endif
+#if defined(SUSI_MASTER)
+SusiMessage   susiMessage;      // Interface to sup_susi
+#endif
+#if defined(LOGIC_VM)
+LogicVm       logicVm;          // Interface to sup_vm
+#endif
+#if defined(ISR_LATENCY_MONITOR)
+extern IsrLatency isrLatency;   // Instantiated in the ISR variant (sup_isr_xxx.h)
+#endif
+#if defined(DCC_EDGE_COMPENSATION)
+extern EdgeSkew isrEdgeSkew;    // Instantiated in the ISR variant (sup_isr_xxx.h)
+#endif
+#if defined(DCC_CLOCK)
+extern CaptureClock captureClock; // Instantiated in the ISR variant (sup_isr_xxx.h)
+#endif
+#if defined(STACK_MONITOR)
+StackMessage  stackMessage;     // Interface to sup_stack
+#endif
+#if defined(FLIGHT_RECORDER)
+RecorderMessage recorderMessage; // Interface to sup_recorder
+#endif
+#if defined(TIME_BASE)
+TimerMessage  timerMessage;     // Interface to sup_timer
+#endif
+#if defined(RAILCOM)
+RailComMessage railcomMessage;  // Interface to sup_railcom
+#endif
+#if defined(LOCONET)
+LocoNetMessage loconetMessage;  // Interface to sup_loconet
+#endif
+#if defined(SEQUENCES)
+SequenceMessage sequenceMessage; // Interface to sup_sequence
+#endif
+#if defined(CLOCK_SCALING)
+ScalerMessage scalerMessage;    // Interface to sup_scaler
+#endif
 
 
 //******************************************************************************************************
@@ -57,6 +188,19 @@ CvMessage     cvMessage;        // Interface to sup_cv
 //******************************************************************************************************
 void Dcc::attach(uint8_t dccPin, uint8_t ackPin) {
   errorXOR = 0;
+  #if defined(PACKET_RECONSTRUCTION)
+  reconstructed = 0;
+  #endif
+  #if (PacketQueueSize > 1)
+  dccQueue.head = 0;
+  dccQueue.tail = 0;
+  dccQueue.count = 0;
+  dccQueue.overflows = 0;
+  if (dccQueue.depth == 0) dccQueue.depth = PacketQueueSize;
+  #endif
+  #if defined(LOCONET)
+  fromLocoNet = false;
+  #endif
   dccMessage.attach(dccPin, ackPin);
   _ackPin = ackPin;
 }
@@ -67,6 +211,64 @@ void Dcc::detach(void) {
 }
 
 
+#if defined(DCC_EDGE_COMPENSATION)
+void Dcc::calibrateEdges(void) {
+  // The ISR collects the samples, and clears calibrating once it has calculated the skew
+  noInterrupts();
+  isrEdgeSkew.sumRising = 0;
+  isrEdgeSkew.sumFalling = 0;
+  isrEdgeSkew.countRising = 0;
+  isrEdgeSkew.countFalling = 0;
+  isrEdgeSkew.calibrating = 1;
+  interrupts();
+}
+
+
+bool Dcc::edgesCalibrated(void) {
+  return (isrEdgeSkew.calibrating == 0);
+}
+
+
+int16_t Dcc::edgeSkew(void) {
+  noInterrupts();
+  int16_t value = isrEdgeSkew.skew;
+  #if defined(CLOCK_SCALING)
+  value = (int16_t)(((int32_t)value * (F_CPU / 1000000UL)) / isrBitLimits.mhz);  // As if at F_CPU
+  #endif
+  interrupts();
+  return value;
+}
+
+
+void Dcc::setEdgeSkew(int16_t ticks) {
+  noInterrupts();
+  #if defined(CLOCK_SCALING)
+  ticks = (int16_t)(((int32_t)ticks * isrBitLimits.mhz) / (F_CPU / 1000000UL));
+  #endif
+  isrEdgeSkew.skew = ticks;
+  interrupts();
+}
+#endif
+
+
+#if (PacketQueueSize > 1)
+void Dcc::setQueueDepth(uint8_t depth) {
+  // A smaller depth than PacketQueueSize is only useful to measure what depth is needed
+  if (depth < 1) depth = 1;
+  if (depth > PacketQueueSize) depth = PacketQueueSize;
+  dccQueue.depth = depth;
+}
+
+
+uint16_t Dcc::queueOverflows(void) {
+  noInterrupts();
+  uint16_t value = dccQueue.overflows;
+  interrupts();
+  return value;
+}
+#endif
+
+
 Dcc::CmdType_t Dcc::analyze_broadcast_message(void) {
   // The following cases should be considered:
   // 1) Reset packet: this also indicates the possible start of Service Mode programming
@@ -81,7 +283,7 @@ Dcc::CmdType_t Dcc::analyze_broadcast_message(void) {
     // After reception of a reset packet, the decoder should check if the next packet will be a
     // service mode instruction packet. Such SM packet should be received within 20 milliseconds
     cvMessage.inServiceMode = true;
-    cvMessage.SmTime = millis();
+    cvMessage.restartSmTimeout();
     // When a Digital Decoder receives a Reset Packet, it shall erase all volatile memory
     // (including any speed and direction data), and return to its normal power-up state.
     // If the Digital Decoder is operating a locomotive at a non-zero speed when it receives a
@@ -89,15 +291,16 @@ Dcc::CmdType_t Dcc::analyze_broadcast_message(void) {
     locoMessage.reset_speed();
     return(ResetCmd);
   }
-  // Case 2: Emergency stop for all loco's.
+  // Case 2: Emergency stop for all loco's. D (direction) and C may have any value, but the other bits
+  // not: other broadcast packets (binary states, feature expansion, speeds) are no stop.
   // {preamble} 0 00000000 0 01DC0001 0 EEEEEEEE 1
-  if ((dccMessage.data[1] & 0b01000001) == 0b0100001) {
+  if ((dccMessage.data[1] & 0b11001111) == 0b01000001) {
     locoMessage.reset_speed();
     return(MyEmergencyStopCmd);
   }
   // Case 3: Normal stop for all loco's.
   // {preamble} 0 00000000 0 01DC0000 0 EEEEEEEE 1
-  if ((dccMessage.data[1] & 0b01000001) == 0b0100000) {
+  if ((dccMessage.data[1] & 0b11001111) == 0b01000000) {
     locoMessage.reset_speed();
     return(MyLocoSpeedCmd);
   }
@@ -105,18 +308,133 @@ Dcc::CmdType_t Dcc::analyze_broadcast_message(void) {
 };
 
 
+//******************************************************************************************************
+//                           Majority vote reconstruction of corrupted packets
+//******************************************************************************************************
+// Command stations repeat most commands. On noisy track sections it may happen that every copy of a
+// command has a bit error, and thus an incorrect checksum. If the errors are in different bits,
+// the command can still be reconstructed: for every bit, the value that occurs in at least two out of
+// three copies is most likely correct. Per byte this majority is (a & b) | (a & c) | (b & c).
+// The last FailedPackets packets with an incorrect checksum are stored. Once three of these have the
+// same size and the same first (address) byte, the majority is calculated. The result is only used
+// if it has a correct checksum. Packets that were received more than MaxFailedAge packets ago are
+// not used, to avoid that copies of different commands (for example different speeds for the same
+// loco) are combined.
+#if defined(PACKET_RECONSTRUCTION)
+#define FailedPackets 4
+#define MaxFailedAge  32                         // roughly 100..150 ms of DCC traffic
+
+static struct {
+  uint8_t size;                                  // 0 = free entry
+  uint8_t age;                                   // Value of packetCount when received
+  uint8_t data[MaxDccSize];
+} failed[FailedPackets];
+static uint8_t failedNext;                       // The entry that will be overwritten next
+static uint8_t packetCount;                      // Counts all received packets
+
+
+bool Dcc::reconstruct(void) {
+  // Step 1: store the corrupted packet
+  uint8_t size = dccMessage.size;
+  uint8_t newest = failedNext;
+  failed[newest].size = size;
+  failed[newest].age = packetCount;
+  for (uint8_t i = 0; i < size; i++) failed[newest].data[i] = dccMessage.data[i];
+  failedNext = (failedNext + 1) % FailedPackets;
+  // Step 2: find the two most recent other copies with the same size and address byte
+  uint8_t copy[2];
+  uint8_t copies = 0;
+  uint8_t j = newest;
+  for (uint8_t n = 1; (n < FailedPackets) && (copies < 2); n++) {
+    j = (j + FailedPackets - 1) % FailedPackets;
+    if ((failed[j].size == size) &&
+        (failed[j].data[0] == failed[newest].data[0]) &&
+        ((uint8_t)(packetCount - failed[j].age) <= MaxFailedAge))
+      copy[copies++] = j;
+  }
+  if (copies < 2) return false;
+  // Step 3: majority vote per byte, and check the result
+  uint8_t myxor = 0;
+  uint8_t candidate[MaxDccSize];
+  for (uint8_t i = 0; i < size; i++) {
+    uint8_t a = failed[newest].data[i];
+    uint8_t b = failed[copy[0]].data[i];
+    uint8_t c = failed[copy[1]].data[i];
+    candidate[i] = (a & b) | (a & c) | (b & c);
+    myxor = myxor ^ candidate[i];
+  }
+  if (myxor) return false;
+  // Step 4: success. The copies may not be used again
+  failed[newest].size = 0;
+  failed[copy[0]].size = 0;
+  failed[copy[1]].size = 0;
+  for (uint8_t i = 0; i < size; i++) dccMessage.data[i] = candidate[i];
+  return true;
+}
+#endif
+
+
 bool Dcc::input(void) {
   bool packet_received = false;
+  STACK_PROBE(STACK_PROBE_INPUT);
+  #if defined(TIME_BASE)
+  timerMessage.update();              // First, so that timeouts are handled before the next packet
+  #elif defined(DCC_CLOCK)
+  captureClock.millis();              // Converts the ticks before they wrap
+  #endif
+  #if defined(SUSI_MASTER)
+  susiMessage.update();
+  #endif
+  #if (PacketQueueSize > 1)
+  // The ISR puts packets in the queue; the oldest is copied to dccMessage, for the analysers
+  if (dccQueue.count) {
+    uint8_t tail = dccQueue.tail;
+    dccMessage.size = dccQueue.size[tail];
+    for (uint8_t i = 0; i < dccMessage.size; i++) dccMessage.data[i] = dccQueue.data[tail][i];
+    dccQueue.tail = (tail + 1 == PacketQueueSize) ? 0 : tail + 1;
+    noInterrupts();
+    dccQueue.count--;
+    interrupts();
+    dccMessage.isReady = 1;
+  }
+  #endif
+  #if defined(LOCONET)
+  // Without a track packet, a LocoNet message may be translated into the packet it will lead to
+  if (!dccMessage.isReady) fromLocoNet = loconetMessage.translate();
+    else fromLocoNet = false;
+  #endif
   if (dccMessage.isReady) {
     uint8_t myxor = 0;
     cmdType = Unknown;
+    #if defined(FLIGHT_RECORDER)
+    uint8_t recorded = 0;                 // RecorderXorError or RecorderReconstructed
+    #endif
+    #if defined(PACKET_RECONSTRUCTION)
+    packetCount++;
+    #endif
     // Check if the DCC packet has a correct checksum.
     for (uint8_t i=0; i<dccMessage.size; i++) myxor = myxor ^ dccMessage.data[i];
     if (myxor) {
       errorXOR ++;
       cmdType = IgnoreCmd;
+      #if defined(FLIGHT_RECORDER)
+      recorded = RecorderXorError;
+      #endif
+      #if defined(PACKET_RECONSTRUCTION)
+      if (reconstruct()) {                // dccMessage now holds the reconstructed packet
+        reconstructed ++;
+        cmdType = Unknown;
+        #if defined(FLIGHT_RECORDER)
+        recorded = RecorderReconstructed;
+        #endif
+      }
+      #endif
     }
-    else {
+    #if defined(LOCONET)
+    // A track packet that still carries the state from before a translated LocoNet message
+    if ((cmdType == Unknown) && !fromLocoNet && loconetMessage.stale()) cmdType = IgnoreCmd;
+    #endif
+    if (cmdType == Unknown) {
       // Check if we are in service mode (programming on the programming track)
       if (cvMessage.inServiceMode) cmdType = cvMessage.analyseSM();
       // Returned cmdType may be SmCmd, IgnoreCmd or remain Unknown
@@ -133,12 +451,43 @@ bool Dcc::input(void) {
         else cmdType = IgnoreCmd;                                                 // 255: Idle Packet
       }
     }
+    #if defined(SUSI_MASTER)
+    susiMessage.forward(cmdType);
+    #endif
+    #if defined(FLIGHT_RECORDER)
+    if (!recorderMessage.reason) recorderMessage.record(cmdType | recorded);
+    #endif
+    #if defined(RAILCOM) && defined(LOCONET)
+    if (!fromLocoNet) railcomMessage.update(myxor != 0);  // QoS of the track only
+    #elif defined(RAILCOM)
+    railcomMessage.update(myxor != 0);  // QoS, and encode the next answer
+    #endif
     // Clear the dccMessage flag
     noInterrupts();
     dccMessage.isReady = 0;
     interrupts();
     packet_received = true;
   }
+  #if defined(VOLTAGE_DETECTION)
+  // Block state changes are reported in the same way as DCC commands
+  else if (occupancyMessage.analyse()) {
+    cmdType = OccupancyCmd;
+    packet_received = true;
+  }
+  #endif
+  #if defined(FLIGHT_RECORDER)
+  if (!recorderMessage.reason) recorderMessage.poll();
+  #endif
+  #if defined(LOGIC_VM)
+  if (packet_received) logicVm.trigger(cmdType);
+  logicVm.run();
+  #endif
+  #if defined(SEQUENCES)
+  sequenceMessage.run(packet_received, cmdType);
+  #endif
+  #if defined(CLOCK_SCALING)
+  scalerMessage.update(packet_received, cmdType);
+  #endif
   return packet_received;
 }
 
@@ -154,7 +503,12 @@ void Dcc::sendAck(void) {
   digitalWrite(_ackPin, HIGH);
   // Program does busy wait for 6ms. Interrupts will still be served
   // Busy wait is needed, since at some places in the code RESET will follow immediately
+  #if defined(CLOCK_SCALING) && !defined(AP_DCC_HOST)
+  unsigned long start = clockMicros();           // delay() assumes F_CPU; the shim's delay() doesn't
+  while (clockMicros() - start < 6000) {}
+  #else
   delay(6);
+  #endif
   digitalWrite(_ackPin, LOW);
 }
 
@@ -170,9 +524,29 @@ void Accessory::setMyAddress(unsigned int first, unsigned int last) {
   accMessage.myAccAddrFirst = first;
   if (last == 65535) accMessage.myAccAddrLast = first;
     else accMessage.myAccAddrLast = last;
+  #if (AccPersonalities > 1)
+  accMessage.buildTable();
+  #endif
 }
 
 
+#if (AccPersonalities > 1)
+void Accessory::setPersonality(uint8_t number, unsigned int first, unsigned int last, uint8_t master,
+                               Output_t type) {
+  // Personality 0 is the same as setMyAddress() and myMaster
+  if (number == 0) myMaster = master;
+  accMessage.setPersonality(number, first, last, master, type);
+}
+#endif
+
+
+#if (AccRepeatCache > 1)
+void Accessory::setRepeatCache(uint8_t entries) {
+  accMessage.setRepeatCache(entries);
+}
+#endif
+
+
 //******************************************************************************************************
 //                                            The Loco Class
 //******************************************************************************************************
@@ -181,12 +555,474 @@ void Loco::setMyAddress(unsigned int first, unsigned int last) {
   // If called with a single parameter, that parameter will be the decoder's Loco address.
   // In that case "last" has the default value 65535 (maxint)
   // If called with two parameters, the decoder listens to all addresses between first and last
-  locoMessage.myLocoAddressFirst = first;
-  if (last == 65535) locoMessage.myLocoAddressLast = first;
-    else locoMessage.myLocoAddressLast = last;
+  if (last == 65535) locoMessage.setMyAddress(first, first);
+    else locoMessage.setMyAddress(first, last);
+}
+
+
+//******************************************************************************************************
+//                                          The Occupancy Class
+//******************************************************************************************************
+#if defined(VOLTAGE_DETECTION)
+void Occupancy::attach(const uint8_t *channels, uint8_t numberOfBlocks) {
+  occupancyMessage.attach(channels, numberOfBlocks);
+}
+
+
+void Occupancy::detach(void) {
+  occupancyMessage.detach();
+}
+
+
+void Occupancy::setLevels(uint16_t on, uint16_t off) {
+  noInterrupts();
+  occupancyMessage.onLevel = on;
+  occupancyMessage.offLevel = off;
+  interrupts();
+}
+
+
+void Occupancy::setFilter(uint8_t shift) {
+  // Filtered values are stored as level x 2^shift in 16 bits. For 10 bit ADC values shift may be 0..6
+  if (shift > 6) shift = 6;
+  noInterrupts();
+  for (uint8_t i = 0; i < MaxBlocks; i++)
+    occupancyMessage.filtered[i] = (occupancyMessage.filtered[i] >> occupancyMessage.filterShift) << shift;
+  occupancyMessage.filterShift = shift;
+  interrupts();
+}
+
+
+void Occupancy::setReleaseDelay(uint16_t ms) {
+  occupancyMessage.releaseDelay = ms;
+}
+
+
+bool Occupancy::isOccupied(uint8_t block) {
+  return (occupancyMessage.reported >> block) & 1;
+}
+
+
+uint16_t Occupancy::level(uint8_t block) {
+  if (block >= MaxBlocks) return 0;
+  noInterrupts();
+  uint16_t value = occupancyMessage.filtered[block];
+  interrupts();
+  return value >> occupancyMessage.filterShift;
+}
+#endif
+
+
+//******************************************************************************************************
+//                                         The S88Slave Class
+//******************************************************************************************************
+#if defined(S88_SLAVE)
+void S88Slave::attach(uint8_t bytes) {
+  s88Message.attach(bytes);
+}
+
+
+void S88Slave::detach(void) {
+  s88Message.detach();
+}
+
+
+void S88Slave::setInput(uint8_t input, bool value) {
+  s88Message.setInput(input, value);
+}
+
+
+uint16_t S88Slave::frames(void) {
+  noInterrupts();
+  uint16_t value = s88Message.frames;
+  interrupts();
+  return value;
+}
+#endif
+
+
+//******************************************************************************************************
+//                                        The SusiMaster Class
+//******************************************************************************************************
+#if defined(SUSI_MASTER)
+void SusiMaster::attach(uint8_t speedSteps) {
+  susiMessage.attach(speedSteps);
+}
+
+
+void SusiMaster::detach(void) {
+  susiMessage.detach();
+}
+#endif
+
+
+//******************************************************************************************************
+//                                          The Logic Class
+//******************************************************************************************************
+#if defined(LOGIC_VM)
+bool Logic::loadProgmem(const uint8_t *program) {
+  return logicVm.loadProgmem(program);
+}
+
+
+bool Logic::loadEeprom(uint16_t address) {
+  return logicVm.loadEeprom(address);
+}
+
+
+void Logic::unload(void) {
+  logicVm.unload();
+}
+
+
+void Logic::setBudget(uint8_t instructions) {
+  if (instructions == 0) instructions = 1;
+  logicVm.budget = instructions;
+}
+
+
+int16_t Logic::variable(uint8_t number) {
+  if (number >= VmVariables) return 0;
+  return logicVm.variables[number];
+}
+
+
+void Logic::setVariable(uint8_t number, int16_t value) {
+  if (number < VmVariables) logicVm.variables[number] = value;
+}
+
+
+uint16_t Logic::dropped(void) {
+  return logicVm.dropped;
+}
+#endif
+
+
+//******************************************************************************************************
+//                                     The LatencyMonitor Class
+//******************************************************************************************************
+// The ISR counts in ticks of the main clock; conversion to us is done here (TicksPerUs: sup_isr.h)
+#if defined(ISR_LATENCY_MONITOR)
+
+uint8_t LatencyMonitor::buckets(void) {
+  return LatencyBuckets;
+}
+
+
+uint32_t LatencyMonitor::count(uint8_t bucket) {
+  if (bucket >= LatencyBuckets) return 0;
+  noInterrupts();
+  uint32_t value = isrLatency.histogram[bucket];
+  interrupts();
+  return value;
+}
+
+
+uint16_t LatencyMonitor::bucketLimit(uint8_t bucket) {
+  if (bucket >= LatencyBuckets - 1) return 65535;
+  return ((uint16_t)(bucket + 1) << LatencyShift) / TicksPerUs;
+}
+
+
+uint16_t LatencyMonitor::maximum(void) {
+  noInterrupts();
+  uint16_t value = isrLatency.maximum;
+  interrupts();
+  return value / TicksPerUs;
+}
+
+
+uint16_t LatencyMonitor::overruns(void) {
+  noInterrupts();
+  uint16_t value = isrLatency.overruns;
+  interrupts();
+  return value;
+}
+
+
+bool LatencyMonitor::warning(void) {
+  return (maximum() > 26);
+}
+
+
+void LatencyMonitor::reset(void) {
+  noInterrupts();
+  for (uint8_t i = 0; i < LatencyBuckets; i++) isrLatency.histogram[i] = 0;
+  isrLatency.maximum = 0;
+  isrLatency.overruns = 0;
+  interrupts();
+}
+#endif
+
+
+//******************************************************************************************************
+//                                      The StackMonitor Class
+//******************************************************************************************************
+#if defined(STACK_MONITOR)
+uint16_t StackMonitor::unused(void) {
+  return stackMessage.unused();
+}
+
+
+uint16_t StackMonitor::maxDepth(void) {
+  return stackMessage.maxDepth();
+}
+
+
+uint16_t StackMonitor::depth(probe_t probe) {
+  return stackMessage.depth(probe);
+}
+
+
+void StackMonitor::reset(void) {
+  stackMessage.reset();
+}
+#endif
+
+
+//******************************************************************************************************
+//                                      The FlightRecorder Class
+//******************************************************************************************************
+#if defined(FLIGHT_RECORDER)
+FlightRecorder::trigger_t FlightRecorder::frozen(void) {
+  return (trigger_t) recorderMessage.reason;
+}
+
+
+uint8_t FlightRecorder::entries(void) {
+  return recorderMessage.count;
+}
+
+
+void FlightRecorder::freeze(void) {
+  if (!recorderMessage.reason) recorderMessage.freeze(manual);
+}
+
+
+void FlightRecorder::resume(void) {
+  recorderMessage.resume();
+}
+
+
+void FlightRecorder::dump(Print &out) {
+  recorderMessage.dump(out);
+}
+#endif
+
+
+//******************************************************************************************************
+//                                        The TimeBase Class
+//******************************************************************************************************
+#if defined(TIME_BASE)
+uint8_t TimeBase::create(void (*callback)(void)) {
+  return timerMessage.create(callback);
+}
+
+
+void TimeBase::start(uint8_t timer, unsigned int ms, unsigned int period) {
+  timerMessage.start(timer, ms, period);
+}
+
+
+void TimeBase::stop(uint8_t timer) {
+  timerMessage.stop(timer);
+}
+
+
+bool TimeBase::running(uint8_t timer) {
+  return timerMessage.running(timer);
+}
+
+
+unsigned long TimeBase::now(void) {
+  return timerMessage.now;
+}
+
+
+void TimeBase::update(void) {
+  timerMessage.update();
+}
+#endif
+
+
+//******************************************************************************************************
+//                                         The RailCom Class
+//******************************************************************************************************
+#if defined(RAILCOM)
+void RailCom::attach(void) {
+  railcomMessage.attach();
+}
+
+
+void RailCom::detach(void) {
+  railcomMessage.detach();
+}
+
+
+void RailCom::setDyn(uint8_t dv, uint8_t value) {
+  railcomMessage.setDyn(dv, value);
+}
+
+
+void RailCom::setTemperature(int16_t celsius) {
+  if (celsius < -50) celsius = -50;
+  if (celsius > 205) celsius = 205;
+  railcomMessage.setDyn(26, celsius + 50);
+}
+
+
+uint16_t RailCom::replies(void) {
+  noInterrupts();
+  uint16_t result = railcomMessage.sent;
+  interrupts();
+  return result;
+}
+#endif
+
+
+//******************************************************************************************************
+//                                         The LocoNet Class
+//******************************************************************************************************
+#if defined(LOCONET)
+void LocoNet::attach(void) {
+  loconetMessage.attach();
+}
+
+
+void LocoNet::detach(void) {
+  loconetMessage.detach();
+}
+
+
+uint16_t LocoNet::messages(void) {
+  noInterrupts();
+  uint16_t result = loconetMessage.messages;
+  interrupts();
+  return result;
+}
+
+
+uint16_t LocoNet::errors(void) {
+  noInterrupts();
+  uint16_t result = loconetMessage.errors;
+  interrupts();
+  return result;
+}
+#endif
+
+
+//******************************************************************************************************
+//                                   The Sequence and Sequencer Classes
+//******************************************************************************************************
+#if defined(SEQUENCES)
+void Sequence::waitMs(unsigned int time) {
+  wait = SeqMs;
+  ms = time;
+  since = dccMillis();
+}
+
+
+void Sequence::waitCmd(uint8_t type, unsigned int time) {
+  wait = SeqCmd;
+  cmdType = type;
+  ms = time;
+  since = dccMillis();
+  timedOut = false;
+}
+
+
+void Sequence::waitSequence(uint8_t other) {
+  // If the other sequence could not be started (NoSequence), run() continues at once
+  wait = SeqSequence;
+  cmdType = other;
+}
+
+
+void Sequence::waitPoll(void) {
+  wait = SeqRun;
+}
+
+
+void Sequence::done(void) {
+  wait = SeqDone;
+}
+
+
+uint8_t Sequencer::start(void (*body)(Sequence &seq), int16_t arg) {
+  return sequenceMessage.start(body, arg);
+}
+
+
+void Sequencer::stop(uint8_t number) {
+  if (number < SequenceFrames) sequenceMessage.frame[number].done();
+}
+
+
+bool Sequencer::running(uint8_t number) {
+  return sequenceMessage.running(number);
+}
+
+
+uint8_t Sequencer::free(void) {
+  return SequenceFrames - sequenceMessage.used;
+}
+#endif
+
+
+//******************************************************************************************************
+//                                        The DccClock Class
+//******************************************************************************************************
+#if defined(DCC_CLOCK)
+uint32_t DccClock::ticks(void) {
+  return captureClock.now();
+}
+
+
+unsigned long DccClock::millis(void) {
+  return captureClock.millis();
+}
+
+
+unsigned long DccClock::micros(void) {
+  return captureClock.micros();
+}
+#endif
+
+
+//******************************************************************************************************
+//                                       The ClockScaler Class
+//******************************************************************************************************
+#if defined(CLOCK_SCALING)
+bool ClockScaler::setClock(uint8_t mhz) {
+  return scalerMessage.set(mhz);
 }
 
 
+uint8_t ClockScaler::clock(void) {
+  return isrBitLimits.mhz;
+}
+
+
+void ClockScaler::automatic(uint8_t lowMhz, uint8_t highMhz, unsigned int idleMs, uint8_t burst) {
+  scalerMessage.lowMhz = lowMhz;
+  scalerMessage.highMhz = highMhz;
+  scalerMessage.idleMs = idleMs;
+  scalerMessage.burst = (burst == 0) ? 1 : burst;
+  scalerMessage.automatic = true;
+}
+
+
+void ClockScaler::manual(void) {
+  scalerMessage.automatic = false;
+}
+
+
+uint16_t ClockScaler::changes(void) {
+  return scalerMessage.changes;
+}
+#endif
+
+
 //******************************************************************************************************
 //                         Configuration Variable (CV) Access Commands - bit manipulation
 //******************************************************************************************************
@@ -200,3 +1036,4 @@ bool CvAccess::verifyBit(uint8_t data) {
   if (bitRead(data, bitposition) == bitvalue) return true;
   return false;
 }
+
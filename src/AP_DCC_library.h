@@ -5,6 +5,26 @@
 // author:    Aiko Pras
 // version:   2021-05-15 V1.0.2 ap initial version
 //            2024-12-11 V1.0.3 ap comments improved for "position" attribute
+//            2026-10-18 V1.1.0 ap Occupancy detection (VOLTAGE_DETECTION) implemented
+//            2026-10-18 V1.1.1 ap s88-N feedback slave (S88_SLAVE)
+//            2026-10-18 V1.1.2 ap Reconstruction of corrupted packets (PACKET_RECONSTRUCTION)
+//            2026-10-18 V1.1.3 ap SUSI master (SUSI_MASTER)
+//            2026-10-18 V1.1.4 ap Bytecode interpreter for user logic (LOGIC_VM)
+//            2026-10-18 V1.1.5 ap Compile-time CV schema (sup_cv_schema.h)
+//            2026-10-18 V1.1.6 ap Interrupt latency monitor (ISR_LATENCY_MONITOR)
+//            2026-10-18 V1.1.7 ap Stack depth monitor (STACK_MONITOR)
+//            2026-10-18 V1.1.8 ap Packet queue (PacketQueueSize) and accessory repeat cache (AccRepeatCache)
+//            2026-10-18 V1.1.9 ap Edge delay compensation (DCC_EDGE_COMPENSATION)
+//            2026-10-18 V1.1.10 ap Detection of the accessory address variant (ACC_AUTO_DETECT)
+//            2026-10-18 V1.1.11 ap Flight recorder of the last packets (FLIGHT_RECORDER)
+//            2026-10-18 V1.1.12 ap Multiple accessory decoder personalities (AccPersonalities)
+//            2026-10-18 V1.1.13 ap Loco addresses are matched on the raw packet bytes
+//            2026-10-18 V1.1.14 ap Time base with hierarchical timer wheels (TIME_BASE)
+//            2026-10-18 V1.1.15 ap RailCom channel 2 feedback of dynamic variables (RAILCOM)
+//            2026-10-18 V1.1.16 ap LocoNet messages as second command input (LOCONET)
+//            2026-10-18 V1.1.17 ap Stackless sequences (coroutines) for the main sketch (SEQUENCES)
+//            2026-10-18 V1.1.18 ap The DCC input timer as clock of the library (DCC_CLOCK)
+//            2026-10-18 V1.1.19 ap Runtime change of the main clock (CLOCK_SCALING)
 //
 // history:   This is a further development of the OpenDecoder 2 software, as developed by W. Kufer.
 //            It has been rewritten such that it can be used for Arduino (Atmel AVR) environments.
@@ -15,6 +35,19 @@
 //            - extern Accessory     accCmd;  // To retrieve the data from accessory commands
 //            - extern Loco          locoCmd; // To retrieve the data from loco commands  (7 & 14 bit)
 //            - extern CvAccess      cvCmd;   // To retrieve the data from pom and sm commands
+//            - extern Occupancy     occupancyCmd; // Block occupancy (only if VOLTAGE_DETECTION is defined)
+//            - extern S88Slave      s88;     // s88-N feedback (only if S88_SLAVE is defined)
+//            - extern SusiMaster    susi;    // SUSI modules (only if SUSI_MASTER is defined)
+//            - extern Logic         logic;   // User logic programs (only if LOGIC_VM is defined)
+//            - extern LatencyMonitor isrMonitor; // DCC ISR latency (only if ISR_LATENCY_MONITOR is defined)
+//            - extern StackMonitor  stackMonitor; // Stack depth (only if STACK_MONITOR is defined)
+//            - extern FlightRecorder flightRecorder; // Last packets (only if FLIGHT_RECORDER is defined)
+//            - extern TimeBase      timeBase; // Timers (only if TIME_BASE is defined)
+//            - extern RailCom       railcom; // RailCom feedback (only if RAILCOM is defined)
+//            - extern LocoNet       loconet; // LocoNet input (only if LOCONET is defined)
+//            - extern Sequencer     sequencer; // Sequences (only if SEQUENCES is defined)
+//            - extern DccClock      dccClock; // Time from the DCC input timer (only if DCC_CLOCK is defined)
+//            - extern ClockScaler   clockScaler; // Main clock changes (only if CLOCK_SCALING is defined)
 //            Setup() should call dcc.dccPin). dccPin is the interrupt pin for the DCC signal
 //            The main loop() should call dcc.input() as often as possible. If there is input,
 //            dcc.cmdType tells what kind of command was received (such as MyAccessoryCmd or MyLocoF0F4Cmd).
@@ -37,9 +70,56 @@
 //******************************************************************************************************
 #pragma once
 
-// #define VOLTAGE_DETECTION             // Uncomment this line if this code should trigger ADC hardware
+// #define VOLTAGE_DETECTION             // Uncomment this line for occupancy detection (see sup_occupancy.cpp)
+// #define S88_SLAVE                     // Uncomment this line for s88-N feedback (see sup_s88.cpp)
+// #define PACKET_RECONSTRUCTION         // Uncomment to rebuild commands from 3 corrupted copies (majority vote)
+// #define SUSI_MASTER                   // Uncomment to forward loco commands to SUSI modules (see sup_susi.cpp)
+// #define LOGIC_VM                      // Uncomment to run user logic programs on DCC commands (see sup_vm.cpp)
+// #define ISR_LATENCY_MONITOR           // Uncomment to measure how late the DCC ISR starts (MegaCoreX / DxCore)
+// #define STACK_MONITOR                 // Uncomment to measure the stack depth (see sup_stack.cpp)
+// #define DCC_EDGE_COMPENSATION         // Uncomment to remove rise / fall delay differences of the input (MegaCoreX / DxCore)
+// #define ACC_AUTO_DETECT               // Uncomment to allow myMaster = AutoDetect (see sup_acc.cpp)
+// #define FLIGHT_RECORDER               // Uncomment to keep the last packets before an event (see sup_recorder.cpp)
+// #define TIME_BASE                     // Uncomment for timers shared by the library and the sketch (see sup_timer.cpp)
+// #define RAILCOM                       // Uncomment for RailCom channel 2 feedback (MegaCoreX / DxCore, see sup_railcom.cpp)
+// #define LOCONET                       // Uncomment to receive commands from LocoNet as well (MegaCoreX / DxCore, see sup_loconet.cpp)
+// #define SEQUENCES                     // Uncomment for sequences that wait for commands and timeouts (see sup_sequence.cpp)
+// #define DCC_CLOCK                     // Uncomment to take the time of the library from the DCC input timer (DxCore, see sup_isr.h)
+// #define CLOCK_SCALING                 // Uncomment to lower the main clock while idle (AVR Dx, needs DCC_CLOCK, see sup_scaler.cpp)
 #define MaxDccSize         6             // DCC messages can have a length upto this value
 
+// Buffer sizes. Each queue entry costs 7 bytes RAM, each cache entry 4 bytes, each recorder entry
+// 12 bytes. More than one accessory personality costs 256 bytes, plus 9 bytes and the cache entries
+// per personality. Which queue and cache sizes a certain layout and sketch need can be determined with
+// extras/Host_Simulation/capacity_planner.cpp
+#ifndef PacketQueueSize
+#define PacketQueueSize    1             // Packets the ISR may buffer for dcc.input(). 1: no queue
+#endif
+#ifndef AccRepeatCache
+#define AccRepeatCache     1             // Accessory commands remembered to filter retransmissions
+#endif
+#ifndef AccPersonalities
+#define AccPersonalities   1             // Accessory decoders on this board (upto 15), see setPersonality()
+#endif
+#ifndef FlightRecorderSize
+#define FlightRecorderSize 16            // Packets kept by the flight recorder (FLIGHT_RECORDER)
+#endif
+#ifndef TimeBaseTimers
+#define TimeBaseTimers     8             // Timers the sketch may create (TIME_BASE), 11 bytes each
+#endif
+#ifndef RailComDynamics
+#define RailComDynamics    4             // Variables in the RailCom DYN rotation (RAILCOM), including QoS
+#endif
+#ifndef LocoNetSlots
+#define LocoNetSlots       8             // LocoNet slots (locos) remembered (LOCONET), 5 bytes each
+#endif
+#ifndef SequenceFrames
+#define SequenceFrames     4             // Sequences that may run at the same time (SEQUENCES), 20 bytes each
+#endif
+#ifndef SequenceVars
+#define SequenceVars       2             // Variables per sequence that keep their value while waiting
+#endif
+
 
 //******************************************************************************************************
 //                                            DCC Class
@@ -47,6 +127,11 @@
 // This is the main class to receive and analyse DCC messages. It has three methods: attach(), detach()
 // and input(). The main loop() should call dcc.input() as often as possible. If there is input,
 // dcc.cmdType informs main what kind of command was received.
+// An optocoupler in front of the DCC pin delays rising and falling edges by different amounts, so
+// half bits that end on one edge look longer than they are, and the others shorter. If
+// DCC_EDGE_COMPENSATION is defined, calibrateEdges() measures this difference on the preambles of the
+// next packets, and the ISR corrects every edge. Since half bits of a preamble alternately end on a
+// rising and a falling edge, the difference must stay below 18us to be measurable (half bits of 40..76us).
 
 class Dcc {
   public:
@@ -71,7 +156,8 @@ class Dcc {
       AnyAccessoryCmd,                           // Accessory command, but not for this decoder address(es)
       MyAccessoryCmd,                            // Accessory command, for this decoder address(es)
       MyPomCmd,                                  // Programming on the Main (PoM)
-      SmCmd                                      // Programming in Service Mode (SM = programming track)
+      SmCmd,                                     // Programming in Service Mode (SM = programming track)
+      OccupancyCmd                               // Occupancy of a block has changed (VOLTAGE_DETECTION)
     } CmdType_t;
     CmdType_t cmdType;                           // What kind of DCC message did we receive?
 
@@ -83,9 +169,28 @@ class Dcc {
 
 
     uint8_t errorXOR;                            // The number of DCC packets with an incorrect checksum
+    #if defined(DCC_EDGE_COMPENSATION)
+    void calibrateEdges(void);                   // Start measuring the rise / fall delay difference of the input
+    bool edgesCalibrated(void);                  // True once the measurement is complete
+    int16_t edgeSkew(void);                      // Correction per edge, in F_CPU ticks (to store in EEPROM)
+    void setEdgeSkew(int16_t ticks);             // Set the correction (F_CPU ticks), for example from EEPROM
+    #endif
+    #if (PacketQueueSize > 1)
+    void setQueueDepth(uint8_t depth);           // Packets the ISR may queue (1..PacketQueueSize)
+    uint16_t queueOverflows(void);               // Packets lost, since the queue was full
+    #endif
+    #if defined(PACKET_RECONSTRUCTION)
+    uint8_t reconstructed;                       // The number of packets rebuilt from corrupted copies
+    #endif
+    #if defined(LOCONET)
+    bool fromLocoNet;                            // The last packet was translated from a LocoNet message
+    #endif
 
   private:
     CmdType_t analyze_broadcast_message(void);
+    #if defined(PACKET_RECONSTRUCTION)
+    bool reconstruct(void);                      // Majority vote over the last corrupted packets
+    #endif
     uint8_t _ackPin;                            // Set by attach(), and used by sendAck()
 };
 
@@ -156,6 +261,17 @@ class Dcc {
 // used for other purposes, such as calculating CV values, or generating feedback / POM addresses.
 // The "myMaster" attribute can be set by the main sketch to "Lenz", "OpenDcc" or "Roco"
 // to deal with different command station behavior. The default value is "Lenz".
+// If ACC_AUTO_DETECT is defined, myMaster may also be set to "AutoDetect". The library then watches
+// which address bits the command station uses, and once it is confident, myMaster changes into the
+// detected value (which the sketch may store, for example in a CV). Until then, addresses are
+// interpreted as "Lenz". Roco and the other command stations only differ by one decoder address, so
+// detection needs commands for the first or last four handheld addresses; see "sup_acc.cpp".
+//
+// RETRANSMISSIONS
+// Command stations send each accessory command several times. The library remembers the last command
+// and ignores its retransmissions. Some command stations interleave the copies of different commands
+// (A, B, A, B, ...); to filter these as well, more commands should be remembered. The maximum is set
+// at compile time by AccRepeatCache, the number actually used by setRepeatCache().
 //
 // An Accesory Decoder may listen to one or multiple decoder addresses, for example if it supports more than
 // four switches or skips uneven addresses. After startup, a call should be made to setMyAddress().
@@ -163,10 +279,22 @@ class Dcc {
 // will listen to. If the call includes two parameters, these parameters represent the range of addresses
 // this decoder will listen to.
 //
+// PERSONALITIES
+// A single board may replace several accessory decoders, each with its own address range, command
+// station variant (myMaster), type of outputs and retransmission filter. If AccPersonalities is more
+// than 1, setPersonality() defines such decoders (0..AccPersonalities-1). Personality 0 is the one of
+// setMyAddress() and myMaster. After a command, "personality" tells which decoder it is for, and
+// "output" its type of outputs. A table with the personality of each of the 512 address codes is
+// built by setPersonality(), so a command is dispatched with a single lookup, however many
+// personalities there are. If ranges overlap, the personality with the highest number wins.
+//
 //******************************************************************************************************
 const uint8_t Roco = 0;     // Roco 10764 with Multimouse
 const uint8_t Lenz = 1;     // LENZ LZV100 with Xpressnet V3.6 - Default value
 const uint8_t OpenDCC = 2;  // OpenDCC Z1 with Xpressnet V3.6
+#if defined(ACC_AUTO_DETECT)
+const uint8_t AutoDetect = 3; // Determine one of the above from the received commands
+#endif
 
 
 class Accessory {
@@ -175,6 +303,21 @@ class Accessory {
     // Decoder specific attributes should be initialised in setup()
     void setMyAddress(unsigned int first, unsigned int last = 65535);
     uint8_t myMaster = Lenz;
+    #if (AccRepeatCache > 1)
+    void setRepeatCache(uint8_t entries);  // Commands remembered to filter retransmissions (1..AccRepeatCache)
+    #endif
+    #if (AccPersonalities > 1)
+    typedef enum {
+      coil,                              // Switches with two coils
+      servo,                             // Switches or other devices moved by servos
+      signal,                            // Signals (basic or extended commands)
+      relay                              // On / off devices
+    } Output_t;
+    void setPersonality(uint8_t number, unsigned int first, unsigned int last = 65535,
+                        uint8_t master = Lenz, Output_t type = coil);
+    uint8_t personality;                 // 0..AccPersonalities-1 - The decoder the command is for
+    Output_t output;                     // The type of outputs of that decoder
+    #endif
 
     // The next attributes inform the main sketch about the contents of the received accessory command
     typedef enum {
@@ -278,3 +421,425 @@ class CvAccess {
     bool verifyBit(uint8_t data);        // the received bitvalue on bitposition matches the old
 
 };
+
+// The CVs of a decoder may be described by a CV schema, which validates and executes CvAccess
+// commands and provides typed accessors. See sup_cv_schema.h
+#include "sup_cv_schema.h"
+
+
+//******************************************************************************************************
+//                                        OCCUPANCY DETECTION
+//******************************************************************************************************
+// Occupancy detectors measure, for each track block, the voltage over a sense resistor (or diodes).
+// If VOLTAGE_DETECTION is defined, the DCC ISR starts the AD conversions at the right moment (during
+// the high part of the DCC signal), and upto 16 blocks are scanned. See sup_occupancy.cpp for details.
+//
+// After startup, attach() should be called with an array that holds for each block the ADC channel
+// (AINn) that is connected to that block. The optional setLevels(), setFilter() and setReleaseDelay()
+// may be used to adapt the detection to the hardware. The filtered level of each block can be read
+// via level(); this may help to determine the on and off levels.
+//
+// If a block changes state, dcc.input() returns true and dcc.cmdType is OccupancyCmd. The attributes
+// "block" and "occupied" tell which block has changed, and what the new state is.
+//
+//******************************************************************************************************
+#if defined(VOLTAGE_DETECTION)
+class Occupancy {
+  public:
+    void attach(const uint8_t *channels,
+                uint8_t numberOfBlocks);         // ADC channel per block. Upto 16 blocks
+    void detach(void);                           // Stops the ADC
+    void setLevels(uint16_t on, uint16_t off);   // Hysteresis, in ADC units (default 40 / 20)
+    void setFilter(uint8_t shift);               // Filter constant 1/2^shift (0..6, default 1)
+    void setReleaseDelay(uint16_t ms);           // Time a block must be free before reporting (default 0)
+    bool isOccupied(uint8_t block);              // The state as last reported by dcc.input()
+    uint16_t level(uint8_t block);               // The filtered level, in ADC units
+
+    // Attributes that tell which block changed (valid if cmdType is OccupancyCmd)
+    uint8_t block;                               // 0..15
+    bool occupied;                               // The new state of that block
+};
+#endif
+
+
+//******************************************************************************************************
+//                                          S88-N FEEDBACK
+//******************************************************************************************************
+// If S88_SLAVE is defined, the decoder can also act as s88-N feedback module. The SPI hardware shifts
+// the inputs out, and passes the data of the next modules in the chain through, with one interrupt
+// per byte and one per frame (LOAD). See sup_s88.cpp for details and the required connections
+// (MegaCoreX / DxCore only).
+//
+// After startup, attach() should be called with the number of bytes (8 inputs each) of this module.
+// Input values may be set at any moment via setInput(), for example after an accessory command or
+// a change in block occupancy. The s88 master will read the new value with the next frame. An input
+// that has been set is reported to the master at least once, even if it has been cleared meanwhile.
+//
+//******************************************************************************************************
+#if defined(S88_SLAVE)
+class S88Slave {
+  public:
+    void attach(uint8_t bytes = 2);              // Size of this module: 2 bytes = 16 inputs (2..8)
+    void detach(void);                           // Stops the SPI
+    void setInput(uint8_t input, bool value);    // Input 1..(8 x bytes)
+    uint16_t frames(void);                       // Number of frames read by the s88 master
+};
+#endif
+
+
+//******************************************************************************************************
+//                                            SUSI MASTER
+//******************************************************************************************************
+// If SUSI_MASTER is defined, a loco decoder forwards speed, direction and functions to SUSI (RCN-600)
+// sound and function modules. Only changes are sent, and in the background all values are refreshed
+// regularly. CV commands (PoM and SM) for the SUSI CVs 897..1024 are forwarded as well; the main sketch
+// should ignore these CVs. Forwarding is done by dcc.input(), so the main sketch only has to call
+// attach(). See sup_susi.cpp for details and the pins used (MegaCoreX / DxCore only).
+//
+// speedSteps tells how the command station sends the speed (14, 28 or 128 steps); SUSI always uses
+// 127 steps.
+//
+//******************************************************************************************************
+#if defined(SUSI_MASTER)
+class SusiMaster {
+  public:
+    void attach(uint8_t speedSteps = 128);       // Starts the USART
+    void detach(void);                           // Stops the USART
+};
+#endif
+
+
+//******************************************************************************************************
+//                                           USER LOGIC
+//******************************************************************************************************
+// If LOGIC_VM is defined, dcc.input() runs small bytecode programs (handlers) for the commands it
+// receives. A program, stored in flash (PROGMEM) or in EEPROM, has a handler per cmdType. Handlers can
+// read the attributes of accCmd and locoCmd, set and read pins, wait, and share 16 variables with each
+// other and with the main sketch. Since programs in EEPROM can be written via CVs, the logic of a
+// decoder can be changed without reflashing. See sup_vm.h for the instruction set and sup_vm.cpp for
+// the program format.
+//
+// Programs are verified by load(); if the program is invalid, false is returned and no logic runs.
+// Per call of dcc.input() at most "budget" instructions are executed (default 32), thus decoding of
+// DCC packets is never delayed by long running programs.
+//
+//******************************************************************************************************
+#if defined(LOGIC_VM)
+class Logic {
+  public:
+    bool loadProgmem(const uint8_t *program);    // Verifies and starts a program in flash
+    bool loadEeprom(uint16_t address);           // Verifies and starts a program in EEPROM
+    void unload(void);                           // Stops all handlers
+    void setBudget(uint8_t instructions);        // Instructions per call of dcc.input()
+    int16_t variable(uint8_t number);            // Read a shared variable (0..15)
+    void setVariable(uint8_t number, int16_t value);
+    uint16_t dropped(void);                      // Commands lost, since all tasks were busy
+};
+#endif
+
+
+//******************************************************************************************************
+//                                     INTERRUPT LATENCY MONITOR
+//******************************************************************************************************
+// On MegaCoreX and DxCore boards the TCB captures the moment of each DCC edge exactly, but the DCC ISR
+// may start late if other ISRs (of the sketch or other libraries) are running. The ISR must have
+// started before the next edge arrives (after 52us at the earliest); otherwise that edge, and thus
+// the packet, is lost without any trace. If ISR_LATENCY_MONITOR is defined, the ISR measures its own
+// entry latency and keeps a histogram, the maximum, and the number of edges that may have been lost
+// (overruns). warning() becomes true once the maximum exceeds half of the 52us; that is the moment
+// to give the DCC ISR level 1 priority (DCC_ISR_LEVEL1), or to shorten the other ISRs.
+// The monitor costs roughly 1us per edge.
+//
+//******************************************************************************************************
+#if defined(ISR_LATENCY_MONITOR)
+class LatencyMonitor {
+  public:
+    uint8_t buckets(void);                       // Number of histogram buckets
+    uint32_t count(uint8_t bucket);              // Number of edges with a latency within this bucket
+    uint16_t bucketLimit(uint8_t bucket);        // Upper limit of this bucket, in us (last: no limit)
+    uint16_t maximum(void);                      // Largest latency, in us
+    uint16_t overruns(void);                     // Edges that may have been lost
+    bool warning(void);                          // The largest latency is more than 26us
+    void reset(void);
+};
+#endif
+
+
+//******************************************************************************************************
+//                                          STACK MONITOR
+//******************************************************************************************************
+// If STACK_MONITOR is defined, the free RAM is painted at startup, and probes record the deepest
+// stack on the main paths of the library. maxDepth() is the deepest stack so far for the complete
+// program (sketch, library and all ISRs); unused() is the RAM that was never used, thus the margin
+// that is left. depth() tells how deep the stack was at the entry of the DCC ISR, at the moment the
+// ISR completed a packet, and at the entry of dcc.input() and its analysers. A large ISR depth, with
+// a small dcc.input() depth, means the ISR fired while the sketch was deep in a call chain.
+// All values are in bytes. See sup_stack.cpp for details, and extras/Stack_Usage for the static
+// (compile time) analysis.
+//
+//******************************************************************************************************
+#if defined(STACK_MONITOR)
+class StackMonitor {
+  public:
+    typedef enum {
+      Isr,                                       // DCC ISR, every interrupt
+      IsrPacket,                                 // DCC ISR, complete packet received
+      Input,                                     // dcc.input()
+      LocoAnalyser,                              // Analysis of loco commands
+      AccAnalyser,                               // Analysis of accessory commands
+      CvAnalyser                                 // Analysis of CV access commands (SM and PoM)
+    } probe_t;
+
+    uint16_t unused(void);                       // RAM between heap and stack that was never used
+    uint16_t maxDepth(void);                     // Deepest stack so far (high water mark)
+    uint16_t depth(probe_t probe);               // Deepest stack at this probe (0: not reached yet)
+    void reset(void);                            // Restart the measurements
+};
+#endif
+
+
+//******************************************************************************************************
+//                                         FLIGHT RECORDER
+//******************************************************************************************************
+// If FLIGHT_RECORDER is defined, dcc.input() keeps the last FlightRecorderSize packets in a ring, with
+// the moment (micros()) it took them and the result of the analysis (cmdType, and whether the XOR was
+// wrong or the packet was reconstructed by PACKET_RECONSTRUCTION). On certain events the recording
+// freezes, so that afterwards can be seen what arrived just before: an emergency stop, a burst of XOR
+// errors (xorErrors out of the last xorWindow packets), or no correct packet at all for watchdogMs.
+// Reconstructed packets count as correct packets for these events. The sketch may also freeze the recording itself. dump()
+// prints the frozen packets, with their time relative to the event. resume() starts recording again.
+// Recording costs a few stores per packet.
+//
+//******************************************************************************************************
+#if defined(FLIGHT_RECORDER)
+class FlightRecorder {
+  public:
+    typedef enum {
+      none = 0,                                  // Still recording
+      emergencyStop = 1,
+      xorBurst = 2,
+      watchdog = 4,
+      manual = 8                                 // freeze() was called
+    } trigger_t;
+
+    uint8_t triggers = emergencyStop | xorBurst | watchdog; // The events that freeze the recording
+    uint8_t xorErrors = 3;                       // xorBurst: this many packets with an XOR error ...
+    uint8_t xorWindow = 8;                       // ... within this many packets (upto 16)
+    uint16_t watchdogMs = 500;                   // watchdog: time without a correct packet
+
+    trigger_t frozen(void);                      // The event that froze the recording (none: recording)
+    uint8_t entries(void);                       // Number of packets recorded
+    void freeze(void);                           // Freeze the recording now
+    void resume(void);                           // Clear the recording and start again
+    void dump(Print &out);                       // Print the recorded packets, oldest first
+};
+#endif
+
+
+//******************************************************************************************************
+//                                            TimeBase Class
+//******************************************************************************************************
+// If TIME_BASE is defined, dcc.input() advances a millisecond counter, and calls the callbacks of the
+// timers that expire. Timers are created once, for example in setup(), and may then be (re)started
+// and stopped as often as needed, at a cost that doesn't depend on the number of timers. A timer fires
+// once after ms milliseconds, and if period is not 0, every period milliseconds after that. Callbacks
+// are called from dcc.input(), not from an interrupt, and should not call dcc.input() themselves. The
+// library uses the time base for its own timeouts as well, so that it calls millis() only once per
+// dcc.input(). If the main loop doesn't call dcc.input() for a while, update() may be called instead.
+//
+//******************************************************************************************************
+#if defined(TIME_BASE)
+#define NoTimer            255
+
+class TimeBase {
+  public:
+    uint8_t create(void (*callback)(void));      // Returns the timer, or NoTimer if TimeBaseTimers are in use
+    void start(uint8_t timer, unsigned int ms, unsigned int period = 0); // (Re)start. period 0: one-shot
+    void stop(uint8_t timer);
+    bool running(uint8_t timer);
+    unsigned long now(void);                     // Milliseconds, as millis() at the last update
+    void update(void);                           // Advance to millis(). Also done by dcc.input()
+};
+#endif
+
+
+//******************************************************************************************************
+//                                            RailCom Class
+//******************************************************************************************************
+// If RAILCOM is defined, a loco decoder answers in channel 2 of the RailCom cutout (RCN-217), after
+// each correct packet to one of its loco addresses. Each answer holds two dynamic variables (DYN);
+// the variables take turns. The library itself reports the percentage of packets with an XOR error
+// (QoS, subindex 7), computed per 100 packets. The main sketch may add upto RailComDynamics - 1
+// variables it measures itself, such as the temperature (subindex 26, value = degrees + 50) or the
+// supply voltage, with setDyn(). Values are encoded when set, so the ISRs only copy bytes.
+// See sup_railcom.cpp for details and the USART and timer used (MegaCoreX / DxCore only).
+//
+//******************************************************************************************************
+#if defined(RAILCOM)
+class RailCom {
+  public:
+    void attach(void);                           // Starts the USART and the channel 2 timer
+    void detach(void);
+    void setDyn(uint8_t dv, uint8_t value);      // Add or change the variable with subindex dv (0..63)
+    void setTemperature(int16_t celsius);        // setDyn(26, celsius + 50), limited to -50..205
+    uint16_t replies(void);                      // Number of channel 2 answers sent
+};
+#endif
+
+
+//******************************************************************************************************
+//                                            LocoNet Class
+//******************************************************************************************************
+// If LOCONET is defined, dcc.input() also takes commands from a LocoNet bus. Switch requests and the
+// speed and function messages of locos are translated into the DCC packet the command station will
+// put on the track, and analysed like packets from the track. Thus the main sketch doesn't notice
+// where a command came from, but gets it earlier. The copies that arrive later from the track (or
+// from LocoNet) are filtered as retransmissions. Loco messages carry a slot number; the address of
+// upto LocoNetSlots slots is taken from the slot data messages on the bus.
+// See sup_loconet.cpp for details and the USART used (MegaCoreX / DxCore only).
+//
+//******************************************************************************************************
+#if defined(LOCONET)
+class LocoNet {
+  public:
+    void attach(void);                           // Starts the USART receiver
+    void detach(void);
+    uint16_t messages(void);                     // Number of messages with a correct checksum
+    uint16_t errors(void);                       // Framing and checksum errors, incomplete messages
+};
+#endif
+
+
+//******************************************************************************************************
+//                                         Sequencer Class
+//******************************************************************************************************
+// If SEQUENCES is defined, the main sketch can run sequences of steps, such as: fire a coil, wait
+// 50 ms, move a servo, wait until the next command for a signal, set the signal. Each sequence is a
+// function that is called again and again by dcc.input(); the SEQ_ macros make it wait, and continue
+// after the wait where it stopped. Thus many sequences run at the same time, without delay() and
+// without state machines in the sketch, while DCC packets are still decoded.
+// A sequence can wait for:
+// - SEQ_WAIT_MS(seq, ms): a number of milliseconds
+// - SEQ_WAIT_CMD(seq, cmdType): the next DCC command of this type. Attributes such as accCmd tell the
+//   details; if the command is not the one the sequence waits for, it simply waits again
+// - SEQ_WAIT_CMD_MS(seq, cmdType, ms): the same, but at most ms milliseconds; seq.timedOut tells
+// - SEQ_WAIT_SEQUENCE(seq, number): the end of another sequence. SEQ_CALL(seq, function, arg) starts
+//   another sequence and waits until it has ended
+// - SEQ_WAIT_UNTIL(seq, condition): the condition becomes true, for example an input pin
+// The sequences are stackless coroutines: local variables lose their value while waiting. Values
+// that are needed after a wait should be kept in seq.arg, seq.var[] or in global variables. Two
+// SEQ_ macros should not be on the same line, and SEQ_ macros can't be used inside a switch.
+//   void blink(Sequence &seq) {
+//     SEQ_BEGIN(seq);
+//     for (seq.var[0] = 0; seq.var[0] < 3; seq.var[0]++) {
+//       digitalWrite(seq.arg, HIGH);
+//       SEQ_WAIT_MS(seq, 200);
+//       digitalWrite(seq.arg, LOW);
+//       SEQ_WAIT_MS(seq, 200);
+//     }
+//     SEQ_END(seq);
+//   }
+//   sequencer.start(blink, ledPin);
+// Frames come from a pool of SequenceFrames; start() returns NoSequence if all are in use. A new
+// sequence starts at the latest with the next dcc.input(). See sup_sequence.cpp for details.
+//
+//******************************************************************************************************
+#if defined(SEQUENCES)
+#define NoSequence         255
+
+class Sequence {
+  public:
+    int16_t arg;                                 // The value given to start()
+    int16_t var[SequenceVars];                   // Keep their value while the sequence waits
+    bool timedOut;                               // SEQ_WAIT_CMD_MS ended by the timeout
+    uint8_t number;                              // This sequence (0 .. SequenceFrames - 1)
+
+    // Used by the SEQ_ macros
+    void waitMs(unsigned int ms);
+    void waitCmd(uint8_t cmdType, unsigned int ms);
+    void waitSequence(uint8_t other);
+    void waitPoll(void);
+    void done(void);
+    uint16_t resume;                             // Line to continue at; 0: the start
+
+    // Used by the sequencer
+    void (*body)(Sequence &seq);                 // 0: frame not in use
+    uint8_t wait;                                // What the sequence waits for
+    uint8_t cmdType;                             // The command type, or the other sequence
+    unsigned int ms;                             // 0: no timeout
+    unsigned long since;                         // Start of the wait, in milliseconds
+};
+
+class Sequencer {
+  public:
+    uint8_t start(void (*body)(Sequence &seq), int16_t arg = 0);  // Returns the number, or NoSequence
+    void stop(uint8_t number);                   // Ends the sequence; it isn't called anymore
+    bool running(uint8_t number);                // False once the sequence has ended
+    uint8_t free(void);                          // Frames not in use
+};
+
+#define SEQ_BEGIN(seq)              switch ((seq).resume) { case 0:
+#define SEQ_END(seq)                } (seq).done(); return
+#define SEQ_EXIT(seq)               do { (seq).done(); return; } while (0)
+#define SEQ_SUSPEND_(seq)           (seq).resume = __LINE__; return; case __LINE__:
+#define SEQ_WAIT_MS(seq, t)         do { (seq).waitMs(t); SEQ_SUSPEND_(seq); } while (0)
+#define SEQ_WAIT_CMD(seq, c)        do { (seq).waitCmd(c, 0); SEQ_SUSPEND_(seq); } while (0)
+#define SEQ_WAIT_CMD_MS(seq, c, t)  do { (seq).waitCmd(c, t); SEQ_SUSPEND_(seq); } while (0)
+#define SEQ_WAIT_SEQUENCE(seq, n)   do { (seq).waitSequence(n); SEQ_SUSPEND_(seq); } while (0)
+#define SEQ_CALL(seq, f, a)         SEQ_WAIT_SEQUENCE(seq, sequencer.start(f, a))
+#define SEQ_WAIT_UNTIL(seq, cond)   do { (seq).waitPoll(); SEQ_SUSPEND_(seq); if (!(cond)) return; } while (0)
+#define SEQ_YIELD(seq)              do { (seq).waitPoll(); SEQ_SUSPEND_(seq); } while (0)
+
+extern Sequencer sequencer;
+#endif
+
+
+//******************************************************************************************************
+//                                            DccClock Class
+//******************************************************************************************************
+// If DCC_CLOCK is defined, the TCB that captures the DCC signal is also the clock of the library:
+// timeouts, the time base (TIME_BASE), sequences and the flight recorder no longer call millis() and
+// micros() of the Arduino core. The timer of millis() may then be used by the main sketch, for
+// example by selecting another millis() timer, or none, in the DxCore board menu. The capture
+// precision stays the same. ticks() counts F_CPU ticks and wraps after 2^32 ticks; millis() and
+// micros() behave like those of the Arduino core. Call them from the main loop, not from an ISR.
+// The clock runs while the DCC input is attached. Requires an AVR Dx, EA or tinyAVR 2 processor, since
+// megaAVR 0 TCBs don't have an overflow interrupt. See sup_isr.h for details.
+//
+//******************************************************************************************************
+#if defined(DCC_CLOCK)
+class DccClock {
+  public:
+    uint32_t ticks(void);                        // F_CPU ticks
+    unsigned long millis(void);
+    unsigned long micros(void);
+};
+#endif
+
+
+//******************************************************************************************************
+//                                           ClockScaler Class
+//******************************************************************************************************
+// If CLOCK_SCALING is defined, the main clock of an AVR Dx may be changed at runtime, for example to
+// run at 4 MHz while the decoder is idle, to save power and heat. The DCC input keeps working at
+// each clock: the half bit limits of the ISR, and the half bit that is being measured, are rescaled
+// together with the clock change, so no packet gets lost. In automatic mode, dcc.input() switches to highMhz
+// after burst own commands (for the decoder's addresses, PoM or Service Mode), and back to lowMhz once
+// no own command has arrived for idleMs. The clock must be the internal oscillator, without
+// prescaler. Valid values are 1, 2, 3, 4, 8, 12, 16, 20 and 24 MHz.
+// Requires DCC_CLOCK, since millis(), micros() and delay() of the Arduino core, as well as the baud
+// rate of Serial, assume F_CPU. The main sketch should use dccClock for its time, and should not
+// use Serial at another clock than F_CPU. See sup_scaler.cpp for details.
+//
+//******************************************************************************************************
+#if defined(CLOCK_SCALING)
+class ClockScaler {
+  public:
+    bool setClock(uint8_t mhz);                  // False if the clock can't be changed to this value
+    uint8_t clock(void);                         // The main clock, in MHz
+    void automatic(uint8_t lowMhz = 4, uint8_t highMhz = F_CPU / 1000000UL, unsigned int idleMs = 1000,
+                   uint8_t burst = 1);
+    void manual(void);                           // Stop automatic mode; the clock stays as it is
+    uint16_t changes(void);                      // Number of clock changes
+};
+#endif
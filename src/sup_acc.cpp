@@ -7,6 +7,10 @@
 //            2022-02-22 V1.0.3 ap Corrected retransmission test, to include decoderAddress_old
 //            2024-09-13 V1.0.4 ap Corrected the last four addresses: between 2045-2048
 //                                 Tested Extended packets
+//            2026-10-18 V1.0.5 ap Repeat cache for more than one previous command (AccRepeatCache)
+//            2026-10-18 V1.0.6 ap Address variant per myMaster precomputed; AutoDetect (ACC_AUTO_DETECT)
+//            2026-10-18 V1.0.7 ap Multiple personalities (AccPersonalities)
+//            2026-10-19 V1.0.8 ap AutoDetect uses the first packet after it was selected
 //
 // This source file is subject of the GNU general public license 3,
 // that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
@@ -122,6 +126,36 @@
 // - Roco: strategy 1 (standard) and strategy 3 (lenz) command stations.
 // Note that OpenDCC conforms to RCN213, and should be selected for many other
 // command stations, such as the Yamorc YD6001.
+// The three variants only differ in two numbers, which are calculated once after myMaster changes:
+// decoderAddress = (MSB + LSB + (LSB == 0 ? lsbZero : 0) - offset) modulo 512.
+//
+// AUTO DETECTION
+// If ACC_AUTO_DETECT is defined and myMaster is AutoDetect, the raw address bits (MSB + LSB, 0..511) of
+// the accessory commands are watched. The sets of raw addresses the variants use are (nearly) equal,
+// so only the order of commands tells them apart: successive commands (such as those of a route, or
+// of someone testing turnouts) are often for neighbouring handheld addresses. The neighbours of a raw
+// address whose LSB bits are 0 depend on the variant:
+// - Lenz:    n*64+0 lies between n*64+63 and (n+1)*64+1 (handheld 252, 253..256, 257)
+// - Roco:    0 lies before 1 (handheld 1..4, 5..8)
+// - OpenDCC: 0 lies after 510 (handheld 2037..2040, 2045..2048; 511 is the broadcast address)
+// - Roco and OpenDCC: n*64+0 (n > 0) lies between n*64-1 and n*64+1; this only counts against Lenz.
+// Raw addresses above 255 (handheld 1024) exclude Lenz. The broadcast address (raw 511) and the
+// retransmissions of a command are ignored.
+// Once a variant has AccDetectEvidence points, and at least four times as many as the others together,
+// myMaster is set to that variant. Until then, addresses are interpreted as Lenz (the default).
+// Note that, except for raw address 0, Roco and OpenDCC can not be told apart: they differ by one
+// decoder address for every address. A layout that uses neither the first nor the last four handheld
+// addresses therefore stays undetected, as well as one that never uses a raw address with LSB 0.
+// With more than one personality, only personality 0 (which uses myMaster) can be detected.
+//
+// PERSONALITIES
+// If AccPersonalities is more than 1, the board acts as several accessory decoders. Each personality
+// has its own address range, variant and retransmission filter. Since the variant determines which
+// decoder address an address code (raw address, MSB + LSB) stands for, the ranges are translated
+// into address codes once, when they are set, and stored in a table with 4 bits per address code
+// (256 bytes). An incoming command therefore finds its personality with a single lookup, without
+// comparing the ranges of all personalities. Address codes without personality are analysed as
+// personality 0, and reported as AnyAccessoryCmd.
 //
 // Within the accessory decoder we distinguish between:
 // - decoderAddress (0..511): MSB + LSB (plus some compensation in case of LENZ systems)
@@ -136,6 +170,7 @@
 #include "sup_acc.h"
 #include "sup_isr.h"
 #include "sup_cv.h"
+#include "sup_stack.h"
 
 // Declaration of external objects
 extern Accessory  accCmd;              // instantiated in DCC_Library.cpp, used by main sketch
@@ -144,14 +179,138 @@ extern DccMessage dccMessage;          // instantiated in, and used by, DCC_Libr
 extern AccMessage accMessage;          // instantiated in, and used by, DCC_Library.cpp
 extern CvMessage  cvMessage;           // Interface to sup_cv
 
+#if defined(ACC_AUTO_DETECT)
+#define AccDetectEvidence  4           // Minimum points before a variant is selected
+#endif
+
 
 // Constructor for the AccMessage class
 AccMessage::AccMessage(){
   myAccAddrFirst = 65535;              // Ensure that, if not initialised, no messages matches my address
   myAccAddrLast  = 65535;
-  decoderAddress_old = 65535;          // This address should not be found in any accessory message
-  byte1_old = 0b00000000;              // This pattern should not occur in any accessory command
-  byte2_old = 0b11111111;              // This pattern should not occur in an extended accessory command
+  current = 0;
+  for (uint8_t i = 0; i < AccPersonalities; i++) {
+    #if (AccPersonalities > 1)
+    personality[i].first = 65535;
+    personality[i].last = 65535;
+    personality[i].type = Accessory::coil;
+    #endif
+    setMaster(i, Lenz);
+  }
+  setRepeatCache(1);
+  #if (AccPersonalities > 1)
+  buildTable();
+  #endif
+}
+
+
+void AccMessage::setMaster(uint8_t number, uint8_t value) {
+  personality[number].master = value;
+  switch (value) {
+    case Roco:
+      personality[number].offset = 0;
+      personality[number].lsbZero = 0;
+      break;
+    case OpenDCC:
+      personality[number].offset = 1;
+      personality[number].lsbZero = 0;
+      break;
+    default:                           // Lenz, as well as AutoDetect until detected
+      personality[number].offset = 1;
+      personality[number].lsbZero = 64;
+      break;
+  }
+  #if defined(ACC_AUTO_DETECT)
+  if ((number == 0) && (value == AutoDetect)) { // Start again
+    lastRaw = 511;
+    evidence[Roco] = 0;
+    evidence[Lenz] = 0;
+    evidence[OpenDCC] = 0;
+    lenzExcluded = false;
+  }
+  #endif
+}
+
+
+#if defined(ACC_AUTO_DETECT)
+static void addEvidence(uint8_t &points) {
+  if (points < 255) points++;
+}
+
+
+void AccMessage::detect(uint16_t raw) {
+  // raw: MSB + LSB (0..511). See "AUTO DETECTION" above
+  if ((raw == 511) || (raw == lastRaw)) return;         // Broadcast, or same decoder as before
+  uint16_t low = raw;                                   // Order the pair: low has LSB 0 (if any)
+  uint16_t high = lastRaw;
+  if ((low & 0x3F) != 0) {
+    low = lastRaw;
+    high = raw;
+  }
+  lastRaw = raw;
+  if (raw > 255) {
+    lenzExcluded = true;
+    evidence[Lenz] = 0;
+  }
+  if ((low & 0x3F) != 0) return;                        // Only pairs with an LSB 0 address tell something
+  if (low == 0) {
+    if (high == 1) addEvidence(evidence[Roco]);
+    if (high == 510) addEvidence(evidence[OpenDCC]);
+  }
+  if (!lenzExcluded) {
+    if ((high == low + 63) || (high == low + 65)) addEvidence(evidence[Lenz]);
+    else if ((low != 0) && ((high == low - 1) || (high == low + 1)) && evidence[Lenz]) evidence[Lenz]--;
+  }
+  // Is one variant clearly ahead?
+  uint16_t total = evidence[Roco] + evidence[Lenz] + evidence[OpenDCC];
+  for (uint8_t variant = Roco; variant <= OpenDCC; variant++) {
+    uint16_t points = evidence[variant];
+    if ((points >= AccDetectEvidence) && (4 * (total - points) <= points)) {
+      accCmd.myMaster = variant;                        // analyse() calls setMaster()
+      return;
+    }
+  }
+}
+#endif
+
+
+void AccMessage::setRepeatCache(uint8_t entries) {
+  if (entries < 1) entries = 1;
+  if (entries > AccRepeatCache) entries = AccRepeatCache;
+  for (uint8_t i = 0; i < AccRepeatCache; i++) {
+    for (uint8_t j = 0; j < AccPersonalities; j++) {
+      personality[j].previous[i].decoderAddress = 65535; // Should not be found in any accessory message
+      personality[j].previous[i].byte1 = 0b00000000;    // Should not occur in any accessory command
+      personality[j].previous[i].byte2 = 0b11111111;    // Should not occur in an extended accessory command
+    }
+  }
+  for (uint8_t j = 0; j < AccPersonalities; j++) personality[j].previousNext = 0;
+  previousSize = entries;
+}
+
+
+bool AccMessage::isRepeated(uint8_t byte1, uint8_t byte2, uint8_t mask1, uint8_t mask2) {
+  // Is this command equal to one of the previous commands? Only the bits in the masks are compared.
+  // If not, it replaces the previous command for the same turnout (bits TT, basic as well as extended),
+  // since a later copy of that command would be a new command. Otherwise it replaces the oldest entry.
+  // With a single entry, only the last command is remembered. Each personality has its own entries
+  uint8_t p = current;
+  uint8_t entry = personality[p].previousNext;
+  bool sameTurnout = false;
+  for (uint8_t i = 0; i < previousSize; i++) {
+    if (personality[p].previous[i].decoderAddress != accCmd.decoderAddress) continue;
+    if ((((personality[p].previous[i].byte1 ^ byte1) & mask1) == 0) &&
+        (((personality[p].previous[i].byte2 ^ byte2) & mask2) == 0)) return true;
+    if (((personality[p].previous[i].byte1 ^ byte1) & 0b00000110) == 0) {
+      entry = i;
+      sameTurnout = true;
+    }
+  }
+  personality[p].previous[entry].decoderAddress = accCmd.decoderAddress;
+  personality[p].previous[entry].byte1 = byte1;
+  personality[p].previous[entry].byte2 = byte2;
+  if (!sameTurnout && (++personality[p].previousNext == previousSize)) personality[p].previousNext = 0;
+  return false;
 }
 
 
@@ -162,6 +321,44 @@ bool AccMessage::IsMyAddress() {
 }
 
 
+#if (AccPersonalities > 1)
+void AccMessage::setPersonality(uint8_t number, unsigned int first, unsigned int last, uint8_t master,
+                                uint8_t type) {
+  if (number >= AccPersonalities) return;
+  if (last == 65535) last = first;
+  if (number == 0) {
+    myAccAddrFirst = first;
+    myAccAddrLast = last;
+  }
+  personality[number].first = first;
+  personality[number].last = last;
+  personality[number].type = type;
+  setMaster(number, master);
+  buildTable();
+}
+
+
+void AccMessage::buildTable(void) {
+  // Translates the decoder address ranges into address codes (MSB + LSB), see "PERSONALITIES" above.
+  // This is the inverse of step 1B of analyse()
+  personality[0].first = myAccAddrFirst;
+  personality[0].last = myAccAddrLast;
+  for (uint16_t i = 0; i < 256; i++) owner[i] = 0xFF;
+  for (uint8_t p = 0; p < AccPersonalities; p++) {
+    if (personality[p].first > 511) continue;
+    unsigned int last = (personality[p].last > 511) ? 511 : personality[p].last;
+    for (unsigned int address = personality[p].first; address <= last; address++) {
+      uint16_t code;
+      if (personality[p].lsbZero && (((address + 1) & 0x3F) == 0)) code = address - 63;
+      else code = (address + personality[p].offset) & 0x1FF;
+      if (code & 1) owner[code >> 1] = (owner[code >> 1] & 0x0F) | (p << 4);
+      else owner[code >> 1] = (owner[code >> 1] & 0xF0) | p;
+    }
+  }
+}
+#endif
+
+
 //******************************************************************************************************
 // Packet structure:
 // {preamble} AAAA-AAAA [AAAA-AAAA] IIII-IIII [IIII-IIII] [IIII-IIII] EEEE-EEEE
@@ -185,27 +382,44 @@ bool AccMessage::IsMyAddress() {
 //
 //******************************************************************************************************
 Dcc::CmdType_t AccMessage::analyse(void) {
+  STACK_PROBE(STACK_PROBE_ACC);
   // Step 1: Determine the decoderAddress received
   // At this stage we only determine the decoder address; the output address is determined in step 4
   // MSB: take Bits 6 5 4 from dccMessage.data[1] and invert
   // LSB: take bits 5 4 3 2 1 0 from dccMessage.data[0]
-  uint16_t msb = ((~dccMessage.data[1] & 0b01110000) << 2);
-  uint8_t  lsb =  (dccMessage.data[0] & 0b00111111);
+  uint8_t msb = ((~dccMessage.data[1] & 0b01110000) >> 4);
+  uint8_t lsb =  (dccMessage.data[0] & 0b00111111);
   // Step 1B: Correct the received address to deal with differences in command stations (see above)
-  switch (accCmd.myMaster) {
-    case Lenz:
-      if (lsb == 0) {msb = msb + 64;}
-      accCmd.decoderAddress = msb + lsb - 1;
-      break;
-    case Roco:
-      accCmd.decoderAddress = msb + lsb;
-      break;
-    default:
-      accCmd.decoderAddress = msb + lsb - 1;
-      // For the last decoder address (=511): msb and lsb are coded as 0
-      if (accCmd.decoderAddress == 65535) {accCmd.decoderAddress = 511;}
-      break;
+  // For OpenDCC, the last decoder address (=511) has msb and lsb coded as 0 (modulo 512)
+  uint16_t address = (msb << 6) + lsb;
+  #if defined(ACC_AUTO_DETECT)
+  // If the sketch has selected AutoDetect since the last packet, this packet is the first evidence
+  if ((accCmd.myMaster == AutoDetect) && (personality[0].master != AutoDetect)) {
+    setMaster(0, AutoDetect);
+    #if (AccPersonalities > 1)
+    buildTable();
+    #endif
+  }
+  if (personality[0].master == AutoDetect) detect(address);  // May set accCmd.myMaster
+  #endif
+  if (accCmd.myMaster != personality[0].master) {
+    setMaster(0, accCmd.myMaster);
+    #if (AccPersonalities > 1)
+    buildTable();
+    #endif
   }
+  #if (AccPersonalities > 1)
+  // Step 1A: Which personality is this command for?
+  current = owner[address >> 1];
+  if (address & 1) current = current >> 4;
+    else current = current & 0x0F;
+  bool mine = (current != NoPersonality);
+  if (!mine) current = 0;
+  accCmd.personality = current;
+  accCmd.output = (Accessory::Output_t) personality[current].type;
+  #endif
+  if (lsb == 0) address += personality[current].lsbZero;
+  accCmd.decoderAddress = (address - personality[current].offset) & 0x1FF;
   //
   // Step 2: Determine the other attributes
   uint8_t byte1 = dccMessage.data[1];                   // This may now be stored in a register
@@ -223,15 +437,14 @@ Dcc::CmdType_t AccMessage::analyse(void) {
   // Step 4: Return if this message is not intended for this decoder.
   // In this case MAIN may use the decoderAddress / outputAddress for initialising the decoder
   // We filter retrainsmissions
-  if (!IsMyAddress()) {                                 // Decoder address not in my own range
-    if ((accCmd.decoderAddress == decoderAddress_old) &&
-        (accCmd.device == device_old))                  // Is this for the same address & device as the previous?
+  #if (AccPersonalities == 1)
+  bool mine = IsMyAddress();
+  #endif
+  if (!mine) {                                          // Decoder address not in my own range
+    if (isRepeated(byte1, 0, 0b00000111, 0))            // Is this for the same address & device as before?
       return(Dcc::IgnoreCmd);                           // We already notified main before, so ignore
-    else {                                              // This command is for a new address
-      decoderAddress_old = accCmd.decoderAddress;       // Save it
-      device_old = accCmd.device;                       // Save it
-      return(Dcc::AnyAccessoryCmd);                     // And inform main that there is a new address
-    }
+    else                                                // This command is for a new address
+      return(Dcc::AnyAccessoryCmd);                     // Inform main that there is a new address
   }
   //
   // Step 5: Determine the kind of accessory command. Possible options include:
@@ -243,20 +456,13 @@ Dcc::CmdType_t AccMessage::analyse(void) {
   // return directly from each case (Break therefore not needed)
   switch (dccMessage.size) {
     case 3:                                                     // length 3: basic accesory command or NOP
-    if ((accCmd.decoderAddress == decoderAddress_old) &&
-        (byte1 == byte1_old))                                   // Is this a retransmission??
+    if (isRepeated(byte1, 0, 0b11111111, 0))                    // Is this a retransmission??
       return(Dcc::IgnoreCmd);                                   // Ignore
-    decoderAddress_old = accCmd.decoderAddress;                 // No retransmission, so save for the next time
-    byte1_old = byte1;                                          // Save first byte as well
     if (byte1 & 0b10000000) {return(Dcc::MyAccessoryCmd); }     // Basic command. Only command generated by LENZ
     else return(Dcc::IgnoreCmd);                                // No Operation Commmand. See RCN-213
   case 4:                                                       // Extended command
-    if ((accCmd.decoderAddress == decoderAddress_old) &&
-        (byte1 == byte1_old) && (byte2 == byte2_old))           // Is this a retransmission??
+    if (isRepeated(byte1, byte2, 0b11111111, 0b11111111))       // Is this a retransmission??
       return(Dcc::IgnoreCmd);                                   // Ignore
-    decoderAddress_old = accCmd.decoderAddress;                 // No retransmission, so save for the next time
-    byte1_old = byte1;                                          // Save first byte as well
-    byte2_old = byte2;                                          // Same for second byte
     accCmd.signalHead = byte2;                                  // 0..255: the signal's value
     return(Dcc::MyAccessoryCmd);                                // Command intended for this decoder
   case 5:                                                       // CV Access Instruction - Short Form
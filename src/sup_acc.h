@@ -4,6 +4,9 @@
 // purpose:   Accessory decoder functions to support the DCC library
 // author:    Aiko Pras
 // version:   2021-05-15 V1.0.2 ap initial version
+//            2026-10-18 V1.0.5 ap Repeat cache for more than one previous command (AccRepeatCache)
+//            2026-10-18 V1.0.6 ap Address variant per myMaster precomputed; AutoDetect (ACC_AUTO_DETECT)
+//            2026-10-18 V1.0.7 ap Multiple personalities (AccPersonalities)
 //
 // This source file is subject of the GNU general public license 3,
 // that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
@@ -11,6 +14,11 @@
 //******************************************************************************************************
 #pragma once
 
+#if (AccPersonalities > 15)
+#error "AccPersonalities: at most 15 personalities are supported"
+#endif
+#define NoPersonality      0x0F          // Address table: the address code belongs to no personality
+
 
 class AccMessage {
   public:
@@ -21,11 +29,50 @@ class AccMessage {
     unsigned int myAccAddrFirst;     // 0..510  - First accessory decoder address this decoder will listen too
     unsigned int myAccAddrLast;      // 0..510  - Last accessory decoder address this decoder will listen too
 
+    void setRepeatCache(uint8_t entries); // Number of previous commands remembered (1..AccRepeatCache)
+
+    #if (AccPersonalities > 1)
+    void setPersonality(uint8_t number, unsigned int first, unsigned int last, uint8_t master, uint8_t type);
+    void buildTable(void);           // Called after a change of an address range or variant
+    #endif
+
   private:
     bool IsMyAddress();              // Function to determine if the command is for this decoder
-    unsigned int decoderAddress_old; // To store the previously received decoder addres
-    uint8_t device_old;              // as well as the device
-    uint8_t byte1_old;               // From the previously received accessory command
-    uint8_t byte2_old;               // From the previously received accessory command
+    bool isRepeated(uint8_t byte1, uint8_t byte2, uint8_t mask1, uint8_t mask2);
+
+    // Per personality (only one, unless AccPersonalities > 1): the address variant of the command
+    // station, and the previously received accessory commands, to filter retransmissions.
+    // The variant of personality 0 is recalculated if accCmd.myMaster changes
+    void setMaster(uint8_t number, uint8_t value);
+    struct {
+      uint8_t master;                // The myMaster value the next two are calculated for
+      uint8_t lsbZero;               // Added to the address if the LSB bits are 0 (Lenz: 64)
+      uint8_t offset;                // Subtracted from the address bits (Roco: 0, others: 1)
+      struct {
+        unsigned int decoderAddress;
+        uint8_t byte1;
+        uint8_t byte2;
+      } previous[AccRepeatCache];
+      uint8_t previousNext;          // Entry that will be overwritten next
+      #if (AccPersonalities > 1)
+      unsigned int first;            // Address range. Personality 0: myAccAddrFirst / Last
+      unsigned int last;
+      uint8_t type;                  // Accessory::Output_t
+      #endif
+    } personality[AccPersonalities];
+    uint8_t previousSize;            // Entries in use (1..AccRepeatCache)
+    uint8_t current;                 // Personality of the command that is being analysed
+
+    #if (AccPersonalities > 1)
+    // The personality of each address code (MSB + LSB), in 4 bits. Two address codes per byte
+    uint8_t owner[256];
+    #endif
 
+    #if defined(ACC_AUTO_DETECT)
+    // Evidence for each variant, from successive commands. See sup_acc.cpp
+    void detect(uint16_t raw);
+    uint16_t lastRaw;                // Raw address (MSB + LSB) of the previous command
+    uint8_t evidence[3];             // Per variant (Roco, Lenz, OpenDCC)
+    bool lenzExcluded;               // Raw address above 255 received: beyond the LZV100 range
+    #endif
 };
@@ -4,6 +4,8 @@
 // purpose:   Configuration Access Methods
 // author:    Aiko Pras
 // version:   2021-05-15 V1.0.2 ap initial version
+//            2026-10-18 V1.0.3 ap The SM timeout may be a timer of the time base (TIME_BASE)
+//            2026-10-18 V1.0.4 ap Time from clockMillis(), which may be the DCC input timer (DCC_CLOCK)
 //
 // This source file is subject of the GNU general public license 3,
 // that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
@@ -114,9 +116,12 @@
 #include "AP_DCC_library.h"
 #include "sup_isr.h"
 #include "sup_cv.h"
+#include "sup_stack.h"
+#include "sup_timer.h"
 
 extern DccMessage   dccMessage;         // Class defined in sup_isr.h, instantiated in DCC_Library.cpp
 extern CvAccess     cvCmd;              // instantiated in DCC_Library.cpp, used by main sketch
+extern CvMessage    cvMessage;          // instantiated in, and used by, DCC_Library.cpp
 
 
 //******************************************************************************************************
@@ -170,30 +175,59 @@ bool Backup::identical() {
 }
 
 
+//******************************************************************************************************
+//                                             SM timeout
+//******************************************************************************************************
+// New SM packets should arrive within SmTimeOut. Without TIME_BASE, analyseSM() compares millis() with
+// the moment of the previous packet. With TIME_BASE, a one-shot timer of the time base leaves SM, so
+// that analyseSM() doesn't need to read the time at all. Since the time base is advanced at the start
+// of dcc.input(), the timer fires before the packet that arrives too late is analysed.
+#if defined(TIME_BASE)
+static void smTimeout(void) {
+  cvMessage.inServiceMode = false;
+  backup.size = 0;
+  backup.count = 0;
+}
+#endif
+
+
+void CvMessage::restartSmTimeout(void) {
+  #if defined(TIME_BASE)
+  timerMessage.attach(TimerSM, smTimeout);
+  timerMessage.start(TimerSM, SmTimeOut, 0);
+  #else
+  SmTime = clockMillis();
+  #endif
+}
+
+
 //******************************************************************************************************
 //                                             analyseSM()
 //******************************************************************************************************
 Dcc::CmdType_t CvMessage::analyseSM(void) {
+  STACK_PROBE(STACK_PROBE_CV);
   // {Preamble} 0111-CCVV VVVV-VVVV DDDD-DDDD EEEE-EEEE         - Long form. In SM there is no address
   uint8_t byte1 = dccMessage.data[0];
   uint8_t byte2 = dccMessage.data[1];
   uint8_t byte3 = dccMessage.data[2];
-  if ((millis() - SmTime) >= SmTimeOut) {                       // Timeout?
+  #if !defined(TIME_BASE)                                       // Otherwise a timer leaves SM
+  if ((clockMillis() - SmTime) >= SmTimeOut) {                  // Timeout?
     inServiceMode = false;
     backup.size = 0;
     backup.count = 0;
     return (Dcc::Unknown);                                      // We don't know yet what packet this is
   }
+  #endif
   if ((byte1 == 0b00000000) && (byte2 == 0b00000000)) {         // Reset packet in SM?
-    SmTime = millis();
+    restartSmTimeout();
     return(Dcc::IgnoreCmd);
   }
   if (byte1 == 0b11111111) {                                    // Idle packet in SM?
-    SmTime = millis();
+    restartSmTimeout();
     return(Dcc::IgnoreCmd);
   }
   if ((byte1 & 0b11110000) == 0b01110000) {                     // SM packet?
-    SmTime = millis();                                          // Reopen TimeInterval for next message
+    restartSmTimeout();                                         // Reopen TimeInterval for next message
     if (dccMessage.size == 4) {                                 // Long Form (Direct mode)?
       if (backup.identical()) {                                 // Is this the second SM message?
         switch ((byte1 & 0b00001100) >> 2) {                    // CC bits
@@ -227,6 +261,7 @@ Dcc::CmdType_t CvMessage::analyseSM(void) {
 //                                             analysePoM()
 //******************************************************************************************************
 Dcc::CmdType_t CvMessage::analysePoM(void) {
+  STACK_PROBE(STACK_PROBE_CV);
   // Note: we only implement the long form. The short form is NOT implemented
   // 0AAA-AAAA           1110-CCVV VVVV-VVVV DDDD-DDDD EEEE-EEEE      Loco (7 bit address)
   // 11AA-AAAA AAAA-AAAA 1110-CCVV VVVV-VVVV DDDD-DDDD EEEE-EEEE      Loco (14 bit address)
@@ -4,6 +4,7 @@
 // purpose:   Configuration Access Methods
 // author:    Aiko Pras
 // version:   2021-05-15 V1.0.2 ap initial version
+//            2026-10-18 V1.0.3 ap The SM timeout may be a timer of the time base (TIME_BASE)
 //
 // This source file is subject of the GNU general public license 3,
 // that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
@@ -17,8 +18,12 @@ class CvMessage {
     Dcc::CmdType_t analyseSM(void);      // Analyse Service Mode CV access Commands
     Dcc::CmdType_t analysePoM(void);     // Analyse Programming on the Main CV access Commands
 
+    void restartSmTimeout(void);         // Called after a reset, and after each packet in SM
+
     bool inServiceMode;                  // Flag is set after a broadcast reset is received
   
+    #if !defined(TIME_BASE)
     unsigned long SmTime;                // New SM packets should arrive within a certain time
+    #endif
     const unsigned long SmTimeOut = 40;  // The timeout for SM packets is 20ms. We allow some extra ms
 };
@@ -0,0 +1,242 @@
+//******************************************************************************************************
+//
+// file:      sup_cv_schema.h
+// purpose:   Compile-time description of the CVs of a decoder, with typed accessors and validation
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//            2026-10-18 V1.0.1 ap Bit fields are declared in the schema (CvField)
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+// Without a schema, every sketch that handles cvCmd needs its own array of CVs, index calculations
+// and magic numbers. With this file a sketch declares its CVs once, sorted by CV number:
+//
+//   constexpr CvDef myCvs[] PROGMEM = {
+//   // number default min  max  flags
+//     {1,      1,      1,   127, 0},                  // Primary address
+//     {7,      10,     0,   255, CV_READ_ONLY},       // Version
+//     {8,      13,     0,   255, CV_READ_ONLY},       // Manufacturer
+//     {29,     0b10,   0,   255, 0},                  // Configuration
+//     {33,     25,     5,   100, 0}                   // Pulse time (10 ms)
+//   };
+//   CvSchema<myCvs, sizeof(myCvs) / sizeof(CvDef)> cvs;
+//
+// CVs such as CV29 consist of bit fields. These may be declared in a second table, which is passed
+// to the schema as well. A field is identified by its index in that table, for which the sketch
+// should define an enum:
+//
+//   enum {Direction, SpeedSteps, LongAddress};
+//   constexpr CvField myFields[] PROGMEM = {
+//   // number shift width max
+//     {29,     0,    1,    1},                        // Direction
+//     {29,     1,    1,    1},                        // SpeedSteps: 28/128
+//     {29,     5,    1,    1}                         // LongAddress
+//   };
+//   CvSchema<myCvs, sizeof(myCvs) / sizeof(CvDef), myFields, sizeof(myFields) / sizeof(CvField)> cvs;
+//
+// From this:
+// - the compiler checks that CV numbers are within 1..1024 and sorted, and that the defaults lie
+//   within their range. For fields it checks that the CV is in the schema, that the field fits in
+//   its CV and doesn't overlap another field of the same CV, and that max and the default value of
+//   the field fit in its width;
+// - the values are stored packed in RAM (one byte per declared CV, not per CV number);
+// - defaults, ranges and flags stay in flash (PROGMEM);
+// - get<33>(), flag<29, 1>(), word<17, 18>(), field<LongAddress>() and setField<SpeedSteps>(1) are
+//   typed accessors. The CV number or field is a template parameter, thus the RAM location, shift
+//   and mask are resolved by the compiler, and an accessor is as cheap as reading a global variable.
+//   Using a CV or field that is not in the schema is a compile error;
+// - apply(cvCmd) handles verifyByte, writeByte and bitManipulation commands (SM and PoM). The CV is
+//   found by a binary search in flash, and writes are checked against the read-only flag and range,
+//   and against the max of each declared field of that CV.
+//
+// Persistence (EEPROM) is left to the sketch: after apply() returned CvWritten, the sketch may store
+// the value (via read(cvCmd.number)); at startup it may restore values via write().
+// Since the schema uses C++11 constexpr, an array of CVs can be checked only if it is constexpr.
+//
+//******************************************************************************************************
+#pragma once
+#include <Arduino.h>
+
+#define CV_READ_ONLY   0x01                         // Writes via cvCmd are refused (reads are allowed)
+
+struct CvDef {
+  uint16_t number;                                  // 1..1024
+  uint8_t defaultValue;
+  uint8_t min;
+  uint8_t max;
+  uint8_t flags;
+};
+
+struct CvField {
+  uint16_t number;                                  // The CV that holds the field
+  uint8_t shift;                                    // Position of the lowest bit: 0..7
+  uint8_t width;                                    // Number of bits: 1..8
+  uint8_t max;                                      // Largest valid value of the field
+};
+
+typedef enum {
+  CvNotFound,                                       // The CV is not in the schema
+  CvReadOnly,                                       // Write refused
+  CvOutOfRange,                                     // Write refused
+  CvVerifyFailed,                                   // Verify byte / bit: values differ
+  CvVerified,                                       // Verify byte / bit: values are equal
+  CvWritten                                         // The new value has been stored
+} CvResult_t;
+
+
+//******************************************************************************************************
+// Compile-time helpers. C++11 constexpr functions may not contain loops, hence the recursion
+//******************************************************************************************************
+constexpr bool cvSchemaValid(const CvDef *defs, uint16_t n, uint16_t i = 0) {
+  return (i >= n) ? true :
+    (defs[i].number >= 1) && (defs[i].number <= 1024) &&
+    (defs[i].min <= defs[i].max) &&
+    (defs[i].defaultValue >= defs[i].min) && (defs[i].defaultValue <= defs[i].max) &&
+    ((i == 0) || (defs[i - 1].number < defs[i].number)) &&
+    cvSchemaValid(defs, n, i + 1);
+}
+
+
+constexpr uint16_t cvSchemaIndex(const CvDef *defs, uint16_t n, uint16_t number, uint16_t i = 0) {
+  return ((i >= n) || (defs[i].number == number)) ? i : cvSchemaIndex(defs, n, number, i + 1);
+}
+
+
+constexpr uint8_t cvFieldMask(const CvField &field) {
+  return ((1 << field.width) - 1) << field.shift;
+}
+
+
+constexpr bool cvFieldOverlaps(const CvField *fields, uint8_t i, uint8_t j = 0) {
+  // Does field i overlap one of the fields before it?
+  return (j >= i) ? false :
+    ((fields[j].number == fields[i].number) && (cvFieldMask(fields[j]) & cvFieldMask(fields[i]))) ||
+    cvFieldOverlaps(fields, i, j + 1);
+}
+
+
+constexpr bool cvFieldsValid(const CvDef *defs, uint16_t n, const CvField *fields, uint8_t f,
+                             uint8_t i = 0) {
+  return (i >= f) ? true :
+    (cvSchemaIndex(defs, n, fields[i].number) < n) &&
+    (fields[i].width >= 1) && (fields[i].shift + fields[i].width <= 8) &&
+    (fields[i].max <= (1 << fields[i].width) - 1) &&
+    (((defs[cvSchemaIndex(defs, n, fields[i].number)].defaultValue >> fields[i].shift) &
+      ((1 << fields[i].width) - 1)) <= fields[i].max) &&
+    !cvFieldOverlaps(fields, i) &&
+    cvFieldsValid(defs, n, fields, f, i + 1);
+}
+
+
+//******************************************************************************************************
+// The schema
+//******************************************************************************************************
+template <const CvDef *Defs, uint16_t N, const CvField *Fields = nullptr, uint8_t F = 0>
+class CvSchema {
+  static_assert(N > 0, "The CV schema is empty");
+  static_assert(cvSchemaValid(Defs, N), "CV schema: numbers must be 1..1024 and sorted, "
+                                        "and defaults must lie within min..max");
+  static_assert(cvFieldsValid(Defs, N, Fields, F), "CV fields: the CV must be in the schema, "
+                "fields must fit in their CV without overlap, and max and default within the width");
+  public:
+    CvSchema() { reset(); }
+
+    void reset(void) {                              // All CVs get their default value
+      for (uint16_t i = 0; i < N; i++) _value[i] = pgm_read_byte(&Defs[i].defaultValue);
+    }
+
+    // Typed accessors. The CV number is checked, and its RAM location determined, by the compiler
+    template <uint16_t Number> uint8_t get(void) const {
+      static_assert(cvSchemaIndex(Defs, N, Number) < N, "CV is not in the schema");
+      return _value[cvSchemaIndex(Defs, N, Number)];
+    }
+
+    template <uint16_t Number> void set(uint8_t value) {
+      static_assert(cvSchemaIndex(Defs, N, Number) < N, "CV is not in the schema");
+      _value[cvSchemaIndex(Defs, N, Number)] = value;
+    }
+
+    template <uint16_t Number, uint8_t Bit> bool flag(void) const {
+      static_assert(Bit < 8, "Bit must be 0..7");
+      return (get<Number>() >> Bit) & 1;
+    }
+
+    template <uint8_t Field> uint8_t field(void) const {
+      static_assert(Field < F, "Field is not in the schema");
+      return (get<Fields[Field].number>() >> Fields[Field].shift) & ((1 << Fields[Field].width) - 1);
+    }
+
+    template <uint8_t Field> CvResult_t setField(uint8_t value) {
+      static_assert(Field < F, "Field is not in the schema");
+      if (value > Fields[Field].max) return CvOutOfRange;
+      const uint16_t i = cvSchemaIndex(Defs, N, Fields[Field].number);
+      return store(i, (_value[i] & ~cvFieldMask(Fields[Field])) | (value << Fields[Field].shift));
+    }
+
+    template <uint16_t High, uint16_t Low> uint16_t word(void) const {
+      return (get<High>() << 8) | get<Low>();      // Such as CV17 / CV18 (long address)
+    }
+
+    // Access by CV number, determined at runtime
+    int16_t find(uint16_t number) const {           // Index, or -1 if the CV is not in the schema
+      uint16_t low = 0;
+      uint16_t high = N;
+      while (low < high) {
+        uint16_t mid = (low + high) >> 1;
+        uint16_t midNumber = pgm_read_word(&Defs[mid].number);
+        if (midNumber == number) return mid;
+        if (midNumber < number) low = mid + 1;
+        else high = mid;
+      }
+      return -1;
+    }
+
+    uint8_t read(uint16_t number) const {           // 0 if the CV is not in the schema
+      int16_t i = find(number);
+      return (i < 0) ? 0 : _value[i];
+    }
+
+    CvResult_t write(uint16_t number, uint8_t value) {
+      int16_t i = find(number);
+      if (i < 0) return CvNotFound;
+      return store(i, value);
+    }
+
+    // Validates and executes a CV access command (cvCmd)
+    CvResult_t apply(CvAccess &cv) {
+      int16_t i = find(cv.number);
+      if (i < 0) return CvNotFound;
+      uint8_t old = _value[i];
+      switch (cv.operation) {
+        case CvAccess::verifyByte:
+          return (old == cv.value) ? CvVerified : CvVerifyFailed;
+        case CvAccess::writeByte:
+          if (pgm_read_byte(&Defs[i].flags) & CV_READ_ONLY) return CvReadOnly;
+          return store(i, cv.value);
+        case CvAccess::bitManipulation:
+          if (cv.writecmd == 0) return cv.verifyBit(old) ? CvVerified : CvVerifyFailed;
+          if (pgm_read_byte(&Defs[i].flags) & CV_READ_ONLY) return CvReadOnly;
+          return store(i, cv.writeBit(old));
+        default:
+          return CvNotFound;
+      }
+    }
+
+  private:
+    CvResult_t store(uint16_t i, uint8_t value) {
+      if ((value < pgm_read_byte(&Defs[i].min)) || (value > pgm_read_byte(&Defs[i].max)))
+        return CvOutOfRange;
+      uint16_t number = pgm_read_word(&Defs[i].number);
+      for (uint8_t j = 0; j < F; j++) {
+        if (pgm_read_word(&Fields[j].number) != number) continue;
+        uint8_t fieldValue = (value >> pgm_read_byte(&Fields[j].shift)) &
+                             ((1 << pgm_read_byte(&Fields[j].width)) - 1);
+        if (fieldValue > pgm_read_byte(&Fields[j].max)) return CvOutOfRange;
+      }
+      _value[i] = value;
+      return CvWritten;
+    }
+
+    uint8_t _value[N];
+};
@@ -4,6 +4,10 @@
 // purpose:   DCC receiving code for ATmega(X) processors
 // author:    Aiko Pras
 // version:   2021-05-15 V1.0.0 ap Initial version
+//            2026-10-18 V1.0.1 ap Host (PC) variant added, for simulation
+//            2026-10-18 V1.0.2 ap Includes AP_DCC_library.h, so VOLTAGE_DETECTION becomes visible
+//            2026-10-18 V1.0.3 ap Millisecond conversion of the capture timer clock (DCC_CLOCK)
+//            2026-10-18 V1.0.4 ap The conversion follows clock changes (CLOCK_SCALING)
 //
 // Purpose: Select the best DCC capture code for a specific processor and board.
 //
@@ -31,8 +35,12 @@
 // Note that performance of this approach on new processors gives considerably more overhead than on
 // the traditional processors. Therefore it is strongly adviced to switch to a MegaCoreX board.
 //
+// If AP_DCC_HOST is defined, the library is compiled for a PC, together with the virtual time
+// Arduino shim that can be found in extras/Host_Simulation. See sup_isr_Host.h for details
+//
 //******************************************************************************************************
 #include <Arduino.h>
+#include "AP_DCC_library.h"         // For VOLTAGE_DETECTION
 
 #if defined(__AVR_MEGA__)
   // Only runs on Atmega (AVR) processors
@@ -57,5 +65,48 @@
   #if defined(MIGHTYCORE)
     // The 8535 isn't defined as __AVR_MEGA__, but works
     #include "sup_isr_Mega.h"
+  #elif defined(AP_DCC_HOST)
+    // Host (PC) build, for simulation and analysis of recorded DCC traffic
+    #include "sup_isr_Host.h"
   #endif
 #endif
+
+
+//******************************************************************************************************
+// The capture timer as clock (DCC_CLOCK). now() depends on the ISR variant; the conversion does not
+//******************************************************************************************************
+#if defined(DCC_CLOCK)
+CaptureClock::CaptureClock() {
+  ticksPerMs = F_CPU / 1000UL;
+}
+
+
+unsigned long CaptureClock::millis(void) {
+  // Normally at most one millisecond has passed since the previous call, so subtraction is cheaper
+  // than a 32 bit division
+  uint32_t elapsed = now() - msTicks;
+  while (elapsed >= ticksPerMs) {
+    elapsed -= ticksPerMs;
+    msTicks += ticksPerMs;
+    ms++;
+  }
+  return ms;
+}
+
+
+unsigned long CaptureClock::micros(void) {
+  // Wraps after 2^32 us, like the micros() of the Arduino core
+  unsigned long result = millis() * 1000UL;
+  return result + ((now() - msTicks) * 1000UL) / ticksPerMs;
+}
+
+
+void CaptureClock::rescale(uint16_t newTicksPerMs) {
+  // The ticks between now() and the clock change (a few us) are counted at the new rate
+  millis();
+  uint32_t time = now();
+  uint32_t part = time - msTicks;
+  msTicks = time - (part * newTicksPerMs) / ticksPerMs;
+  ticksPerMs = newTicksPerMs;
+}
+#endif
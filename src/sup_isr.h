@@ -8,6 +8,11 @@
 //            2021-09-02 V1.2.0 ap Restructure, to better support different ATmega processors
 //                                 DCC signal detection is significantly improved if used with
 //                                 an ATmegaX (ATmega4808, ATmega4809, AVR DA, AVR DB, ...) processor
+//            2026-10-18 V1.2.1 ap Interrupt latency monitor (ISR_LATENCY_MONITOR)
+//            2026-10-18 V1.2.2 ap Packet queue (PacketQueueSize)
+//            2026-10-18 V1.2.3 ap Edge delay compensation (DCC_EDGE_COMPENSATION)
+//            2026-10-18 V1.2.4 ap Time base from the capture timer (DCC_CLOCK)
+//            2026-10-18 V1.2.5 ap Half bit limits in RAM, for a clock that changes (CLOCK_SCALING)
 //
 // history:   This is a further development of the OpenDecoder 2 software, as developed by W. Kufer.
 //            It implements the DCC receiver code, in particular the layer 1 (bit detection) and
@@ -34,14 +39,37 @@ class DccMessage {
 
     void attach(uint8_t dccPin, uint8_t ackPin);  // Initialises the timer and DCC input Interrupt Service Routines
     void detach(void);                            // Stops the timer and DCC input ISRs, for example before a restart
+    #if defined(CLOCK_SCALING)
+    bool setClock(uint8_t mhz);                   // Changes the main clock, and all that depends on it
+    #endif
 
   private:
     uint8_t _dccPin;                              // Here we store a local copy of the DCC input pin
     void initTcb(void);                           // Specific for the MegaCoreX/DxCore variant
     void initEventSystem(uint8_t dccPin);         // Specific for the MegaCoreX/DxCore variant
+    void initComparator(void);                    // Specific for the MegaCoreX/DxCore variant (DCC_USES_AC0)
 };
 
 
+// Without queue, a packet that arrives before dcc.input() has handled the previous one overwrites
+// that packet. With PacketQueueSize > 1 the ISR puts packets in a ring buffer instead, and dcc.input()
+// copies the oldest to dccMessage. The ISR only changes head, input() only tail; both change count.
+// If the queue holds depth packets, new packets are dropped and counted.
+#if (PacketQueueSize > 1)
+class DccQueue {
+  public:
+    volatile uint8_t size[PacketQueueSize];
+    volatile uint8_t data[PacketQueueSize][MaxDccSize];
+    volatile uint8_t head;                        // Next entry the ISR writes
+    volatile uint8_t tail;                        // Next entry dcc.input() reads
+    volatile uint8_t count;                       // Packets in the queue
+    volatile uint8_t depth;                       // Maximum packets in the queue (1..PacketQueueSize)
+    volatile uint16_t overflows;                  // Packets dropped, since the queue was full
+};
+extern DccQueue dccQueue;                         // Instantiated in AP_DCC_library.cpp
+#endif
+
+
 
 // For certain types of decoders (such as occupancy detectors) the voltage over certain resistors
 // must be measured to determine if a track is occupied or not. There will only be a non-zero
@@ -54,3 +82,159 @@ class AdcStart {
   public: volatile uint8_t newRequest;   // Flag to signal new ADC conversion should start
 };
 #endif
+
+
+// The ISR measures half bits in ticks of the main clock. Normally the limits of RCN-210 (section 5)
+// follow from F_CPU at compile time. If "CLOCK_SCALING" is defined, the main clock may change at
+// runtime; the limits are then kept in RAM, and DccMessage::setClock() recomputes them with
+// interrupts disabled, together with the clock change. They are only changed with interrupts
+// disabled, so the ISR may read them without volatile.
+#if defined(CLOCK_SCALING)
+#if !defined(DCC_CLOCK)
+#error "CLOCK_SCALING requires DCC_CLOCK, since millis() of the Arduino core assumes F_CPU"
+#endif
+#if defined(RAILCOM) || defined(LOCONET) || defined(SUSI_MASTER)
+#error "CLOCK_SCALING can't be combined with RAILCOM, LOCONET or SUSI_MASTER (baud rates from F_CPU)"
+#endif
+#if !defined(AP_DCC_HOST) && !defined(CLKCTRL_FRQSEL_gm)
+#error "CLOCK_SCALING requires a processor with a high frequency oscillator (AVR Dx, EA)"
+#endif
+
+class BitLimits {
+  public:
+    BitLimits() { set(F_CPU / 1000000UL); }
+    void set(uint8_t newMhz) {
+      mhz = newMhz;
+      oneMin = (uint16_t)newMhz * 52;
+      oneMax = (uint16_t)newMhz * 64;
+      zeroMin = (uint16_t)newMhz * 90;
+      zeroMax = (uint16_t)newMhz * 119;
+    }
+    uint16_t oneMin;
+    uint16_t oneMax;
+    uint16_t zeroMin;
+    uint16_t zeroMax;
+    uint8_t mhz;                                  // The main clock, in MHz
+};
+extern BitLimits isrBitLimits;                    // Instantiated in the ISR variant (sup_isr_xxx.h)
+#define TicksPerUs ((uint16_t)isrBitLimits.mhz)
+#else
+#define TicksPerUs (F_CPU / 1000000UL)
+#endif
+
+
+// With TCB capture the moment of an edge is exact, but the ISR may start late if other ISRs are
+// running. If the ISR starts after the next edge has arrived, that edge is lost without any trace.
+// If "ISR_LATENCY_MONITOR" is defined, the capture ISR measures for every edge the entry latency
+// (time between the edge and the start of the ISR, in F_CPU ticks), and maintains a histogram.
+// Buckets are 2^LatencyShift ticks wide (4us at 16MHz); the last bucket holds all larger values.
+// Overruns are edges that may have been lost: the ISR started later than the shortest half bit, or
+// a new capture was already pending once the ISR had read the previous one.
+#if defined(ISR_LATENCY_MONITOR)
+#define LatencyBuckets 8
+#if (F_CPU >= 32000000)
+  #define LatencyShift 7
+#elif (F_CPU >= 16000000)
+  #define LatencyShift 6
+#else
+  #define LatencyShift 5
+#endif
+
+class IsrLatency {
+  public:
+    volatile uint32_t histogram[LatencyBuckets];
+    volatile uint16_t maximum;                    // In F_CPU ticks
+    volatile uint16_t overruns;
+
+    inline void record(uint16_t latency, bool overrun) __attribute__((always_inline)) {
+      uint8_t bucket = latency >> LatencyShift;
+      if (bucket >= LatencyBuckets) bucket = LatencyBuckets - 1;
+      histogram[bucket]++;
+      if (latency > maximum) maximum = latency;
+      if (overrun) overruns++;
+    }
+};
+#endif
+
+
+// The delay of an optocoupler (or comparator) differs for rising and falling edges. A half bit that
+// ends on a rising edge is then measured (riseDelay - fallDelay) longer than it is, and a half bit
+// that ends on a falling edge that much shorter. If "DCC_EDGE_COMPENSATION" is defined, the ISR
+// corrects every edge by skew ticks. During calibration the ISR sums the one half bits (with a wider
+// window than normal) per edge, until EdgeSamples of each are collected. The skew is half of the
+// difference between both averages; calculated in the ISR, since the division is a shift.
+#if defined(DCC_EDGE_COMPENSATION)
+#define EdgeSamples 64
+#define EdgeCalMin (TicksPerUs * 40)
+#define EdgeCalMax (TicksPerUs * 76)
+
+class EdgeSkew {
+  public:
+    volatile int16_t skew;                        // In ticks of the main clock; subtracted from rising edges
+    volatile uint8_t calibrating;
+    volatile uint8_t countRising;
+    volatile uint8_t countFalling;
+    volatile uint32_t sumRising;
+    volatile uint32_t sumFalling;
+
+    inline uint16_t compensate(uint16_t delta, uint8_t rising) {
+      if (calibrating) sample(delta, rising);
+      if (rising) return delta - skew;
+      return delta + skew;
+    }
+
+  private:
+    inline void sample(uint16_t delta, uint8_t rising) {
+      if ((delta < EdgeCalMin) || (delta > EdgeCalMax)) return;
+      if (rising) {
+        if (countRising == EdgeSamples) return;
+        sumRising += delta;
+        countRising++;
+      }
+      else {
+        if (countFalling == EdgeSamples) return;
+        sumFalling += delta;
+        countFalling++;
+      }
+      if ((countRising == EdgeSamples) && (countFalling == EdgeSamples)) {
+        skew = (int16_t)(((int32_t)(sumRising - sumFalling)) / (2 * EdgeSamples));
+        calibrating = 0;
+      }
+    }
+};
+#endif
+
+
+// Small processors run out of TCBs: the DCC input takes one, millis() another. If "DCC_CLOCK" is
+// defined, the TCB that captures the DCC edges is also the clock of the library. In Frequency
+// Measurement Mode the counter restarts at every captured edge, and CCMP holds the ticks since the
+// previous one; the ISR adds these to ticks. If no edge arrives for 65536 ticks, the counter wraps
+// and the overflow interrupt (same vector) adds 65536. The time is then ticks plus the current CNT.
+// The TCB settings are not changed, so the capture precision stays the same. millis() and micros()
+// convert in the main loop, by subtraction; they must be called at least once per 2^32 ticks
+// (268 seconds at 16MHz), which dcc.input() does. The clock runs while the DCC input is attached.
+// With CLOCK_SCALING, rescale() is called just before the main clock changes; the part of the
+// current millisecond that has passed is then converted into ticks of the new clock.
+// Only processors whose TCB has an overflow interrupt (AVR Dx, EA, tinyAVR 2) are supported; megaAVR 0
+// (ATmega 4808 / 4809) TCBs can't signal an overflow, so the time would stop without DCC signal.
+#if defined(DCC_CLOCK)
+#if !defined(AP_DCC_HOST) && (!defined(TCB_OVF_bm) || defined(ARDUINO_AVR_NANO_EVERY))
+#error "DCC_CLOCK requires a processor whose TCB has an overflow interrupt (AVR Dx, EA, tinyAVR 2)"
+#endif
+
+class CaptureClock {
+  public:
+    CaptureClock();
+    volatile uint32_t ticks;                      // Clock ticks upto the last capture or overflow
+    uint32_t now(void);                           // ticks plus CNT. Specific for each ISR variant
+    unsigned long millis(void);                   // Main loop only
+    unsigned long micros(void);
+    void rescale(uint16_t newTicksPerMs);         // Main loop only, with interrupts enabled
+
+  private:
+    uint32_t msTicks;                             // Value of now() at the start of millisecond ms
+    unsigned long ms;
+    uint16_t ticksPerMs;                          // F_CPU / 1000, unless the clock was changed
+};
+extern CaptureClock captureClock;                 // Instantiated in the ISR variant (sup_isr_xxx.h)
+#endif
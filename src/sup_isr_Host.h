@@ -0,0 +1,302 @@
+//******************************************************************************************************
+//
+// file:     sup_isr_Host.h
+// purpose:  DCC receive code for a host (PC) build, driven by the virtual time Arduino shim
+//           that can be found in extras/Host_Simulation
+// author:   Aiko Pras
+// version:  2026-10-18 V1.0.0 ap Initial version
+//           2026-10-18 V1.0.1 ap Interrupt latency monitor (ISR_LATENCY_MONITOR)
+//           2026-10-18 V1.0.2 ap Edge delay compensation (DCC_EDGE_COMPENSATION)
+//           2026-10-18 V1.0.3 ap RailCom channel 2 (RAILCOM); the reply is taken at once
+//           2026-10-18 V1.0.4 ap Capture timer as clock (DCC_CLOCK)
+//           2026-10-18 V1.0.5 ap Runtime change of the (virtual) TCB clock (CLOCK_SCALING)
+//
+// Result:   1. The received message is collected in the struct "dccrec.tempMessage".
+//           2. After receiving a complete message, data is copied to "dccMessage.data".
+//           3. The flag "dccMessage.isReady" is set.
+//
+// This variant is only selected if AP_DCC_HOST is defined, which is the case if the library is
+// compiled for a PC together with the Arduino shim in extras/Host_Simulation. It allows the decoder
+// core (Dcc::input() and all analysers) to be run faster than real time, for example to replay
+// an hour of layout traffic within seconds and obtain reproducible results.
+//
+// Howto: The host variant mimics the TCB 'Capture Frequency Measurement Mode' approach of the
+// MegaCoreX / DxCore variant. The simulated DCC pin triggers an interrupt on every edge. The shim
+// stores the (virtual) time of that edge, comparable to the TCB that stores the counter in CCMP.
+// The ISR calculates the number of F_CPU ticks since the previous captured edge, and uses the same
+// RCN-210 half bit thresholds as sup_isr_MegaCoreX_DxCore.h to determine if we have a 0 or 1.
+// Where the TCB variant changes the edge at which it triggers, this variant skips an edge.
+//
+// Half bit durations that are already known (for example from a recorded capture) may be fed
+// directly via dccHostCapture(), thereby bypassing the simulated pin.
+//
+//******************************************************************************************************
+#include <Arduino.h>
+#include "sup_isr.h"
+#include "sup_stack.h"
+#if defined(RAILCOM)
+#include "sup_loco.h"
+#include "sup_railcom.h"
+#endif
+
+
+//******************************************************************************************************
+// 1. Declaration of external objects
+//******************************************************************************************************
+// The dccMessage contains the "raw" DCC packet, as received by the ISR in this file
+// It is instantiated in, and used by, DCC_Library.cpp
+extern DccMessage dccMessage;
+
+// To monitor the ISR entry latency, "ISR_LATENCY_MONITOR" must be defined within "AP_DCC_library.h"
+#if defined(ISR_LATENCY_MONITOR)
+IsrLatency isrLatency;                         // Used by AP_DCC_library.cpp
+#endif
+
+// To correct the edge delays of the input, "DCC_EDGE_COMPENSATION" must be defined within "AP_DCC_library.h"
+#if defined(DCC_EDGE_COMPENSATION)
+EdgeSkew isrEdgeSkew;                          // Used by AP_DCC_library.cpp
+#endif
+
+// To use the capture timer as clock as well, "DCC_CLOCK" must be defined within "AP_DCC_library.h"
+#if defined(DCC_CLOCK)
+CaptureClock captureClock;                     // Used by sup_isr.cpp and sup_timer.h
+#endif
+
+// To change the main clock at runtime, "CLOCK_SCALING" must be defined within "AP_DCC_library.h"
+#if defined(CLOCK_SCALING)
+BitLimits isrBitLimits;                        // Used by AP_DCC_library.cpp and sup_scaler.cpp
+#endif
+
+
+//******************************************************************************************************
+// 2. Defines, definitions and instantiation of local types and variables
+//******************************************************************************************************
+// A host has no GPIORs, so normal variables are used
+volatile uint8_t dccrecState;
+volatile uint8_t tempByte;
+volatile uint8_t dccHalfBit;
+
+// Values for half bits from RCN 210, section 5: http://normen.railcommunity.de/RCN-210.pdf
+#if defined(CLOCK_SCALING)
+#define ONE_BIT_MIN isrBitLimits.oneMin
+#define ONE_BIT_MAX isrBitLimits.oneMax
+#define ZERO_BIT_MIN isrBitLimits.zeroMin
+#define ZERO_BIT_MAX isrBitLimits.zeroMax
+#else
+#define ONE_BIT_MIN F_CPU / 1000000 * 52
+#define ONE_BIT_MAX F_CPU / 1000000 * 64
+#define ZERO_BIT_MIN F_CPU / 1000000 * 90
+#define ZERO_BIT_MAX F_CPU / 1000000 * 119
+#endif
+
+// Possible values for dccrecState
+#define WAIT_PREAMBLE       (1<<0)
+#define WAIT_START_BIT      (1<<1)
+#define WAIT_DATA           (1<<2)
+#define WAIT_END_BIT        (1<<3)
+
+// Possible values for dccHalfBit
+#define EXPECT_ZERO         (1<<0)
+#define EXPECT_ONE          (1<<1)
+#define EXPECT_ANYTHING     (1<<2)
+
+struct {
+  uint8_t bitCount;                           // Count number of preamble bits / if we have a byte
+  volatile uint8_t tempMessage[MaxDccSize];   // Once we have a byte, we store it in the temp message
+  volatile uint8_t tempMessageSize;           // Here we keep track of the size, including XOR
+} dccrec;                                     // The received DCC message is assembled here
+
+struct {
+  uint64_t lastCapture;                       // Virtual time (in F_CPU ticks) of the last captured edge
+  bool skipEdge;                              // Equivalent of changing the TCB trigger edge twice
+  uint8_t pin;                                // The level after the edge tells if it was rising
+  #if defined(CLOCK_SCALING)
+  uint32_t lastTicks;                         // TCB ticks at the last captured edge
+  uint64_t clockSince;                        // Virtual time of the last clock change
+  uint32_t clockBase;                         // TCB ticks at that moment
+  #endif
+} dccHost;
+
+#if defined(CLOCK_SCALING)
+// The virtual time counts F_CPU ticks; the TCB counts isrBitLimits.mhz ticks per us. The ticks are
+// calculated from the last clock change, so that no rounding errors add up
+uint32_t dccHostTicks(uint64_t time) {
+  if (time < dccHost.clockSince) time = dccHost.clockSince;
+  return dccHost.clockBase + (uint32_t)((time - dccHost.clockSince) * isrBitLimits.mhz / (F_CPU / 1000000UL));
+}
+#endif
+
+
+//******************************************************************************************************
+// 3. The capture routine, which implements the DCC Receive Routine
+//******************************************************************************************************
+// Same code as the TCB ISR of sup_isr_MegaCoreX_DxCore.h. Delta holds the number of F_CPU ticks
+// since the previous captured edge
+#define RAILCOM_ELAPSED 0                              // There is no channel 2 timer
+void dccHostCapture(uint16_t delta) {
+  uint8_t DccBitVal;
+
+  if ((delta >= ONE_BIT_MIN) && (delta <= ONE_BIT_MAX)) {
+    if (dccHalfBit & EXPECT_ONE) {                     // This is the second part of the 1 bit
+      dccHalfBit = EXPECT_ANYTHING;
+      DccBitVal = 1;
+    }
+    else if (dccHalfBit & EXPECT_ANYTHING) {           // This is the first part of the 1 bit
+      dccHalfBit = EXPECT_ONE;
+      return;
+    }
+    else {                                             // We expected a 0, but received 1 => abort
+      dccHost.skipEdge = true;                         // Likely J/K should be changed
+      dccHalfBit = EXPECT_ANYTHING;
+      dccrecState = WAIT_PREAMBLE;
+      dccrec.bitCount = 0;
+      return;
+    }
+  }
+  else if ((delta >= ZERO_BIT_MIN) && (delta <= ZERO_BIT_MAX)) {
+    if (dccHalfBit & EXPECT_ZERO) {                    // This is the second part of the 0 bit
+      dccHalfBit = EXPECT_ANYTHING;
+      DccBitVal = 0;
+      }
+    else if (dccHalfBit & EXPECT_ANYTHING) {           // This is the first part of the 0 bit
+      dccHalfBit = EXPECT_ZERO;
+      return;
+    }
+    else {                                             // We expected a 1, but received 0
+      if (dccrecState & WAIT_START_BIT) {              // are we still in the preamble?
+        dccHalfBit = EXPECT_ZERO;
+        return;
+      }
+      else {                                           // This should not happen.
+        dccHalfBit = EXPECT_ANYTHING;
+        dccrecState = WAIT_PREAMBLE;
+        dccrec.bitCount = 0;
+        return;
+      }
+    }
+  }
+  else {
+    // We ignore other halfbits, to avoid interference with orther protocols.
+    return;
+  }
+
+  #include "sup_isr_assemble_packet.h"
+}
+
+
+//******************************************************************************************************
+// 4. DCC Input pin Interrupt Routine
+//******************************************************************************************************
+// Called by the shim for every edge of the simulated DCC signal. The shim provides the virtual time
+// at which the edge occured, which may be earlier than the current time if interrupts were disabled
+void dccHostEdge(uint64_t edgeTime) {
+  if (dccHost.skipEdge) {                          // Counter is not restarted for a skipped edge
+    dccHost.skipEdge = false;
+    return;
+  }
+  uint64_t delta = edgeTime - dccHost.lastCapture;
+  dccHost.lastCapture = edgeTime;
+  #if defined(CLOCK_SCALING)
+  // A half bit that spans a clock change is counted partly in old and partly in new ticks
+  uint32_t ticks = dccHostTicks(edgeTime);
+  delta = ticks - dccHost.lastTicks;
+  dccHost.lastTicks = ticks;
+  #endif
+  #if defined(DCC_CLOCK)
+  captureClock.ticks += (uint32_t) delta;          // CCMP, plus 65536 for each overflow
+  #endif
+  if (delta > 65535) delta = 65535;                // Like a 16 bit TCB, that stops at TOP
+  #if defined(DCC_EDGE_COMPENSATION)
+  delta = isrEdgeSkew.compensate((uint16_t) delta, sim.level[dccHost.pin]);
+  #endif
+  dccHostCapture((uint16_t) delta);
+}
+
+
+void dcc_interrupt(void) {
+  #if defined(ISR_LATENCY_MONITOR)
+  // The shim delivers the interrupt late if interrupts were disabled at the moment of the edge
+  uint64_t latency = sim.now() - simEdgeTime();
+  if (latency > 65535) latency = 65535;
+  isrLatency.record((uint16_t) latency, latency >= ONE_BIT_MIN);
+  #endif
+  dccHostEdge(simEdgeTime());
+}
+
+
+//******************************************************************************************************
+// 5. attach() / detach()
+//******************************************************************************************************
+void DccMessage::attach(uint8_t dccPin, uint8_t ackPin) {
+  // Initialize the local variables
+  _dccPin = dccPin;
+  tempByte = 0;
+  dccrecState = WAIT_PREAMBLE;
+  dccHalfBit = EXPECT_ANYTHING;
+  dccrec.bitCount = 0;
+  dccHost.lastCapture = 0;
+  dccHost.skipEdge = false;
+  dccHost.pin = dccPin;
+  // initialise the global variables (the DccMessage attributes)
+  dccMessage.size = 0;
+  dccMessage.isReady = 0;
+  // Intialise the DCC interupt routine. Like the TCB variant, we trigger on both edges
+  pinMode(dccPin, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(dccPin), dcc_interrupt, CHANGE);
+  // Initialise the DCC Acknowledgement port, which is needed in Service Mode
+  if (ackPin < 255) pinMode(ackPin, OUTPUT);
+}
+
+
+void DccMessage::detach(void) {
+  detachInterrupt(digitalPinToInterrupt(_dccPin));
+}
+
+
+//******************************************************************************************************
+// 6. The capture timer as clock (DCC_CLOCK)
+//******************************************************************************************************
+// The counter has run since the last captured edge. An edge that is still pending (interrupts
+// disabled) has not yet been added to ticks, but is still included in the counter
+#if defined(DCC_CLOCK)
+uint32_t CaptureClock::now(void) {
+  #if defined(CLOCK_SCALING)
+  return ticks + (dccHostTicks(sim.now()) - dccHost.lastTicks);
+  #else
+  return ticks + (uint32_t)(sim.now() - dccHost.lastCapture);
+  #endif
+}
+#endif
+
+
+//******************************************************************************************************
+// 7. Changing the main clock (CLOCK_SCALING)
+//******************************************************************************************************
+// Same as sup_isr_MegaCoreX_DxCore.h, but only the virtual TCB clock changes: the shim itself
+// continues to count F_CPU ticks. Rescaling the counter means moving lastTicks
+#if defined(CLOCK_SCALING)
+bool DccMessage::setClock(uint8_t mhz) {
+  if (!(((mhz >= 1) && (mhz <= 4)) || ((mhz >= 8) && (mhz <= 24) && ((mhz % 4) == 0)))) return false;
+  if (mhz == isrBitLimits.mhz) return true;
+  captureClock.rescale((uint16_t)mhz * 1000);
+  noInterrupts();
+  dccHost.clockBase = dccHostTicks(sim.now());
+  dccHost.clockSince = sim.now();
+  uint32_t count = dccHost.clockBase - dccHost.lastTicks;
+  uint32_t scaled = (count * mhz) / isrBitLimits.mhz;
+  dccHost.lastTicks = dccHost.clockBase - scaled;
+  captureClock.ticks += count - scaled;
+  #if defined(DCC_EDGE_COMPENSATION)
+  isrEdgeSkew.skew = (int16_t)(((int32_t)isrEdgeSkew.skew * mhz) / isrBitLimits.mhz);
+  if (isrEdgeSkew.calibrating) {
+    isrEdgeSkew.sumRising = 0;
+    isrEdgeSkew.sumFalling = 0;
+    isrEdgeSkew.countRising = 0;
+    isrEdgeSkew.countFalling = 0;
+  }
+  #endif
+  isrBitLimits.set(mhz);
+  interrupts();
+  return true;
+}
+#endif
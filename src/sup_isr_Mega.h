@@ -5,6 +5,8 @@
 // author:   Aiko Pras
 // version:  2021-05-15 V1.0.2 ap initial version
 //           2021-09-01 V1.1.1 ap Supports different compilation units for different boards
+//           2026-10-18 V1.1.2 ap Voltage detection is implemented in sup_occupancy.cpp
+//           2026-10-18 V1.1.3 ap Stack probes (STACK_MONITOR)
 //
 // Result:   1. The received message is collected in the struct "dccrec.tempMessage".
 //           2. After receiving a complete message, data is copied to "dccMessage.data".
@@ -49,6 +51,7 @@
 //******************************************************************************************************
 #include <Arduino.h>
 #include "sup_isr.h"
+#include "sup_stack.h"
 
 
 //******************************************************************************************************
@@ -61,8 +64,15 @@ extern DccMessage dccMessage;
 // For certain types of decoders (such as occupancy detectors) the ADC hardware will be initiated
 // To activate that code "VOLTAGE_DETECTION" must be defined within "AP_DCC_library.h"
 #if defined(VOLTAGE_DETECTION)
-#warning "Voltage Detection not (yet?) implemented"
-AdcStart adcStart;
+AdcStart adcStart;                             // Used by sup_occupancy.cpp
+#endif
+
+// The interrupt latency monitor needs the capture timer of the MegaCoreX / DxCore variant
+#if defined(ISR_LATENCY_MONITOR)
+#error "ISR_LATENCY_MONITOR requires a MegaCoreX or DxCore board"
+#endif
+#if defined(DCC_EDGE_COMPENSATION)
+#error "DCC_EDGE_COMPENSATION requires a MegaCoreX or DxCore board"
 #endif
 
 
@@ -258,6 +268,7 @@ void DccMessage::detach(void) {
 // Timer2 Interrupt Routine: read the value of the DCC signal
 // Execution of this DCC Receive code typically takes between 3 and 8 microseconds.
 ISR(TIMER2_OVF_vect) {
+  STACK_PROBE(STACK_PROBE_ISR);
   // Read the DCC input value, if the input is low then its a 1 bit, otherwise it is a 0 bit
   uint8_t DccBitVal;
   DccBitVal = !(*dccIn.portRegister & dccIn.bit);
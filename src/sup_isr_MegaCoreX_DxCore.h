@@ -8,6 +8,14 @@
 //           2024-06-04 V1.2.1 ap - Error corrected in cases where the preamble had an uneven number
 //                                  of halfbits. This error showed up with DxCore and the Z21 system.
 //                                  Some comments are added for implementing RailCom feedback.
+//           2026-10-18 V1.2.2 ap - Optional level 1 priority for the TCB ISR (DCC_ISR_LEVEL1)
+//           2026-10-18 V1.2.3 ap - Starts AD conversions for occupancy detection (VOLTAGE_DETECTION)
+//           2026-10-18 V1.2.4 ap - Interrupt latency monitor (ISR_LATENCY_MONITOR)
+//           2026-10-18 V1.2.5 ap - Stack probes (STACK_MONITOR)
+//           2026-10-18 V1.2.6 ap - Analog comparator input (DCC_USES_AC0) and edge delay compensation
+//           2026-10-18 V1.2.7 ap - Starts RailCom channel 2 at the Packet End Bit (RAILCOM)
+//           2026-10-18 V1.2.8 ap - The TCB is also the clock of the library (DCC_CLOCK)
+//           2026-10-18 V1.2.9 ap - The main clock may be changed at runtime (CLOCK_SCALING)
 //
 // Result:   1. The received message is collected in the struct "dccrec.tempMessage".
 //           2. After receiving a complete message, data is copied to "dccMessage.data".
@@ -19,11 +27,14 @@
 //  - Timer:  One TCB timer. Default is TCB0, but the default can be changed by setting one of the
 //            #defines (DCC_USES_TIMERB1, DCC_USES_TIMERB2 or DCC_USES_TIMERB3)
 //            No dependancies exist with other timers, thus the TCA prescaler is NOT used.
+//            If DCC_CLOCK is defined, the same TCB is the clock of the library (see sup_isr.h), so
+//            the timer of millis() may be used by the main sketch (DxCore only).
 //  - Event:  One of the Event channels available in ATmegaX processors.
 //            The software automatically selects an available channel.
 //            Not every pin can be connected to every Event channel. If other software has already
 //            claimed usage of some channels, it might be necessary to select a DCC input pin on 
 //            another port. See also: https://github.com/MCUdude/MegaCoreX#event-system-evsys
+//  - AC0:    Only if DCC_USES_AC0 is defined: the analog comparator and its two input pins.
 //
 // Howto: This part of the library takes advantage of the Event system peripheral that is implemented
 // in the novel ATmegaX processors, and which is supported by MegaCoreX and DxCore.
@@ -46,17 +57,20 @@
 // https://github.com/MCUdude/MegaCoreX#event-system-evsys
 // https://github.com/SpenceKonde/DxCore 
 //
-// Note: Railcom feedback has not been implemented.
-// Implementation could be relatively easy by using an additional timer to determine the exact moment
-// the railcom data should be send. This moment could be the moment that the Packet End Bit is detected
-// (see sup_isr_assemble_packet.h). Once this railcom timer fires, a UART starts sending the railcom
-// data. The Event and CCL peripherals can be used to connect the RailCom timer with the UART and the
-// RailCom output pin.
+// Note: If RAILCOM is defined, channel 2 of the RailCom cutout is used (see sup_railcom.cpp).
+// At the moment the Packet End Bit is detected (see sup_isr_assemble_packet.h), an additional timer
+// is started. Once this railcom timer fires, a UART starts sending the railcom data. Channel 1 has not
+// been implemented.
 //
 //******************************************************************************************************
 #include <Arduino.h>
 #include <Event.h>
 #include "sup_isr.h"
+#include "sup_stack.h"
+#if defined(RAILCOM)
+#include "sup_loco.h"
+#include "sup_railcom.h"
+#endif
 
 
 //******************************************************************************************************
@@ -66,6 +80,32 @@
 // It is instantiated in, and used by, DCC_Library.cpp
 extern DccMessage dccMessage;
 
+// For certain types of decoders (such as occupancy detectors) the ADC hardware will be initiated
+// To activate that code "VOLTAGE_DETECTION" must be defined within "AP_DCC_library.h"
+#if defined(VOLTAGE_DETECTION)
+AdcStart adcStart;                             // Used by sup_occupancy.cpp
+#endif
+
+// To monitor the ISR entry latency, "ISR_LATENCY_MONITOR" must be defined within "AP_DCC_library.h"
+#if defined(ISR_LATENCY_MONITOR)
+IsrLatency isrLatency;                         // Used by AP_DCC_library.cpp
+#endif
+
+// To correct the edge delays of the input, "DCC_EDGE_COMPENSATION" must be defined within "AP_DCC_library.h"
+#if defined(DCC_EDGE_COMPENSATION)
+EdgeSkew isrEdgeSkew;                          // Used by AP_DCC_library.cpp
+#endif
+
+// To use the TCB as clock as well, "DCC_CLOCK" must be defined within "AP_DCC_library.h"
+#if defined(DCC_CLOCK)
+CaptureClock captureClock;                     // Used by sup_isr.cpp and sup_timer.h
+#endif
+
+// To change the main clock at runtime, "CLOCK_SCALING" must be defined within "AP_DCC_library.h"
+#if defined(CLOCK_SCALING)
+BitLimits isrBitLimits;                        // Used by AP_DCC_library.cpp and sup_scaler.cpp
+#endif
+
 
 //******************************************************************************************************
 // 2. Defines that may need to be modified to accomodate certain hardware
@@ -78,6 +118,26 @@ extern DccMessage dccMessage;
 // #define DCC_USES_TIMERB2
 // #define DCC_USES_TIMERB3
 
+// These processors do not support nested interrupts, but one interrupt vector may be given a higher
+// priority (level 1). A level 1 ISR may interrupt all normal (level 0) ISRs. If the sketch or other
+// libraries run long or frequent ISRs (for example to feed a DAC with sound samples, or to generate
+// stepper pulses), the DCC ISR may start too late and DCC bits may get lost. By uncommenting the
+// following define the DCC ISR gets level 1 priority, and the DCC path stays lossless as long as the
+// other ISRs are level 0. Note that only a single interrupt vector can have level 1.
+// #define DCC_ISR_LEVEL1
+
+// Instead of a pin, the output of analog comparator AC0 may trigger the TCB. The track signal is
+// then connected via two voltage dividers (for example 47k / 4k7, the lower resistors to ground of
+// the bridge rectifier) to the positive and negative comparator inputs, and no optocoupler is
+// needed. Hysteresis avoids multiple edges on slow or noisy transitions: 0 = off, 1 = 10mV,
+// 2 = 25mV, 3 = 50mV (ATmega 4808/4809); on AVR Dx: none, small, medium, large.
+// The inputs are AINPn and AINNn; AINP0 and AINN0 are PD2 and PD3 on ATmega 4809 and AVR DA / DB.
+// The dccPin parameter of dcc.attach() is not used in this case.
+// #define DCC_USES_AC0
+#define DCC_AC_POSITIVE    0                   // AINP0
+#define DCC_AC_NEGATIVE    0                   // AINN0
+#define DCC_AC_HYSTERESIS  2
+
 // GPIOR (General Purpose IO Registers) are used to store global flags and temporary bytes.
 // For example, in case of dccHalfBit, GPIOR saves roughly 8 clock cycli per interrupt.
 // In case the selected GPIORs conflict with other libraries, change to any any free GPIOR
@@ -94,10 +154,18 @@ extern DccMessage dccMessage;
 // 3. Defines, definitions and instantiation of local types and variables
 //******************************************************************************************************
 // Values for half bits from RCN 210, section 5: http://normen.railcommunity.de/RCN-210.pdf
+// With CLOCK_SCALING these are recomputed at each clock change (see sup_isr.h)
+#if defined(CLOCK_SCALING)
+#define ONE_BIT_MIN isrBitLimits.oneMin
+#define ONE_BIT_MAX isrBitLimits.oneMax
+#define ZERO_BIT_MIN isrBitLimits.zeroMin
+#define ZERO_BIT_MAX isrBitLimits.zeroMax
+#else
 #define ONE_BIT_MIN F_CPU / 1000000 * 52
 #define ONE_BIT_MAX F_CPU / 1000000 * 64
 #define ZERO_BIT_MIN F_CPU / 1000000 * 90
 #define ZERO_BIT_MAX F_CPU / 1000000 * 119
+#endif
 
 
 // #define ZERO_BIT_MAX 65535
@@ -138,27 +206,42 @@ void DccMessage::initTcb(void) {
     #define timer_EVCTRL TCB0_EVCTRL
     #define timer_CCMPL  TCB0_CCMPL       // 8 bit (not used in this implementation)
     #define timer_CCMP   TCB0_CCMP        // 16 bit
+    #define timer_CNT    TCB0_CNT
+    #define timer_INTFLAGS TCB0_INTFLAGS
+    #define timer_VECT   TCB0_INT_vect_num
   #elif defined(DCC_USES_TIMERB1)
     _timer = &TCB1;
     #define timer_EVCTRL TCB1_EVCTRL
     #define timer_CCMPL  TCB1_CCMPL
     #define timer_CCMP   TCB1_CCMP
+    #define timer_CNT    TCB1_CNT
+    #define timer_INTFLAGS TCB1_INTFLAGS
+    #define timer_VECT   TCB1_INT_vect_num
   #elif defined(DCC_USES_TIMERB2)
     _timer = &TCB2;
     #define timer_EVCTRL TCB2_EVCTRL
     #define timer_CCMPL  TCB2_CCMPL
     #define timer_CCMP   TCB2_CCMP
+    #define timer_CNT    TCB2_CNT
+    #define timer_INTFLAGS TCB2_INTFLAGS
+    #define timer_VECT   TCB2_INT_vect_num
   #elif defined(DCC_USES_TIMERB3)
     _timer = &TCB3;
     #define timer_EVCTRL TCB3_EVCTRL
     #define timer_CCMPL  TCB3_CCMPL
     #define timer_CCMP   TCB3_CCMP
+    #define timer_CNT    TCB3_CNT
+    #define timer_INTFLAGS TCB3_INTFLAGS
+    #define timer_VECT   TCB3_INT_vect_num
   #else  
     // fallback to TCB0 (every platform has it)
     _timer = &TCB0;
     #define timer_EVCTRL TCB0_EVCTRL
     #define timer_CCMPL  TCB0_CCMPL
     #define timer_CCMP   TCB0_CCMP
+    #define timer_CNT    TCB0_CNT
+    #define timer_INTFLAGS TCB0_INTFLAGS
+    #define timer_VECT   TCB0_INT_vect_num
   #endif
   // Step 2: fill the registers. See the data sheets for details
   noInterrupts();
@@ -175,14 +258,40 @@ void DccMessage::initTcb(void) {
   _timer->CTRLB = TCB_CNTMODE_FRQ_gc;               // Input Capture Frequency Measurement mode
   _timer->EVCTRL = TCB_CAPTEI_bm | TCB_FILTER_bm;   // Enable input capture events and noise cancelation
   _timer->INTCTRL |= TCB_CAPT_bm;                   // Enable CAPT interrupts
+  #if defined(DCC_CLOCK)
+  _timer->INTCTRL |= TCB_OVF_bm;                    // The clock continues without DCC signal
+  #endif
+  // Step 3: if requested, the TCB ISR may interrupt all other ISRs
+  #if defined(DCC_ISR_LEVEL1)
+  CPUINT.LVL1VEC = timer_VECT;
+  #endif
   interrupts();
 }
 
 
+void DccMessage::initComparator(void) {
+  #if defined(DCC_USES_AC0)
+  // The input selection is MUXCTRLA on ATmega 4808/4809 and MUXCTRL on AVR Dx; bit positions are equal
+  noInterrupts();
+  #if defined(AC0_MUXCTRLA)
+  AC0.MUXCTRLA = (DCC_AC_POSITIVE << AC_MUXPOS_gp) | (DCC_AC_NEGATIVE << AC_MUXNEG_gp);
+  #else
+  AC0.MUXCTRL = (DCC_AC_POSITIVE << AC_MUXPOS_gp) | (DCC_AC_NEGATIVE << AC_MUXNEG_gp);
+  #endif
+  AC0.CTRLA = AC_ENABLE_bm | (DCC_AC_HYSTERESIS << AC_HYSMODE_gp);
+  interrupts();
+  #endif
+}
+
+
 void DccMessage::initEventSystem(uint8_t dccPin) {
   // Note: this code uses the new Event Library of MegaCoreX / DxCore
   noInterrupts();
+  #if defined(DCC_USES_AC0)
+  Event& myEvent = Event::assign_generator(gen::ac0_out);
+  #else
   Event& myEvent = Event::assign_generator_pin(dccPin);
+  #endif
   #if defined(DCC_USES_TIMERB0)
     myEvent.set_user(user::tcb0_capt);
   #elif defined(DCC_USES_TIMERB1)
@@ -212,8 +321,9 @@ void DccMessage::attach(uint8_t dccPin, uint8_t ackPin) {
   // initialise the global variables (the DccMessage attributes)
   dccMessage.size = 0;
   dccMessage.isReady = 0;
-  // Initialize the peripherals: (TCBx) timer and the Event system.
+  // Initialize the peripherals: (TCBx) timer, the analog comparator (if used) and the Event system.
   initTcb();
+  initComparator();
   initEventSystem(dccPin);
   // Initialise the DCC Acknowledgement port, which is needed in Service Mode
   // If the main sketch doesn't specify this pin, the value 255 is provided as
@@ -233,6 +343,9 @@ void DccMessage::detach(void) {
   _timer->CCMP = 0;
   _timer->CNT = 0;
   _timer->INTFLAGS = 0;
+  #if defined(DCC_USES_AC0)
+  AC0.CTRLA = 0;
+  #endif
   // Stop the Event channel  interrupts();
   interrupts();
 }
@@ -242,6 +355,9 @@ void DccMessage::detach(void) {
 // 6. The Timer ISR, which implements the DCC Receive Routine
 //******************************************************************************************************
 // Execution of this DCC Receive code typically takes between 3 and 8 microseconds.
+// In Frequency Measurement Mode the counter restarts at each edge, so at the Packet End Bit it tells
+// how long ago that bit ended.
+#define RAILCOM_ELAPSED timer_CNT
 // Select the corresponding ISR
 #if defined(DCC_USES_TIMERB0)
   ISR(TCB0_INT_vect) {
@@ -258,9 +374,42 @@ void DccMessage::detach(void) {
   ISR(TCB0_INT_vect) {
 #endif
   
+  STACK_PROBE(STACK_PROBE_ISR);
+  #if defined(DCC_CLOCK)
+  // The overflow shares the vector. If no edge was captured as well, there is nothing more to do
+  if (timer_INTFLAGS & TCB_OVF_bm) {
+    timer_INTFLAGS = TCB_OVF_bm;
+    captureClock.ticks += 65536UL;
+    if (!(timer_INTFLAGS & TCB_CAPT_bm)) return;
+  }
+  #endif
+  // In Frequency Measurement Mode the counter restarts at the captured edge, thus CNT tells how late
+  // this ISR started. It is read first, before it runs away
+  #if defined(ISR_LATENCY_MONITOR)
+  uint16_t latency = timer_CNT;
+  #endif
   timer_EVCTRL ^= TCB_EDGE_bm;                         // Change the event edge at which we trigger
+  // For occupancy decoders: if we were triggered by a rising edge (we now wait for a falling edge),
+  // the DCC input is high for at least 52us. Start the AD conversion as early as possible.
+  #if defined(VOLTAGE_DETECTION)
+  if (adcStart.newRequest && (timer_EVCTRL & TCB_EDGE_bm)) {
+    ADC0.COMMAND = ADC_STCONV_bm;
+    adcStart.newRequest = 0;
+  }
+  #endif
   uint16_t  delta = timer_CCMP;                        // Delta holds the time since the previous interrupt 
   uint8_t DccBitVal;
+  #if defined(DCC_CLOCK)
+  captureClock.ticks += delta;                         // Before edge compensation: the real time
+  #endif
+  #if defined(ISR_LATENCY_MONITOR)
+  // Reading CCMP cleared CAPT; if it is set again, a newer edge has already been captured
+  isrLatency.record(latency, (latency >= ONE_BIT_MIN) || (timer_INTFLAGS & TCB_CAPT_bm));
+  #endif
+  #if defined(DCC_EDGE_COMPENSATION)
+  // The edge was already changed: if we now wait for a falling edge, this was a rising edge
+  delta = isrEdgeSkew.compensate(delta, timer_EVCTRL & TCB_EDGE_bm);
+  #endif
 
   if ((delta >= ONE_BIT_MIN) && (delta <= ONE_BIT_MAX)) {
     if (dccHalfBit & EXPECT_ONE) {                     // This is the second part of the 1 bit
@@ -321,3 +470,68 @@ void DccMessage::detach(void) {
     
   #include "sup_isr_assemble_packet.h"
 }
+
+
+//******************************************************************************************************
+// 7. The TCB as clock (DCC_CLOCK)
+//******************************************************************************************************
+// If an edge is captured or the counter wraps while ticks and CNT are read, CNT has restarted but
+// the ISR hasn't yet added the previous value to ticks. The interrupt is then enabled shortly, so
+// that the ISR can run, and both are read again. Should not be called with interrupts disabled.
+#if defined(DCC_CLOCK)
+uint32_t CaptureClock::now(void) {
+  uint32_t result;
+  uint8_t pending;
+  do {
+    noInterrupts();
+    result = ticks + timer_CNT;
+    pending = timer_INTFLAGS & (TCB_CAPT_bm | TCB_OVF_bm);
+    interrupts();
+  } while (pending);
+  return result;
+}
+#endif
+
+
+//******************************************************************************************************
+// 8. Changing the main clock (CLOCK_SCALING)
+//******************************************************************************************************
+// The main clock must be the internal high frequency oscillator, without prescaler. It runs at 1, 2,
+// 3 or 4 MHz, or a multiple of 4 MHz upto 24 MHz (20 MHz on AVR EA). The TCB runs at CLK_PER, so it
+// follows the new clock without changes; only the half bit limits and the edge skew, which are in
+// ticks, are recomputed. This is done with interrupts disabled, together with the clock change.
+// The half bit that spans the change would be measured partly in old and partly in new ticks.
+// Therefore the counter, which holds the old ticks since the last edge, is rescaled as well; the
+// difference is subtracted from captureClock.ticks, so captureClock.now() doesn't jump. The
+// receiver is not reset, since resynchronising in the middle of a packet may take a few packets.
+#if defined(CLOCK_SCALING)
+bool DccMessage::setClock(uint8_t mhz) {
+  uint8_t frqsel;
+  if ((mhz >= 1) && (mhz <= 4)) frqsel = mhz - 1;
+  else if ((mhz >= 8) && (mhz <= 24) && ((mhz % 4) == 0)) frqsel = (mhz / 4) + 3;
+  else return false;
+  if ((CLKCTRL.MCLKCTRLA & CLKCTRL_CLKSEL_gm) != CLKCTRL_CLKSEL_OSCHF_gc) return false;
+  if (CLKCTRL.MCLKCTRLB & CLKCTRL_PEN_bm) return false;
+  if (mhz == isrBitLimits.mhz) return true;
+  captureClock.rescale((uint16_t)mhz * 1000);
+  noInterrupts();
+  _PROTECTED_WRITE(CLKCTRL.OSCHFCTRLA, (CLKCTRL.OSCHFCTRLA & ~CLKCTRL_FRQSEL_gm) | (frqsel << CLKCTRL_FRQSEL_gp));
+  uint16_t count = timer_CNT;                       // Old ticks since the last captured edge
+  uint32_t scaled = ((uint32_t)count * mhz) / isrBitLimits.mhz;
+  if (scaled > 65535UL) scaled = 65535UL;
+  timer_CNT = (uint16_t)scaled;
+  captureClock.ticks += count - scaled;
+  #if defined(DCC_EDGE_COMPENSATION)
+  isrEdgeSkew.skew = (int16_t)(((int32_t)isrEdgeSkew.skew * mhz) / isrBitLimits.mhz);
+  if (isrEdgeSkew.calibrating) {                    // Samples of two clocks can't be combined
+    isrEdgeSkew.sumRising = 0;
+    isrEdgeSkew.sumFalling = 0;
+    isrEdgeSkew.countRising = 0;
+    isrEdgeSkew.countFalling = 0;
+  }
+  #endif
+  isrBitLimits.set(mhz);
+  interrupts();
+  return true;
+}
+#endif
@@ -6,6 +6,7 @@
 //           See: https://github.com/MCUdude/MegaCoreX
 // author:   Aiko Pras
 // version:  2021-09-01 V1.0.0 ap Initial version
+//           2026-10-18 V1.0.1 ap Stack probes (STACK_MONITOR)
 //
 // Result:   1. The received message is collected in the struct "dccrec.tempMessage".
 //           2. After receiving a complete message, data is copied to "dccMessage.data".
@@ -39,6 +40,7 @@
 //******************************************************************************************************
 #include <Arduino.h>
 #include "sup_isr.h"
+#include "sup_stack.h"
 
 
 //******************************************************************************************************
@@ -48,6 +50,20 @@
 // It is instantiated in, and used by, DCC_Library.cpp
 extern DccMessage dccMessage;
 
+// For certain types of decoders (such as occupancy detectors) the ADC hardware will be initiated
+// To activate that code "VOLTAGE_DETECTION" must be defined within "AP_DCC_library.h"
+#if defined(VOLTAGE_DETECTION)
+AdcStart adcStart;                             // Used by sup_occupancy.cpp
+#endif
+
+// The interrupt latency monitor needs the capture timer of the MegaCoreX / DxCore variant
+#if defined(ISR_LATENCY_MONITOR)
+#error "ISR_LATENCY_MONITOR requires a MegaCoreX or DxCore board"
+#endif
+#if defined(DCC_EDGE_COMPENSATION)
+#error "DCC_EDGE_COMPENSATION requires a MegaCoreX or DxCore board"
+#endif
+
 
 //******************************************************************************************************
 // 2. Defines that may need to be modified to accomodate certain hardware
@@ -244,6 +260,7 @@ ISR(TCB3_INT_vect) {
 // fallback to TCB0 (every platform has it)
 ISR(TCB0_INT_vect) {
 #endif
+  STACK_PROBE(STACK_PROBE_ISR);
   // Read the DCC input value, if the input is low then its a 1 bit, otherwise it is a 0 bit
   uint8_t DccBitVal;     
   DccBitVal = !(*dccIn.portRegister & dccIn.bit);
@@ -251,6 +268,15 @@ ISR(TCB0_INT_vect) {
   _timer->INTFLAGS |= TCB_CAPT_bm;      // We had an interrupt
   _timer->CTRLA &= ~TCB_ENABLE_bm;      // Clear Timer Enable
   _timer->CNT = 0;                      // CNT will not reset automatically
+  // For occupancy decoders: start a new AD conversion if the input is still high (DCC 0 bit)
+  #if defined(VOLTAGE_DETECTION)
+  if (adcStart.newRequest) {
+    if (DccBitVal == 0) {
+      ADC0.COMMAND = ADC_STCONV_bm;
+      adcStart.newRequest = 0;
+    }
+  }
+  #endif
   // Add the captured byte to the message 
   #include "sup_isr_assemble_packet.h"
 }
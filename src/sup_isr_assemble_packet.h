@@ -77,12 +77,29 @@
     if( DccBitVal ) // End of packet?
     {
       // Complete packet received and no errors
-      // If somewhere in the future Railcom feedback will be implemented, this could be
-      // the place to start a timer that determines the exact moment a UART should start
-      // sending the RailCom feedback data.
+      // This is the moment to start the timer that determines when the UART should start
+      // sending the RailCom feedback data (see sup_railcom.cpp)
       uint8_t i;
       uint8_t bytes_received;
       bytes_received = dccrec.tempMessageSize;
+      #if defined(RAILCOM)
+      railcomMessage.packetEnd(dccrec.tempMessage, bytes_received, RAILCOM_ELAPSED);
+      #endif
+      STACK_PROBE(STACK_PROBE_PACKET);
+      #if (PacketQueueSize > 1)
+      // dcc.input() takes the packet from the queue
+      if (dccQueue.count < dccQueue.depth) {
+        uint8_t head = dccQueue.head;
+        for (i=0; i < bytes_received; i++) {
+          dccQueue.data[head][i] = dccrec.tempMessage[i];
+          }
+        dccQueue.size[head] = bytes_received;
+        dccQueue.head = (head + 1 == PacketQueueSize) ? 0 : head + 1;
+        dccQueue.count++;
+      }
+      else dccQueue.overflows++;
+      dccrecState = WAIT_PREAMBLE;
+      #else
       for (i=0; i < bytes_received; i++) {
         dccMessage.data[i] = dccrec.tempMessage[i];
         }
@@ -92,6 +109,7 @@
       noInterrupts();
       dccMessage.isReady = 1;
       interrupts();
+      #endif
     }
     else  // Get next Byte
     dccrecState = WAIT_DATA;
@@ -5,6 +5,7 @@
 // author:    Aiko Pras
 // version:   2021-05-15 V1.0.2 ap initial version
 //            2022-07-21 V1.0.3 ap trainsMoving flag was removed, since we have SomeLocoMovesFlag
+//            2026-10-18 V1.0.4 ap Address matching on the raw packet bytes
 //
 // This source file is subject of the GNU general public license 3,
 // that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
@@ -16,6 +17,7 @@
 #include "sup_loco.h"
 #include "sup_acc.h"
 #include "sup_cv.h"
+#include "sup_stack.h"
 
 // Declaration of external objects
 extern Accessory    acc;                // instantiated in DCC_Library.cpp, used by main sketch
@@ -33,8 +35,7 @@ LocoMessage::LocoMessage() {
   locoCmd.longAddress = false;          // We start with a 7-bit address
   locoCmd.emergencyStop = false;        // Clear flag
   // Ensure that, if not initialised, no messages matches my address
-  myLocoAddressFirst = 65535;
-  myLocoAddressLast  = 65535;
+  setMyAddress(65535, 65535);
   // Set speed to zero, direction to Forward and switch all functions off
   reset_speed();
 }
@@ -54,12 +55,27 @@ void LocoMessage::reset_speed(void) {
 }
 
 
-bool LocoMessage::IsMyAddress() {
-  // The broadcast address for multi function (loco) decoders is 0
-  // This adres is already handled by Dcc::analyze_broadcast_message, and therefore doesn't have
-  // to be considered here.
-  // const unsigned int broadcast_address = 0;
-  return ((locoCmd.address >= myLocoAddressFirst) && (locoCmd.address <= myLocoAddressLast));
+void LocoMessage::setMyAddress(unsigned int first, unsigned int last) {
+  // Since most loco packets are for other decoders, the address range is translated here into the
+  // raw packet bytes that analyse() compares against. Like before, a 7-bit and a 14-bit address
+  // with the same value both match.
+  // - 7-bit addresses (1..127): one bit per address. The broadcast address 0 is already handled by
+  //   Dcc::analyze_broadcast_message, and therefore doesn't have to be considered here.
+  // - 14-bit addresses (0..10239): the first two bytes, read as one big endian word, increase with
+  //   the address. The range is therefore the same as for the address, with 0xC000 added.
+  myLocoAddressFirst = first;
+  myLocoAddressLast = last;
+  for (uint8_t i = 0; i < 16; i++) shortMap[i] = 0;
+  for (unsigned int address = (first < 1) ? 1 : first; (address <= last) && (address <= 127); address++)
+    shortMap[address >> 3] |= (1 << (address & 0x07));
+  if ((first > 10239) || (first > last)) {  // No 14-bit address: first > last
+    longFirst = 0xFFFF;
+    longLast = 0;
+  }
+  else {
+    longFirst = 0xC000 | first;
+    longLast = 0xC000 | ((last > 10239) ? 10239 : last);
+  }
 }
 
 
@@ -94,6 +110,7 @@ bool LocoMessage::IsMyAddress() {
 // analyse is the basic method to decode Loco messages and populate attributes of the LocoMessage object
 
 Dcc::CmdType_t LocoMessage::analyse(void) {
+  STACK_PROBE(STACK_PROBE_LOCO);
   // Most messages that are received are Loco messages, since all locs known to the command station
   // will continiously be informed of latest speed and light information. The majority of loco
   // commands will therefore not be addressed to this decoder. To reduce load of the processor, we
@@ -104,34 +121,51 @@ Dcc::CmdType_t LocoMessage::analyse(void) {
   uint8_t byte0 = dccMessage.data[0];
   uint8_t instructionByte;
   uint8_t dccData;                  // May be filled from data part in instruction or subsequent bytes 
+  bool mine = matches(byte0, dccMessage.data[1]);
 
   //
-  // Step 1: Determine the loco address, and make already a copy of 
-  // the instruction byte that defines the kind of command (CCC bits), as well as data
+  // Step 1: Compare the raw address byte(s) with the precomputed patterns (above), and make already a
+  // copy of the instruction byte that defines the kind of command (CCC bits), as well as data
   if (byte0 & 0b10000000) {         // The first bit differentiates between basic and extended packets
-    locoCmd.longAddress = true;     // It is an extended packet, with a 12 bit address (1..4096)
-    locoCmd.address = ((byte0 & 0b00111111) << 8) | (dccMessage.data[1]);
     instructionByte = dccMessage.data[2];
     dccData = dccMessage.data[3];   // Initial data value. Can be changed later
   }
   else {
-    locoCmd.longAddress = false;    // It is a basic packet, with a 7 bit address (1..127 (or 99))
-    locoCmd.address = (byte0 & 0b01111111);
     instructionByte = dccMessage.data[1];
     dccData = dccMessage.data[2];   // Initial data value. Can be changed later
   }
 
-  // Step 2: if we have a Loco Speed command, determine Speed and Direction
+  // Step 2: Packets for other decoders
+  // These are the majority, and are filtered without decoding the address or other fields.
+  // Speed commands are still checked, since safety decoders may want to know if there is still some
+  // train running or not. If the speed > 0, we return with the SomeLocoMovesFlag. Otherwise with the
+  // SomeLocoSpeedFlag, which can be used to detect the end of a RESET (Halt) period.
+  // Speed codes 0..3 (14/28 steps) and 0..1 (128 steps) represent (emergency) stop; see step 3.
+  if (!mine) {
+    if ((instructionByte & 0b11000000) == 0b01000000)
+      return (instructionByte & 0b00001110) ? Dcc::SomeLocoMovesFlag : Dcc::SomeLocoSpeedFlag;
+    if (instructionByte == 0b00111111)
+      return ((dccData & 0b01111111) > 1) ? Dcc::SomeLocoMovesFlag : Dcc::SomeLocoSpeedFlag;
+    return (Dcc::IgnoreCmd);
+  }
+  if (byte0 & 0b10000000) {
+    locoCmd.longAddress = true;     // It is an extended packet, with a 14 bit address (0..10239)
+    locoCmd.address = ((byte0 & 0b00111111) << 8) | (dccMessage.data[1]);
+  }
+  else {
+    locoCmd.longAddress = false;    // It is a basic packet, with a 7 bit address (1..127 (or 99))
+    locoCmd.address = byte0;
+  }
+
+  // Step 3: if we have a Loco Speed command, determine Speed and Direction
   // Since loco speed commands are the most common of all commands, they will be handled first.
-  // Note that we check if this a speed command before we check if the packet is for this decoder,
-  // since safety decoders may want to know if there is still some train running or not.
   // In case of a retransmission (speed and/or direction have not changed) the command will be ignored.
   uint8_t speed;                    // For 14/28 as well as 128 speed steps
   bool forward = false;
   bool emergencyStop = false;
   bool speedCommand = false;
   //
-  // Step 2A: 14/28 Speed steps (See S 9.2 for details on how speed is coded)
+  // Step 3A: 14/28 Speed steps (See S 9.2 for details on how speed is coded)
   // Format: 01RG-GGGG - 14/28 speed steps
   if ((instructionByte & 0b11000000) == 0b01000000) { 
     speedCommand = true;
@@ -143,7 +177,7 @@ Dcc::CmdType_t LocoMessage::analyse(void) {
       }
     else speed = speed - 3;                            // Step 1 is coded as 4
   }
-  // Step 2B: 128 Speed steps
+  // Step 3B: 128 Speed steps
   // Format: 0011-1111 RGGG-GGGG - 128 Speed steps
   else if (instructionByte == 0b00111111) {
     speedCommand = true;
@@ -154,43 +188,29 @@ Dcc::CmdType_t LocoMessage::analyse(void) {
       }
     else speed = speed - 1;                            // Step 1 is coded as 2
   }
-  // Step 2C: If this is a speed command, it can still be a retransmission or emergency stop
+  // Step 3C: If this is a speed command, it can still be a retransmission or emergency stop
   // Note that, in case we listen to multiple addresses, retransmission detection doesn't
   // really work, if the speed for one address differs from the other. 
-  if (speedCommand) {
-    if (IsMyAddress()) {                               // Three options now: LocoSpeed, EmergencyStop or Retransmission 
-      if ((locoCmd.emergencyStop == emergencyStop) &&  // Retransmission?
-         (locoCmd.speed == speed) && 
-         (locoCmd.forward == forward)) {
-        return(Dcc::IgnoreCmd);                        // It is a retransmission => ignore
-      }
-      if (emergencyStop) {                             // Emergency stop?
-        locoCmd.speed = 0;      
-        locoCmd.emergencyStop = true;
-        return(Dcc::MyEmergencyStopCmd);
-      }
-      locoCmd.speed = speed;                           // This is a speed and direction command
-      locoCmd.emergencyStop = false;
-      locoCmd.forward = forward;
-      return(Dcc::MyLocoSpeedCmd);                     // Ready, so return
+  if (speedCommand) {                                  // Three options now: LocoSpeed, EmergencyStop or Retransmission
+    if ((locoCmd.emergencyStop == emergencyStop) &&    // Retransmission?
+       (locoCmd.speed == speed) &&
+       (locoCmd.forward == forward)) {
+      return(Dcc::IgnoreCmd);                          // It is a retransmission => ignore
     }
-    else {
-      // The loco speed command is not for this decoder, but we still check if the speed > 0.
-      // The reason is that safety decoders may need to know if there are still trains moving.
-      // If the speed > 0, we return with the SomeLocoMovesFlag. Otherwise with the
-      // SomeLocoSpeedFlag, which can be used to detect the end of a RESET (Halt) period.
-      if (speed > 0) return(Dcc::SomeLocoMovesFlag);
-      return(Dcc::SomeLocoSpeedFlag);
+    if (emergencyStop) {                               // Emergency stop?
+      locoCmd.speed = 0;
+      locoCmd.emergencyStop = true;
+      return(Dcc::MyEmergencyStopCmd);
     }
+    locoCmd.speed = speed;                             // This is a speed and direction command
+    locoCmd.emergencyStop = false;
+    locoCmd.forward = forward;
+    return(Dcc::MyLocoSpeedCmd);                       // Ready, so return
   }
-  
-  // Step 3: Ignore all remaining loco commands, unless they are intended for this decoder
-  // Note that SPEED commands allready returned
-  if (IsMyAddress() == false) return (Dcc::IgnoreCmd);
 
   // **************************************************************************************
-  // From now on the fast majority of loco messages have been filtered, since the remaining
-  // messages are all addressed to this loco. We'll further focus on commands that are
+  // From now on the remaining messages are all addressed to this loco, since the fast
+  // majority of loco messages has been filtered in step 2. We'll further focus on commands that are
   // available in Lenz (LZV100) environments with XPressNet V3.6, since these can be tested.
 
   // Step 4: Check for Configuration Variable Access Instruction
@@ -4,6 +4,8 @@
 // purpose:   Loco decoder functions to support the DCC library
 // author:    Aiko Pras
 // version:   2021-05-15 V1.0.2 ap initial version
+//            2026-10-18 V1.0.3 ap Address matching on the raw packet bytes
+//            2026-10-18 V1.0.4 ap matches() may also be used by the ISR (RAILCOM)
 //
 // This source file is subject of the GNU general public license 3,
 // that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
@@ -17,12 +19,26 @@ class LocoMessage {
     LocoMessage();                      // The constructor, which calls reset_speed()
     void reset_speed(void);             // Reset speed to 0, direction to forward and functions to off
     Dcc::CmdType_t analyse(void);       // The standard method to analyse Loco Commands
-  
+    void setMyAddress(unsigned int first, unsigned int last); // Called by Loco::setMyAddress()
+
+    // Is a loco packet, with these first two bytes, for this decoder? Short enough for an ISR
+    inline bool matches(uint8_t byte0, uint8_t byte1) {
+      if (byte0 & 0b10000000) {
+        uint16_t raw = (byte0 << 8) | byte1;
+        return ((raw >= longFirst) && (raw <= longLast));
+      }
+      return (shortMap[byte0 >> 3] & (1 << (byte0 & 0x07)));
+    }
+
     // Address range. Initialised by Loco::setMyAddress(... first, ... last = 65535);
     unsigned int myLocoAddressFirst;    // First loco address this decoder listens to
     unsigned int myLocoAddressLast;     // Last loco address. Usually same as first loco address
 
   private:
     void DetermineSpeedAndDirection();
-    bool IsMyAddress();
+
+    // The address range, precomputed as raw packet bytes
+    uint8_t shortMap[16];               // One bit per 7-bit address (1..127)
+    uint16_t longFirst;                 // Bytes 0 and 1 of the first 14-bit address (0xC000..0xE7FF)
+    uint16_t longLast;                  // Bytes 0 and 1 of the last 14-bit address
 };
@@ -0,0 +1,414 @@
+//******************************************************************************************************
+//
+// file:      sup_loconet.cpp
+// purpose:   LocoNet receiver, that translates LocoNet messages into DCC packets
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+// A command station does not put a command on the track immediately: it first has to finish the
+// current packet, and it schedules new commands between the refresh packets for all locos. Decoders
+// near the command station can get the same commands much earlier from the LocoNet bus. If LOCONET is
+// defined, dcc.input() takes the LocoNet messages that also lead to a DCC packet, translates them into
+// that DCC packet, and analyses it like a packet from the track. The main sketch therefore gets the
+// same dcc.cmdType and attributes (accCmd, locoCmd), whatever input was first. When the command
+// station puts the same command on the track later, it is filtered as retransmission, since the
+// library compares each command with the previous ones anyway (see sup_acc.cpp and sup_loco.cpp).
+//
+// Translated are:
+// - OPC_SW_REQ (switch request): a basic accessory command. The switch address is mapped as RCN-213
+//   prescribes (switch 1 = decoder address bits 1, port 0), which is also what Digitrax command
+//   stations put on the track. Thus accCmd.myMaster applies as for track packets.
+// - OPC_LOCO_SPD, OPC_LOCO_DIRF and OPC_LOCO_SND: speed (128 steps), F0-F4 and F5-F8 commands.
+//   These messages carry a slot number instead of the loco address. The slot table is filled from
+//   OPC_SL_RD_DATA and OPC_WR_SL_DATA, which throttles request (or write) when they select a loco.
+//   Messages for slots that are not in the table are ignored. Speed and direction are part of the
+//   same DCC packet, but of different LocoNet messages, so the table also keeps both. If a
+//   OPC_LOCO_DIRF message changes the direction as well as functions, it results in two packets.
+//   Since speeds are translated to 128 steps, retransmissions on the track are only recognised if the
+//   command station uses 128 steps for the loco as well.
+// All other messages are checked, but not translated. The library never transmits on LocoNet.
+//
+// A track packet that was already under way when the LocoNet message arrived, still carries the
+// previous state: the previous speed of the loco, or the previous position of the turnout. Without
+// further measures, the sketch would get the old command again, followed by the new one once the
+// command station puts that on the track. Therefore, during LocoNetHoldOff ms after a translated
+// packet, a track packet for the same loco and instruction (speed, F0-F4, F5-F8), or for the same
+// turnout, that differs from the translated packet is ignored (stale()). The last LocoNetRecent
+// translated packets are compared, since a OPC_LOCO_DIRF message may result in two packets.
+// All other track packets for locos in the slot table update the speed, direction and F0-F4 in the
+// table. Thus, if a LocoNet message got lost, the next translated packet still has the right state.
+//
+// LocoNet is a 16667 baud, 8N1 bus. Each message starts with an opcode (bit 7 set), followed by data
+// bytes (bit 7 cleared). The opcode tells the length (2, 4 or 6 bytes), or that the next byte does.
+// The last byte is a checksum: the XOR of all bytes is 0xFF. The USART receive ISR checks the
+// framing, collects the bytes in a small queue and verifies the checksum. Collisions (detected by
+// the senders as a break) and noise are received as framing errors; the message is then dropped.
+// Such errors, checksum errors and messages that are interrupted by a new opcode, are counted.
+// dcc.input() translates at most one message per call, and only if no track packet is waiting.
+//
+// Used hardware resources:
+//  - USART1 on MegaCoreX or DxCore (or USART0 / USART2 / USART3, see below), RXD on the default
+//    (PORTMUX) pin Px1. Only the receiver is used. The USART should differ from the one used for
+//    RailCom (default USART2). The LocoNet line needs a level converter, such as the usual
+//    comparator (LM311) circuit, which delivers a non-inverted TTL signal.
+//
+//******************************************************************************************************
+#include <Arduino.h>
+#include "AP_DCC_library.h"
+#if defined(LOCONET)
+#include "sup_isr.h"
+#include "sup_timer.h"
+#include "sup_loconet.h"
+
+extern LocoNetMessage loconetMessage;     // Instantiated in AP_DCC_library.cpp
+extern DccMessage dccMessage;
+
+
+//******************************************************************************************************
+// Defines that may need to be modified to accomodate certain hardware
+//******************************************************************************************************
+// USART to use. The default is USART1. This can be overruled by setting one of the following defines:
+// #define LOCONET_USES_USART0
+// #define LOCONET_USES_USART2
+// #define LOCONET_USES_USART3
+#if defined(LOCONET_USES_USART0)
+  #define loconet_USART    USART0
+  #define loconet_RXC_vect USART0_RXC_vect
+#elif defined(LOCONET_USES_USART2)
+  #define loconet_USART    USART2
+  #define loconet_RXC_vect USART2_RXC_vect
+#elif defined(LOCONET_USES_USART3)
+  #define loconet_USART    USART3
+  #define loconet_RXC_vect USART3_RXC_vect
+#else
+  #define loconet_USART    USART1
+  #define loconet_RXC_vect USART1_RXC_vect
+#endif
+
+#define LOCONET_BAUD       16667L
+
+// Opcodes that are translated
+#define OPC_LOCO_SPD       0xA0
+#define OPC_LOCO_DIRF      0xA1
+#define OPC_LOCO_SND       0xA2
+#define OPC_SW_REQ         0xB0
+#define OPC_SL_RD_DATA     0xE7
+#define OPC_WR_SL_DATA     0xEF
+
+
+//******************************************************************************************************
+// The USART receive ISR
+//******************************************************************************************************
+#if !defined(AP_DCC_HOST)
+ISR(loconet_RXC_vect) {
+  uint8_t status = loconet_USART.RXDATAH;             // Read before RXDATAL
+  uint8_t value = loconet_USART.RXDATAL;
+  loconetMessage.receive(value, status & (USART_FERR_bm | USART_BUFOVF_bm));
+}
+#endif
+
+
+void LocoNetMessage::receive(uint8_t value, bool framingError) {
+  if (framingError) {                                 // Collision or noise
+    if (count) errors++;
+    count = 0;
+    return;
+  }
+  if (value & 0x80) {                                 // An opcode starts the next message
+    if (count) errors++;                              // The previous message was not complete
+    count = 1;
+    check = value;
+    length = ((value & 0x60) == 0x60) ? 0 : ((value & 0x60) >> 4) + 2;
+    store = (queued < LocoNetQueue) &&
+            ((value == OPC_SW_REQ) || ((value >= OPC_LOCO_SPD) && (value <= OPC_LOCO_SND)) ||
+             (value == OPC_SL_RD_DATA) || (value == OPC_WR_SL_DATA));
+    if (store) queue[head][0] = value;
+    return;
+  }
+  if (count == 0) return;                             // Not synchronised
+  if ((count == 1) && (length == 0)) {                // Variable length
+    length = value;
+    if (length < 3) {
+      errors++;
+      count = 0;
+      return;
+    }
+    if (length > LocoNetMaxSize) store = false;
+  }
+  if (store) queue[head][count] = value;
+  check ^= value;
+  if (++count < length) return;
+  count = 0;
+  if (check != 0xFF) {
+    errors++;
+    return;
+  }
+  messages++;
+  if (store) {
+    head = (head + 1 == LocoNetQueue) ? 0 : head + 1;
+    queued++;
+  }
+}
+
+
+//******************************************************************************************************
+// attach() / detach()
+//******************************************************************************************************
+LocoNetMessage::LocoNetMessage() {
+  messages = 0;
+  errors = 0;
+  count = 0;
+  head = 0;
+  tail = 0;
+  queued = 0;
+  packetSize = 0;
+  for (uint8_t i = 0; i < LocoNetRecent; i++) recent[i].size = 0;
+  recentNext = 0;
+  for (uint8_t i = 0; i < LocoNetSlots; i++) slots[i].slot = NoLocoNetSlot;
+  nextSlot = 0;
+  pendingFunctions = NoLocoNetSlot;
+}
+
+
+void LocoNetMessage::attach(void) {
+  noInterrupts();
+  count = 0;
+  #if !defined(AP_DCC_HOST)
+  loconet_USART.BAUD = (uint16_t)((4UL * F_CPU) / LOCONET_BAUD);
+  loconet_USART.CTRLC = USART_CMODE_ASYNCHRONOUS_gc | USART_PMODE_DISABLED_gc | USART_SBMODE_1BIT_gc |
+                        USART_CHSIZE_8BIT_gc;
+  loconet_USART.CTRLB = USART_RXEN_bm;
+  loconet_USART.CTRLA = USART_RXCIE_bm;
+  #endif
+  interrupts();
+}
+
+
+void LocoNetMessage::detach(void) {
+  #if !defined(AP_DCC_HOST)
+  noInterrupts();
+  loconet_USART.CTRLA = 0;
+  loconet_USART.CTRLB = 0;
+  interrupts();
+  #endif
+}
+
+
+//******************************************************************************************************
+// translate(): called by dcc.input() if no track packet is waiting
+//******************************************************************************************************
+bool LocoNetMessage::translate(void) {
+  // A packet that couldn't be delivered before (the ISR was just faster) is delivered first
+  if (!packetSize && !build()) return false;
+  noInterrupts();
+  if (dccMessage.isReady) {
+    interrupts();
+    return false;
+  }
+  for (uint8_t i = 0; i < packetSize; i++) dccMessage.data[i] = packet[i];
+  dccMessage.size = packetSize;
+  dccMessage.isReady = 1;
+  interrupts();
+  for (uint8_t i = 0; i < packetSize; i++) recent[recentNext].data[i] = packet[i];
+  recent[recentNext].size = packetSize;
+  recent[recentNext].time = dccMillis();
+  recentNext = (recentNext + 1 == LocoNetRecent) ? 0 : recentNext + 1;
+  packetSize = 0;
+  return true;
+}
+
+
+bool LocoNetMessage::stale(void) {
+  // Called by dcc.input() for track packets with a correct XOR
+  for (uint8_t r = 0; r < LocoNetRecent; r++) {
+    if (!recent[r].size) continue;
+    if (dccMillis() - recent[r].time > LocoNetHoldOff) recent[r].size = 0;
+      else if (overtaken(r)) return true;
+  }
+  follow();
+  return false;
+}
+
+
+bool LocoNetMessage::overtaken(uint8_t r) {
+  const uint8_t *data = recent[r].data;
+  uint8_t size = recent[r].size;
+  if (dccMessage.size != size) return false;
+  if ((data[0] & 0b11000000) == 0b10000000) {         // Accessory: same decoder and turnout?
+    if ((dccMessage.data[0] != data[0]) || ((dccMessage.data[1] ^ data[1]) & 0b11110110)) return false;
+    return (dccMessage.data[1] != data[1]);            // Other position or activation
+  }
+  // Loco: same address and kind of instruction (128 steps speed, F0-F4 or F5-F8)?
+  uint8_t n = 1 + (data[0] >> 7);                      // Instruction byte
+  for (uint8_t i = 0; i < n; i++) if (dccMessage.data[i] != data[i]) return false;
+  uint8_t mask = 0b11110000;                           // F5-F8
+  if (data[n] == 0b00111111) mask = 0b11111111;        // Speed
+  if ((data[n] & 0b11100000) == 0b10000000) mask = 0b11100000;  // F0-F4
+  if ((dccMessage.data[n] ^ data[n]) & mask) return false;
+  for (uint8_t i = n; i < size - 1; i++) if (dccMessage.data[i] != data[i]) return true;
+  return false;
+}
+
+
+void LocoNetMessage::follow(void) {
+  uint8_t byte0 = dccMessage.data[0];
+  if ((byte0 == 0) || ((byte0 >= 0b10000000) && (byte0 < 0b11000000)) || (byte0 > 0b11100111)) return;
+  uint8_t n = 1 + (byte0 >> 7);                        // Instruction byte
+  if (dccMessage.size < n + 2) return;
+  for (uint8_t entry = 0; entry < LocoNetSlots; entry++) {
+    if (slots[entry].slot == NoLocoNetSlot) continue;
+    if (slots[entry].adr2 == 0) {
+      if (byte0 != slots[entry].adr) continue;
+    }
+    else {
+      uint16_t address = (slots[entry].adr2 << 7) | slots[entry].adr;
+      if ((byte0 != (0b11000000 | (address >> 8))) || (dccMessage.data[1] != (address & 0xFF))) continue;
+    }
+    uint8_t instruction = dccMessage.data[n];
+    if ((instruction == 0b00111111) && (dccMessage.size == n + 3)) {
+      slots[entry].spd = dccMessage.data[n + 1] & 0b01111111;
+      slots[entry].dirf = (slots[entry].dirf & 0b00011111) | ((dccMessage.data[n + 1] & 0b10000000) ? 0 : 0b00100000);
+    }
+    else if ((instruction & 0b11100000) == 0b10000000) {
+      slots[entry].dirf = (slots[entry].dirf & 0b00100000) | (instruction & 0b00011111);
+    }
+    return;
+  }
+}
+
+
+bool LocoNetMessage::build(void) {
+  if (pendingFunctions != NoLocoNetSlot) {            // Second packet of an OPC_LOCO_DIRF message
+    functionPacket(pendingFunctions, 0b10000000 | (slots[pendingFunctions].dirf & 0b00011111));
+    pendingFunctions = NoLocoNetSlot;
+    return true;
+  }
+  while (queued) {
+    const uint8_t *message = queue[tail];
+    uint8_t entry = LocoNetSlots;
+    if ((message[0] >= OPC_LOCO_SPD) && (message[0] <= OPC_LOCO_SND)) entry = findSlot(message[1]);
+    switch (message[0]) {
+      case OPC_SW_REQ:
+        switchPacket(message);
+        break;
+      case OPC_LOCO_SPD:
+        if (entry == LocoNetSlots) break;
+        slots[entry].spd = message[2];
+        speedPacket(entry);
+        break;
+      case OPC_LOCO_DIRF:
+        if (entry == LocoNetSlots) break;
+        if ((slots[entry].dirf ^ message[2]) & 0b00100000) {
+          if ((slots[entry].dirf ^ message[2]) & 0b00011111) pendingFunctions = entry;
+          slots[entry].dirf = message[2];
+          speedPacket(entry);
+        }
+        else {
+          slots[entry].dirf = message[2];
+          functionPacket(entry, 0b10000000 | (message[2] & 0b00011111));  // 100D-DDDD: F0, F4-F1
+        }
+        break;
+      case OPC_LOCO_SND:
+        if (entry != LocoNetSlots) functionPacket(entry, 0b10110000 | (message[2] & 0b00001111));
+        break;
+      default:                                        // OPC_SL_RD_DATA / OPC_WR_SL_DATA
+        slotData(message);
+    }
+    tail = (tail + 1 == LocoNetQueue) ? 0 : tail + 1;
+    noInterrupts();
+    queued--;
+    interrupts();
+    if (packetSize) return true;
+  }
+  return false;
+}
+
+
+//******************************************************************************************************
+// The DCC packets
+//******************************************************************************************************
+void LocoNetMessage::switchPacket(const uint8_t *message) {
+  // <B0><SW1><SW2><CHK>. SW1: A6-A0, SW2: 0 0 DIR ON A10-A7. DIR: 1 = closed (straight)
+  // The 11 bit switch number (0..2047) is mapped on decoder address bits (1..511, 0) and port
+  uint16_t number = ((message[2] & 0b00001111) << 7) | message[1];
+  uint16_t raw = ((number >> 2) + 1) & 0x01FF;
+  packet[0] = 0b10000000 | (raw & 0b00111111);
+  packet[1] = 0b10000000 | ((~raw >> 2) & 0b01110000) | ((message[2] & 0b00010000) >> 1) |
+              ((number & 0b00000011) << 1) | ((message[2] & 0b00100000) >> 5);
+  addXor(2);
+}
+
+
+void LocoNetMessage::speedPacket(uint8_t entry) {
+  // 128 speed steps: 0011-1111 RGGG-GGGG. LocoNet speed codes are the same (0: stop, 1: emergency)
+  uint8_t n = locoAddress(entry);
+  packet[n] = 0b00111111;
+  packet[n + 1] = ((slots[entry].dirf & 0b00100000) ? 0 : 0b10000000) | (slots[entry].spd & 0b01111111);
+  addXor(n + 2);
+}
+
+
+void LocoNetMessage::functionPacket(uint8_t entry, uint8_t instruction) {
+  uint8_t n = locoAddress(entry);
+  packet[n] = instruction;
+  addXor(n + 1);
+}
+
+
+uint8_t LocoNetMessage::locoAddress(uint8_t entry) {
+  if (slots[entry].adr2 == 0) {
+    packet[0] = slots[entry].adr;
+    return 1;
+  }
+  uint16_t address = (slots[entry].adr2 << 7) | slots[entry].adr;
+  packet[0] = 0b11000000 | (address >> 8);
+  packet[1] = address & 0xFF;
+  return 2;
+}
+
+
+void LocoNetMessage::addXor(uint8_t size) {
+  uint8_t x = 0;
+  for (uint8_t i = 0; i < size; i++) x ^= packet[i];
+  packet[size] = x;
+  packetSize = size + 1;
+}
+
+
+//******************************************************************************************************
+// The slot table
+//******************************************************************************************************
+void LocoNetMessage::slotData(const uint8_t *message) {
+  // <E7/EF><0E><SLOT><STAT><ADR><SPD><DIRF><TRK><SS2><ADR2><SND><ID1><ID2><CHK>
+  uint8_t slot = message[2];
+  if ((slot == 0) || (slot > 119)) return;            // Dispatch, fast clock, programming, ...
+  uint8_t entry = findSlot(slot);
+  if (((message[3] & 0b00110000) == 0) || ((message[4] == 0) && (message[9] == 0))) {
+    if (entry != LocoNetSlots) slots[entry].slot = NoLocoNetSlot;  // Free, or an analog loco
+    return;
+  }
+  if (entry == LocoNetSlots) {
+    entry = findSlot(NoLocoNetSlot);
+    if (entry == LocoNetSlots) {                      // Table full: entries are replaced in turn
+      entry = nextSlot;
+      nextSlot = (nextSlot + 1 == LocoNetSlots) ? 0 : nextSlot + 1;
+    }
+  }
+  if (pendingFunctions == entry) pendingFunctions = NoLocoNetSlot;
+  slots[entry].slot = slot;
+  slots[entry].adr = message[4];
+  slots[entry].adr2 = message[9];
+  slots[entry].spd = message[5];
+  slots[entry].dirf = message[6];
+}
+
+
+uint8_t LocoNetMessage::findSlot(uint8_t slot) {
+  uint8_t i = 0;
+  while ((i < LocoNetSlots) && (slots[i].slot != slot)) i++;
+  return i;
+}
+#endif
@@ -0,0 +1,85 @@
+//******************************************************************************************************
+//
+// file:      sup_loconet.h
+// purpose:   LocoNet receiver, that translates LocoNet messages into DCC packets
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#pragma once
+
+#if defined(LOCONET)
+#if (!defined(MEGACOREX) && !defined(_AVR_FAMILY) && !defined(AP_DCC_HOST)) || defined(ARDUINO_AVR_NANO_EVERY)
+#error "The LocoNet receiver requires a MegaCoreX or DxCore processor"
+#endif
+
+#define LocoNetMaxSize     14                       // Longest message that is translated (slot data)
+#define LocoNetQueue       4                        // Messages the ISR may buffer for dcc.input()
+#define NoLocoNetSlot      0xFF                     // Slot table: entry not in use
+#define LocoNetHoldOff     20                       // ms: track packets with an older state are ignored
+#define LocoNetRecent      2                        // Translated packets compared with track packets
+
+
+class LocoNetMessage {
+  public:
+    LocoNetMessage();
+    void attach(void);                              // Hardware: USART receiver
+    void detach(void);
+    bool translate(void);                           // Next message as DCC packet in dccMessage
+    bool stale(void);                               // The track packet in dccMessage was overtaken
+
+    // Called by the USART ISR (on a host: by the simulation) for each byte
+    void receive(uint8_t value, bool framingError);
+
+    volatile uint16_t messages;                     // Messages with a correct checksum
+    volatile uint16_t errors;                       // Framing, checksum and incomplete messages
+
+  private:
+    void slotData(const uint8_t *message);          // Slot read or write: update the slot table
+    uint8_t findSlot(uint8_t slot);                 // Entry in the slot table, or LocoNetSlots
+    bool build(void);                               // Next message as DCC packet in packet
+    void switchPacket(const uint8_t *message);
+    void speedPacket(uint8_t entry);
+    void functionPacket(uint8_t entry, uint8_t instruction);
+    uint8_t locoAddress(uint8_t entry);             // Returns the number of address bytes
+    void addXor(uint8_t size);
+
+    uint8_t packet[MaxDccSize];                     // Translated, but not yet in dccMessage
+    uint8_t packetSize;                             // 0: none
+    bool overtaken(uint8_t r);                      // Track packet is older than recent packet r
+    void follow(void);                              // Update the slot table from a track packet
+
+    struct {
+      uint8_t data[MaxDccSize];                     // Packet delivered to dccMessage
+      uint8_t size;                                 // 0: none, or older than LocoNetHoldOff
+      unsigned long time;                           // dccMillis() at delivery
+    } recent[LocoNetRecent];
+    uint8_t recentNext;
+
+    // Filled by the ISR. Messages are received directly in the queue entry at head
+    uint8_t count;                                  // Bytes received; 0: waiting for an opcode
+    uint8_t length;                                 // Expected length; 0: the next byte tells
+    uint8_t check;                                  // XOR of all bytes, 0xFF if correct
+    bool store;                                     // The message is translated, and fits the queue
+    uint8_t queue[LocoNetQueue][LocoNetMaxSize];
+    uint8_t head;                                   // Next entry the ISR writes
+    uint8_t tail;                                   // Next entry translate() reads
+    volatile uint8_t queued;                        // Messages in the queue
+
+    // The loco in each slot. Speed and direction are kept, since LocoNet sends them separately
+    struct {
+      uint8_t slot;                                 // LocoNet slot (1..119), or NoLocoNetSlot
+      uint8_t adr;                                  // Address, low 7 bits
+      uint8_t adr2;                                 // Address, high 7 bits. 0: short (7 bit) address
+      uint8_t spd;                                  // LocoNet speed, equal to the DCC 128 steps code
+      uint8_t dirf;                                 // Direction (bit 5: reverse), F0 and F1-F4
+    } slots[LocoNetSlots];
+    uint8_t nextSlot;                               // Entry that is replaced next, if all are in use
+    uint8_t pendingFunctions;                       // Entry whose F0-F4 packet still has to follow
+};
+
+extern LocoNetMessage loconetMessage;               // instantiated in, and used by, DCC_Library.cpp
+#endif
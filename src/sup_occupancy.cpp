@@ -0,0 +1,203 @@
+//******************************************************************************************************
+//
+// file:      sup_occupancy.cpp
+// purpose:   Block occupancy detection (voltage detection) to support the DCC library
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//            2026-10-18 V1.0.1 ap Timeouts read the time base (TIME_BASE)
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+// Occupancy detectors measure the voltage over a (sense) resistor or diodes in the feeder of each
+// track block. If a wheelset with a resistor (for example 1 kOhm) or a loco is on the block, current
+// flows, and a voltage can be measured. Since the DCC signal is AC, a meaningful voltage can only be
+// measured during one polarity of the signal. The DCC ISR knows the polarity (and phase) of the DCC
+// signal, and therefore starts each AD conversion (via adcStart.newRequest, see sup_isr.h):
+// - MegaCoreX / DxCore: directly after a rising edge of the DCC input (thus at the start of the high
+//   half bit, which lasts at least 52us). The ISR checks the TCB edge bit, so this costs a few clock
+//   cycles per interrupt only.
+// - Traditional ATmega and Nano Every: 77us after a rising edge, if the input is still high (0 bit).
+//
+// The blocks are scanned round robin: one conversion per trigger. The ADC ISR stores the result,
+// selects the ADC channel of the next block, and enables the next trigger. Thus the conversion of
+// one block takes place while the DCC signal is high, and the channel switch (settling) takes place
+// while the signal is low. Per result the ADC ISR takes roughly 3us, so with roughly one trigger per
+// DCC bit the CPU load stays below 2%.
+//
+// Per block a first order (exponential) filter is used, in fixed point: filtered = level x 2^shift.
+// A block becomes occupied if the filtered level rises above onLevel, and becomes free again once it
+// drops below offLevel (hysteresis). Since most command stations send 6000..8000 bits per second,
+// with 16 blocks each block is sampled every 2..3ms. With the default filterShift (1) a 1 kOhm
+// wheelset, which gives a level well above onLevel, is therefore detected within 10ms.
+// Before a free block is reported, it must be free for releaseDelay ms (to bridge dirty wheels).
+//
+// State changes are reported by dcc.input(), similar to received DCC commands: cmdType is OccupancyCmd
+// and occupancyCmd.block and occupancyCmd.occupied tell which block has changed.
+//
+// Used hardware resources:
+//  - ADC (ADC0 on MegaCoreX / DxCore / Nano Every). Therefore analogRead() can not be used by the sketch
+//  - On traditional ATmega processors only channels 0..7 can be used
+//
+//******************************************************************************************************
+#include <Arduino.h>
+#include "AP_DCC_library.h"
+#if defined(VOLTAGE_DETECTION)
+#include "sup_isr.h"
+#include "sup_occupancy.h"
+#include "sup_timer.h"
+
+extern AdcStart adcStart;                 // Instantiated in the processor specific sup_isr_XXX.h file
+extern OccupancyMessage occupancyMessage; // Instantiated in AP_DCC_library.cpp
+extern Occupancy occupancyCmd;            // Interface to the main sketch
+
+
+//******************************************************************************************************
+//                                 Processor specific ADC code
+//******************************************************************************************************
+#if defined(ADC0)
+// MegaCoreX, DxCore and Nano Every
+static void adcInit(uint8_t channel) {
+  ADC0.CTRLA = 0;
+  #if defined(ADC_REFSEL_VDDREF_gc)                   // megaAVR 0 (ATmega 4808, 4809)
+    ADC0.CTRLC = ADC_PRESC_DIV16_gc | ADC_REFSEL_VDDREF_gc | ADC_SAMPCAP_bm;
+  #else                                               // AVR DA, DB, DD
+    VREF.ADC0REF = VREF_REFSEL_VDD_gc;
+    ADC0.CTRLC = ADC_PRESC_DIV16_gc;
+  #endif
+  ADC0.SAMPCTRL = 2;                                  // Sampling takes 4 ADC clocks
+  ADC0.MUXPOS = channel;
+  ADC0.INTFLAGS = ADC_RESRDY_bm;
+  ADC0.INTCTRL = ADC_RESRDY_bm;
+  ADC0.CTRLA = ADC_ENABLE_bm | ADC_RESSEL_10BIT_gc;
+}
+
+static void adcStop(void) {
+  ADC0.INTCTRL = 0;
+  ADC0.CTRLA = 0;
+}
+
+ISR(ADC0_RESRDY_vect) {
+  uint16_t value = ADC0.RES;                          // Reading RES clears the interrupt flag
+  ADC0.MUXPOS = occupancyMessage.newSample(value);
+  adcStart.newRequest = 1;
+}
+
+#elif defined(ADCSRA)
+// Traditional ATmega processors. The ADC clock is F_CPU / 64 (250 kHz at 16Mhz), which is slightly
+// above the advised maximum, but ensures the input is sampled before the DCC 0 bit ends.
+static void adcInit(uint8_t channel) {
+  ADMUX = (1 << REFS0) | (channel & 0x07);            // AVCC as reference
+  ADCSRA = (1 << ADEN) | (1 << ADIE) | (1 << ADPS2) | (1 << ADPS1);
+}
+
+static void adcStop(void) {
+  ADCSRA = 0;
+}
+
+ISR(ADC_vect) {
+  uint16_t value = ADC;
+  ADMUX = (ADMUX & 0xF0) | (occupancyMessage.newSample(value) & 0x07);
+  adcStart.newRequest = 1;
+}
+
+#else
+#error "Voltage detection is not supported for this processor"
+#endif
+
+
+//******************************************************************************************************
+//                                   The OccupancyMessage class
+//******************************************************************************************************
+OccupancyMessage::OccupancyMessage() {
+  onLevel = 40;
+  offLevel = 20;
+  filterShift = 1;
+  releaseDelay = 0;
+}
+
+
+void OccupancyMessage::attach(const uint8_t *channels, uint8_t numberOfBlocks) {
+  if (numberOfBlocks > MaxBlocks) numberOfBlocks = MaxBlocks;
+  if (numberOfBlocks == 0) return;
+  noInterrupts();
+  adcStart.newRequest = 0;
+  _blocks = numberOfBlocks;
+  for (uint8_t i = 0; i < _blocks; i++) {
+    _channel[i] = channels[i];
+    filtered[i] = 0;
+  }
+  _current = 0;
+  _mask = 1;
+  _occupied = 0;
+  _pending = 0;
+  reported = 0;
+  adcInit(_channel[0]);
+  adcStart.newRequest = 1;                            // The DCC ISR may start the first conversion
+  interrupts();
+}
+
+
+void OccupancyMessage::detach(void) {
+  noInterrupts();
+  adcStart.newRequest = 0;
+  adcStop();
+  interrupts();
+}
+
+
+uint8_t OccupancyMessage::newSample(uint16_t value) {
+  // Called from the ADC ISR. Keep it short: no divisions. The two shifts by filterShift (0..6) are
+  // variable shifts, which avr-gcc compiles as a loop of at most 6 single bit shifts
+  uint8_t i = _current;
+  uint16_t f = filtered[i] + value - (filtered[i] >> filterShift);
+  filtered[i] = f;
+  f = f >> filterShift;
+  if (f >= onLevel) _occupied |= _mask;
+    else if (f < offLevel) _occupied &= ~_mask;
+  // Move to the next block
+  i++;
+  _mask = _mask << 1;
+  if (i >= _blocks) {
+    i = 0;
+    _mask = 1;
+  }
+  _current = i;
+  return _channel[i];
+}
+
+
+bool OccupancyMessage::analyse(void) {
+  // Called by dcc.input(). Reports at most one state change per call.
+  noInterrupts();
+  uint16_t occupied = _occupied;
+  interrupts();
+  uint16_t changed = occupied ^ reported;
+  _pending &= changed;                                // Blocks that became occupied again before
+  if (changed == 0) return false;                     // the release delay was over
+  unsigned int now = dccMillis();
+  uint16_t mask = 1;
+  for (uint8_t i = 0; i < _blocks; i++, mask = mask << 1) {
+    if (!(changed & mask)) continue;
+    if (occupied & mask) {
+      reported |= mask;
+      occupancyCmd.block = i;
+      occupancyCmd.occupied = true;
+      return true;
+    }
+    if (!(_pending & mask)) {                         // Block has just become free
+      _pending |= mask;
+      _freeSince[i] = now;
+    }
+    if ((unsigned int)(now - _freeSince[i]) >= releaseDelay) {
+      _pending &= ~mask;
+      reported &= ~mask;
+      occupancyCmd.block = i;
+      occupancyCmd.occupied = false;
+      return true;
+    }
+  }
+  return false;
+}
+
+#endif
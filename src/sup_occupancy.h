@@ -0,0 +1,43 @@
+//******************************************************************************************************
+//
+// file:      sup_occupancy.h
+// purpose:   Block occupancy detection (voltage detection) to support the DCC library
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#pragma once
+#define MaxBlocks 16                                // Number of blocks (ADC channels) that can be scanned
+
+
+class OccupancyMessage {
+  public:
+    OccupancyMessage();                             // The constructor, to initialise the parameters
+    void attach(const uint8_t *channels, uint8_t numberOfBlocks);
+    void detach(void);
+    bool analyse(void);                             // Returns true, if a block changed its state
+
+    // Called by the ADC ISR for each new result. Returns the ADC channel that should be sampled next
+    uint8_t newSample(uint16_t value);
+
+    // Parameters. Initialised by the methods of the Occupancy class
+    uint16_t onLevel;                               // Filtered level above which a block is occupied
+    uint16_t offLevel;                              // Filtered level below which a block is free
+    uint8_t filterShift;                            // Filter constant: alpha = 1 / 2^filterShift
+    uint16_t releaseDelay;                          // Time (ms) a block must be free before reporting
+
+    volatile uint16_t filtered[MaxBlocks];          // Filtered level x 2^filterShift
+    uint16_t reported;                              // Bit per block: last state reported to the sketch
+
+  private:
+    uint8_t _channel[MaxBlocks];                    // ADC (MUXPOS) channel for each block
+    uint8_t _blocks;                                // Number of blocks that are scanned
+    volatile uint8_t _current;                      // The block that is being converted
+    volatile uint16_t _mask;                        // The bit of that block
+    volatile uint16_t _occupied;                    // Bit per block: state after hysteresis (ISR)
+    uint16_t _pending;                              // Bit per block: free, but release delay not yet over
+    unsigned int _freeSince[MaxBlocks];             // millis() value the block became free
+};
@@ -0,0 +1,252 @@
+//******************************************************************************************************
+//
+// file:      sup_railcom.cpp
+// purpose:   RailCom (RCN-217) channel 2 feedback of dynamic variables (DYN)
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+// During the RailCom cutout after a packet, the command station stops powering the track, and
+// decoders may send a few bytes at 250 kbit/s by drawing current. Channel 1 (75..177us after the
+// end of the Packet End Bit) is shared by all decoders; channel 2 (193..454us) may only be used by
+// the decoder that was addressed by the packet. Each byte carries 6 bits, as one of the 64 codes
+// with four ones and four zeros (4/8 code). Channel 2 holds six bytes, thus 36 bits.
+//
+// If RAILCOM is defined, a loco decoder uses channel 2 to report dynamic variables (DYN, datagram
+// ID 7: 4 bits ID, 8 bits value, 6 bits subindex). Each reply holds two DYN datagrams; the variables
+// take turns (rotation), so every variable is reported regularly, whatever their number. By default:
+// - QoS (subindex 7): the percentage of packets with an XOR error. This is computed by dcc.input()
+//   from the packets of the library itself, in windows of 100 packets, so no division is needed.
+// - Further variables, such as the temperature (subindex 26) or the supply voltage, are provided by
+//   the main sketch via railcom.setDyn(); the library can't measure these itself.
+// Channel 1 (the address broadcast) is not sent, so command stations that need it to locate the
+// decoder will not show these variables. Accessory packets are not answered.
+//
+// To keep the load of the ISRs low, all encoding is done in advance by dcc.input(): a variable is
+// 4/8 encoded when its value changes, and the next reply is copied into channel2 as soon as the
+// previous one was sent. At the Packet End Bit the DCC ISR only checks the XOR and the loco address
+// (with the precomputed patterns of sup_loco.cpp), and starts a second TCB timer. Since the DCC TCB
+// restarts counting at each edge, its counter tells how long ago the Packet End Bit ended; the second
+// timer starts at that value, so ISR latency doesn't shift channel 2. When that timer fires, the
+// first byte is written to the USART; the Data Register Empty interrupt writes the others.
+//
+// Used hardware resources:
+//  - USART2 on MegaCoreX or DxCore (or USART0 / USART1 / USART3, see below), TXD on the default
+//    (PORTMUX) pin Px0. TXD is high while idle; a low level should switch on the RailCom current
+//    source. The USART transmits 8N1, LSB first, as required by RCN-217.
+//  - TCB1 (or TCB2 / TCB3, see below), which should differ from the TCB used for the DCC input.
+//
+//******************************************************************************************************
+#include <Arduino.h>
+#include "AP_DCC_library.h"
+#if defined(RAILCOM)
+#include "sup_loco.h"
+#include "sup_railcom.h"
+
+extern RailComMessage railcomMessage;     // Instantiated in AP_DCC_library.cpp
+
+
+//******************************************************************************************************
+// Defines that may need to be modified to accomodate certain hardware
+//******************************************************************************************************
+// USART to use. The default is USART2. This can be overruled by setting one of the following defines:
+// #define RAILCOM_USES_USART0
+// #define RAILCOM_USES_USART1
+// #define RAILCOM_USES_USART3
+#if defined(RAILCOM_USES_USART0)
+  #define railcom_USART    USART0
+  #define railcom_PORT     PORTA
+  #define railcom_DRE_vect USART0_DRE_vect
+#elif defined(RAILCOM_USES_USART1)
+  #define railcom_USART    USART1
+  #define railcom_PORT     PORTC
+  #define railcom_DRE_vect USART1_DRE_vect
+#elif defined(RAILCOM_USES_USART3)
+  #define railcom_USART    USART3
+  #define railcom_PORT     PORTB
+  #define railcom_DRE_vect USART3_DRE_vect
+#else
+  #define railcom_USART    USART2
+  #define railcom_PORT     PORTF
+  #define railcom_DRE_vect USART2_DRE_vect
+#endif
+#define RAILCOM_TXD_bm     PIN0_bm
+
+// Timer for the start of channel 2. The default is TCB1:
+// #define RAILCOM_USES_TIMERB2
+// #define RAILCOM_USES_TIMERB3
+#if defined(RAILCOM_USES_TIMERB2)
+  #define railcom_TIMER    TCB2
+  #define railcom_TCB_vect TCB2_INT_vect
+#elif defined(RAILCOM_USES_TIMERB3)
+  #define railcom_TIMER    TCB3
+  #define railcom_TCB_vect TCB3_INT_vect
+#else
+  #define railcom_TIMER    TCB1
+  #define railcom_TCB_vect TCB1_INT_vect
+#endif
+
+#define RAILCOM_BAUD       250000L
+#define RAILCOM_CH2_START  (F_CPU / 1000000 * 195)  // 2us after the earliest start (193us)
+
+// DYN variables (subindex), see RCN-217
+#define RAILCOM_DYN_ID     7
+#define RAILCOM_DV_QOS     7
+
+
+//******************************************************************************************************
+// 4/8 code (RCN-217): the code for each 6 bit value
+//******************************************************************************************************
+static const uint8_t code48[64] PROGMEM = {
+  0xAC, 0xAA, 0xA9, 0xA5, 0xA3, 0xA6, 0x9C, 0x9A, 0x99, 0x95, 0x93, 0x96, 0x8E, 0x8D, 0x8B, 0xB1,
+  0xB2, 0xB4, 0xB8, 0x74, 0x72, 0x6C, 0x6A, 0x69, 0x65, 0x63, 0x66, 0x5C, 0x5A, 0x59, 0x55, 0x53,
+  0x56, 0x4E, 0x4D, 0x4B, 0x47, 0x71, 0xE8, 0xE4, 0xE2, 0xD1, 0xC9, 0xC5, 0xD8, 0xD4, 0xD2, 0xCA,
+  0xC6, 0xCC, 0x78, 0x17, 0x1B, 0x1D, 0x1E, 0x2E, 0x36, 0x3A, 0x27, 0x2B, 0x2D, 0x35, 0x39, 0x33
+};
+
+
+//******************************************************************************************************
+// The ISRs: the start of channel 2, and one call per byte
+//******************************************************************************************************
+#if !defined(AP_DCC_HOST)
+ISR(railcom_TCB_vect) {
+  railcom_TIMER.CTRLA = 0;                            // One shot
+  railcom_TIMER.INTFLAGS = TCB_CAPT_bm;
+  railcom_USART.TXDATAL = railcomMessage.channel2[0];
+  railcomMessage.index = 1;
+  railcom_USART.CTRLA = USART_DREIE_bm;
+}
+
+
+ISR(railcom_DRE_vect) {
+  uint8_t i = railcomMessage.index;
+  if (i == RailComChannel2) {                         // All bytes are in the USART
+    railcom_USART.CTRLA = 0;                          // Disable the DRE interrupt
+    return;
+  }
+  railcom_USART.TXDATAL = railcomMessage.channel2[i];
+  railcomMessage.index = i + 1;
+}
+#endif
+
+
+//******************************************************************************************************
+// attach() / detach()
+//******************************************************************************************************
+RailComMessage::RailComMessage() {
+  ready = 0;
+  index = RailComChannel2;                            // Not sending
+  sent = 0;
+  dynamics = 0;
+  next = 0;
+  packets = 0;
+  errors = 0;
+  setDyn(RAILCOM_DV_QOS, 0);                          // QoS is always part of the rotation
+}
+
+
+void RailComMessage::attach(void) {
+  noInterrupts();
+  #if !defined(AP_DCC_HOST)
+  railcom_PORT.OUTSET = RAILCOM_TXD_bm;               // Idle: no current
+  railcom_PORT.DIRSET = RAILCOM_TXD_bm;
+  railcom_USART.BAUD = (uint16_t)((4UL * F_CPU) / RAILCOM_BAUD);
+  railcom_USART.CTRLA = 0;
+  railcom_USART.CTRLC = USART_CMODE_ASYNCHRONOUS_gc | USART_PMODE_DISABLED_gc | USART_SBMODE_1BIT_gc |
+                        USART_CHSIZE_8BIT_gc;
+  railcom_USART.CTRLB = USART_TXEN_bm;
+  railcom_TIMER.CTRLA = 0;
+  railcom_TIMER.CTRLB = TCB_CNTMODE_INT_gc;           // Periodic interrupt mode, stopped after one
+  railcom_TIMER.CCMP = RAILCOM_CH2_START;
+  railcom_TIMER.INTFLAGS = TCB_CAPT_bm;
+  railcom_TIMER.INTCTRL = TCB_CAPT_bm;
+  #endif
+  index = RailComChannel2;
+  encode();                                           // So the first packet can be answered as well
+  ready = 1;
+  interrupts();
+}
+
+
+void RailComMessage::detach(void) {
+  noInterrupts();
+  ready = 0;
+  #if !defined(AP_DCC_HOST)
+  railcom_TIMER.CTRLA = 0;
+  railcom_TIMER.INTCTRL = 0;
+  railcom_USART.CTRLA = 0;
+  railcom_USART.CTRLB = 0;
+  railcom_PORT.OUTSET = RAILCOM_TXD_bm;
+  #endif
+  index = RailComChannel2;
+  interrupts();
+}
+
+
+//******************************************************************************************************
+// send(): called by the DCC ISR for a correct packet to this decoder
+//******************************************************************************************************
+void RailComMessage::send(uint16_t elapsed) {
+  index = 0;                                          // From now on channel2 may not be changed
+  sent++;
+  #if defined(AP_DCC_HOST)
+  (void) elapsed;                                     // The shim has no USART: no timing
+  for (uint8_t i = 0; i < RailComChannel2; i++) reply[i] = channel2[i];
+  index = RailComChannel2;
+  #else
+  if (elapsed >= RAILCOM_CH2_START) {                 // Too late for channel 2
+    index = RailComChannel2;
+    sent--;
+    return;
+  }
+  railcom_TIMER.CNT = elapsed;
+  railcom_TIMER.CTRLA = TCB_ENABLE_bm;                // CLK_PER, like the DCC TCB
+  #endif
+}
+
+
+//******************************************************************************************************
+// update(): called by dcc.input() for each packet
+//******************************************************************************************************
+void RailComMessage::update(bool error) {
+  // Step 1: QoS. With windows of 100 packets, the number of errors is the percentage
+  packets++;
+  if (error) errors++;
+  if (packets == RailComQosWindow) {
+    setDyn(RAILCOM_DV_QOS, errors);
+    packets = 0;
+    errors = 0;
+  }
+  // Step 2: if the previous reply was sent, prepare the next one
+  if (!ready && (index == RailComChannel2)) {
+    encode();
+    ready = 1;
+  }
+}
+
+
+void RailComMessage::setDyn(uint8_t dv, uint8_t value) {
+  uint8_t i = 0;
+  while ((i < dynamics) && (dyn[i].dv != dv)) i++;
+  if (i == dynamics) {
+    if (dynamics == RailComDynamics) return;          // No room left
+    dynamics++;
+  }
+  // 18 bits: ID (4 bits), value (8 bits), subindex (6 bits). Each 6 bits are 4/8 encoded
+  dyn[i].dv = dv;
+  dyn[i].code[0] = pgm_read_byte(&code48[(RAILCOM_DYN_ID << 2) | (value >> 6)]);
+  dyn[i].code[1] = pgm_read_byte(&code48[value & 0x3F]);
+  dyn[i].code[2] = pgm_read_byte(&code48[dv & 0x3F]);
+}
+
+
+void RailComMessage::encode(void) {
+  // The next two variables of the rotation. With a single variable, it is sent twice
+  for (uint8_t d = 0; d < 2; d++) {
+    for (uint8_t i = 0; i < 3; i++) channel2[3 * d + i] = dyn[next].code[i];
+    next = (next + 1 == dynamics) ? 0 : next + 1;
+  }
+}
+#endif
@@ -0,0 +1,68 @@
+//******************************************************************************************************
+//
+// file:      sup_railcom.h
+// purpose:   RailCom (RCN-217) channel 2 feedback of dynamic variables (DYN)
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#pragma once
+
+#if defined(RAILCOM)
+#if (!defined(MEGACOREX) && !defined(_AVR_FAMILY) && !defined(AP_DCC_HOST)) || defined(ARDUINO_AVR_NANO_EVERY)
+#error "RailCom feedback requires a MegaCoreX or DxCore processor"
+#endif
+
+extern LocoMessage locoMessage;                     // instantiated in, and used by, DCC_Library.cpp
+
+#define RailComChannel2    6                        // Bytes in channel 2: two DYN datagrams
+#define RailComQosWindow   100                      // Packets per QoS value, so errors = percentage
+
+class RailComMessage {
+  public:
+    RailComMessage();
+    void attach(void);                              // Hardware: USART and channel 2 timer
+    void detach(void);
+    void update(bool error);                        // Called by dcc.input() for each packet
+    void setDyn(uint8_t dv, uint8_t value);         // Add or change a variable of the rotation
+
+    // Called by the DCC ISR, at the Packet End Bit. elapsed: F_CPU ticks since the edge that ended it
+    inline void packetEnd(volatile uint8_t *data, uint8_t size, uint16_t elapsed) {
+      if (!ready) return;                           // Nothing encoded, or still sending
+      uint8_t byte0 = data[0];
+      if ((byte0 == 0) || ((byte0 >= 0b10000000) && (byte0 < 0b11000000)) || (byte0 > 0b11100111)) return;
+      uint8_t x = 0;
+      for (uint8_t i = 0; i < size; i++) x ^= data[i];
+      if (x) return;                                // A corrupted packet is not answered
+      if (!locoMessage.matches(byte0, data[1])) return;
+      ready = 0;
+      send(elapsed);
+    }
+
+    volatile uint8_t ready;                         // channel2 holds the next datagrams
+    volatile uint8_t index;                         // Next byte the USART ISR sends
+    uint8_t channel2[RailComChannel2];              // 4/8 encoded, ready to send
+    volatile uint16_t sent;                         // Number of channel 2 replies
+    #if defined(AP_DCC_HOST)
+    uint8_t reply[RailComChannel2];                 // The last reply; a host has no USART
+    #endif
+
+  private:
+    void send(uint16_t elapsed);                    // Starts the channel 2 timer (on a host: sends)
+    void encode(void);                              // Fill channel2 with the next two datagrams
+
+    struct {
+      uint8_t dv;                                   // Subindex of the variable (RCN-217)
+      uint8_t code[3];                              // The 4/8 encoded datagram: ID 7, value, dv
+    } dyn[RailComDynamics];
+    uint8_t dynamics;                               // Variables in the rotation
+    uint8_t next;                                   // Next variable of the rotation
+    uint8_t packets;                                // Packets in the current QoS window
+    uint8_t errors;                                 // Packets with an XOR error in this window
+};
+
+extern RailComMessage railcomMessage;               // instantiated in, and used by, DCC_Library.cpp
+#endif
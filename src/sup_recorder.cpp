@@ -0,0 +1,133 @@
+//******************************************************************************************************
+//
+// file:      sup_recorder.cpp
+// purpose:   Flight recorder of the last DCC packets, frozen on certain events
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//            2026-10-18 V1.0.1 ap Time from clockMicros(), which may be the DCC input timer (DCC_CLOCK)
+//            2026-10-19 V1.0.2 ap Packets restored by PACKET_RECONSTRUCTION count as correct
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+// When a loco suddenly stops, or a turnout switches by itself, the question is which packets arrived
+// just before. The flight recorder keeps the last FlightRecorderSize packets in a ring. Each entry
+// is written by dcc.input(), after the packet has been analysed, so that also the result is known.
+// The ISR is not involved, and the only cost is copying the packet (upto 6 bytes) plus a few stores.
+// The time of an entry is the moment dcc.input() took the packet from the ISR (or from the packet
+// queue); if dcc.input() is called frequently, this is close to the moment the packet was received.
+//
+// On one of the configured events, the recording freezes, with the packet that caused the event as
+// last entry. The watchdog only starts after the first correct packet, so it does not freeze the
+// recording before the command station is switched on. An XOR burst is detected with a shift
+// register, in which each bit tells whether a packet had an XOR error. A packet with an XOR error
+// that PACKET_RECONSTRUCTION could restore is marked as reconstructed instead; for the events it
+// counts as a correct packet, so that a reconstructed emergency stop freezes the recording, and a
+// section on which only reconstructed packets arrive doesn't trip the watchdog or the XOR burst.
+//
+// Output of dump(), with the time relative to the event in microseconds:
+//   Flight recorder: 13 packets, frozen by an emergency stop
+//   -83900 us  03 3F 97 AB  cmd 5
+//   -77760 us  FF 00 FF  cmd 1
+//   ...
+//   0 us  00 41 41  cmd 6
+//
+//******************************************************************************************************
+#include <Arduino.h>
+#include "AP_DCC_library.h"
+#if defined(FLIGHT_RECORDER)
+#include "sup_isr.h"
+#include "sup_recorder.h"
+#include "sup_timer.h"
+
+extern DccMessage dccMessage;          // instantiated in, and used by, DCC_Library.cpp
+extern FlightRecorder flightRecorder;  // instantiated in DCC_Library.cpp, used by main sketch
+
+
+RecorderMessage::RecorderMessage() {
+  resume();
+}
+
+
+void RecorderMessage::record(uint8_t result) {
+  uint8_t i = next;
+  uint32_t now = clockMicros();
+  entry[i].time = now;
+  entry[i].size = dccMessage.size;
+  for (uint8_t j = 0; j < dccMessage.size; j++) entry[i].data[j] = dccMessage.data[j];
+  entry[i].result = result;
+  next = (i + 1 == FlightRecorderSize) ? 0 : i + 1;
+  if (count < FlightRecorderSize) count++;
+  // Check the events
+  xorHistory = xorHistory << 1;
+  if (result & RecorderXorError) {
+    xorHistory |= 1;
+    if (flightRecorder.triggers & FlightRecorder::xorBurst) {
+      uint16_t window = xorHistory;
+      if (flightRecorder.xorWindow < 16) window &= (1 << flightRecorder.xorWindow) - 1;
+      uint8_t errors = 0;
+      for (; window; window &= window - 1) errors++;
+      if (errors >= flightRecorder.xorErrors) freeze(FlightRecorder::xorBurst);
+    }
+  }
+  else {
+    lastCorrect = now;
+    correctSeen = true;
+    if (((result & ~RecorderReconstructed) == Dcc::MyEmergencyStopCmd) &&
+      (flightRecorder.triggers & FlightRecorder::emergencyStop))
+      freeze(FlightRecorder::emergencyStop);
+  }
+}
+
+
+void RecorderMessage::poll(void) {
+  if (!correctSeen || !(flightRecorder.triggers & FlightRecorder::watchdog)) return;
+  if (clockMicros() - lastCorrect > (uint32_t) flightRecorder.watchdogMs * 1000UL) freeze(FlightRecorder::watchdog);
+}
+
+
+void RecorderMessage::freeze(uint8_t trigger) {
+  reason = trigger;
+  frozenAt = clockMicros();
+}
+
+
+void RecorderMessage::resume(void) {
+  reason = FlightRecorder::none;
+  count = 0;
+  next = 0;
+  xorHistory = 0;
+  correctSeen = false;
+}
+
+
+void RecorderMessage::dump(Print &out) {
+  uint32_t end = (reason == FlightRecorder::none) ? clockMicros() : frozenAt;
+  out.print(F("Flight recorder: "));
+  out.print(count);
+  out.print(F(" packets, "));
+  switch (reason) {
+    case FlightRecorder::none:          out.println(F("recording")); break;
+    case FlightRecorder::emergencyStop: out.println(F("frozen by an emergency stop")); break;
+    case FlightRecorder::xorBurst:      out.println(F("frozen by XOR errors")); break;
+    case FlightRecorder::watchdog:      out.println(F("frozen by the watchdog")); break;
+    default:                            out.println(F("frozen by the sketch")); break;
+  }
+  uint8_t i = (next + FlightRecorderSize - count) % FlightRecorderSize;  // The oldest entry
+  for (uint8_t n = 0; n < count; n++) {
+    out.print(-(long)(end - entry[i].time));
+    out.print(F(" us "));
+    for (uint8_t j = 0; j < entry[i].size; j++) {
+      out.print(' ');
+      if (entry[i].data[j] < 16) out.print('0');
+      out.print(entry[i].data[j], HEX);
+    }
+    out.print(F("  cmd "));
+    out.print(entry[i].result & ~(RecorderXorError | RecorderReconstructed));
+    if (entry[i].result & RecorderXorError) out.print(F(" XOR"));
+    if (entry[i].result & RecorderReconstructed) out.print(F(" reconstructed"));
+    out.println();
+    i = (i + 1 == FlightRecorderSize) ? 0 : i + 1;
+  }
+}
+#endif
@@ -0,0 +1,43 @@
+//******************************************************************************************************
+//
+// file:      sup_recorder.h
+// purpose:   Flight recorder of the last DCC packets, frozen on certain events
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#pragma once
+
+#if defined(FLIGHT_RECORDER)
+#define RecorderXorError   0x80                     // Added to the cmdType of packets with an XOR error
+#define RecorderReconstructed 0x40                  // Added to the cmdType of reconstructed packets
+
+class RecorderMessage {
+  public:
+    RecorderMessage();
+    void record(uint8_t result);                    // Called by dcc.input() for each packet, if not frozen
+    void poll(void);                                // Called by dcc.input() at each call: the watchdog
+    void freeze(uint8_t trigger);
+    void resume(void);
+    void dump(Print &out);
+
+    uint8_t reason;                                 // FlightRecorder::trigger_t (none: recording)
+    uint8_t count;                                  // Number of entries in use
+
+  private:
+    struct {
+      uint32_t time;                                // micros() at which dcc.input() took the packet
+      uint8_t size;
+      uint8_t data[MaxDccSize];
+      uint8_t result;                               // cmdType, plus RecorderXorError or RecorderReconstructed
+    } entry[FlightRecorderSize];
+    uint8_t next;                                   // Entry that will be written next
+    uint16_t xorHistory;                            // Bit 0: the last packet. 1: XOR error (not reconstructed)
+    uint32_t lastCorrect;                           // micros() of the last correct (or reconstructed) packet
+    bool correctSeen;                               // The watchdog only runs after a correct packet
+    uint32_t frozenAt;                              // micros() at which the recording froze
+};
+#endif
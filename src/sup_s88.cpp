@@ -0,0 +1,160 @@
+//******************************************************************************************************
+//
+// file:      sup_s88.cpp
+// purpose:   s88-N feedback bus slave, to support the DCC library
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//            2026-10-18 V1.0.1 ap LOAD is caught with a pin interrupt, since SSIF is only set in host mode
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+// An s88 bus is a chain of shift registers. The s88 master (command station) raises LOAD (PS), after
+// which all modules latch their inputs. Once LOAD is low again, the master gives one CLOCK pulse per
+// bit. With every clock each module shifts its bits towards the master (DATA OUT), and takes over the
+// bits of the next module in the chain (DATA IN). Thus a module must:
+// 1. shift out its own inputs (input 1 first), followed by
+// 2. the bits it receives from the next module, delayed by the size of its own frame.
+// s88-N clocks may be fast (several tens of kHz). Handling each clock with a pin interrupt, in
+// particular on megaAVR 0 / AVR Dx processors where attachInterrupt() is slow (see
+// Performance_MegacoreX.md), means bits get lost, and the DCC ISR gets delayed.
+//
+// Therefore the SPI peripheral is used in slave mode, and the CPU is only involved once per byte and once per frame:
+// - s88 CLOCK    -> SCK
+// - s88 DATA IN  -> MOSI (the bits from the next module)
+// - s88 DATA OUT <- MISO (towards the master)
+// - s88 LOAD     -> SS. While LOAD is high the SPI is deselected; once LOAD goes low the first bit
+//                   (input 1) is put on MISO, before the first clock.
+// The SPI runs in mode 0 (output changes at the falling clock edge, input is sampled at the rising
+// edge), LSB first, in buffer mode. Buffer mode gives a transmit buffer of one byte, thus the ISR has
+// the time of a complete byte (8 clocks) to provide the next byte:
+// - Receive complete (RXC): at the end of byte k, byte k+1 is being shifted out and the ISR writes
+//   byte k+2 to the buffer. For k+2 < our frame size that is our own data, otherwise the byte received
+//   (frame size) bytes earlier. Our frame should therefore be at least 2 bytes (16 inputs).
+// - LOAD went high: the next frame is latched (double buffering: the sketch keeps writing new input
+//   values while the current frame is shifted out), the SPI is restarted, which resynchronises its
+//   shift register with the frame, and the first two bytes are written to the SPI.
+// The SPI can not tell when LOAD goes high: its slave select interrupt flag (SSIF) is only set in host
+// mode. The rising edge of LOAD is therefore caught with a pin interrupt on the SS pin. This costs
+// some 10us per frame (attachInterrupt() plus load()), which should fit within the LOAD pulse: s88
+// masters keep LOAD high during at least one clock pulse and the RESET pulse. The pin interrupt has the
+// normal priority, so it may be delayed by the DCC ISR (a few us).
+// Like the latches in s88 occupancy modules, an input that has been set (occupied) since the previous
+// frame is reported as set, even if it has been cleared before the master read it.
+//
+// RESET is not used. Since MISO is only driven while LOAD is low, DATA OUT needs a pull-down resistor.
+//
+// Used hardware resources:
+//  - SPI0 on MegaCoreX or DxCore, on the default (PORTMUX) pins.
+//  - The pin interrupt of the SS pin (attachInterrupt()).
+//
+//******************************************************************************************************
+#include <Arduino.h>
+#include "AP_DCC_library.h"
+#if defined(S88_SLAVE)
+#include "sup_s88.h"
+
+#if !defined(SPI_BUFEN_bm)
+#error "The s88 slave requires the SPI buffer mode of MegaCoreX / DxCore processors"
+#endif
+
+extern S88Message s88Message;             // Instantiated in AP_DCC_library.cpp
+
+
+//******************************************************************************************************
+//                                        The SPI ISR
+//******************************************************************************************************
+ISR(SPI0_INT_vect) {
+  if (SPI0.INTFLAGS & SPI_RXCIF_bm) s88Message.shift(SPI0.DATA);  // Reading DATA clears RXCIF
+}
+
+
+//******************************************************************************************************
+//                                 The LOAD (SS pin) interrupt
+//******************************************************************************************************
+static void s88_load_interrupt(void) {
+  s88Message.load();
+}
+
+
+//******************************************************************************************************
+//                                     The S88Message class
+//******************************************************************************************************
+void S88Message::attach(uint8_t bytes) {
+  if (bytes < 2) bytes = 2;
+  if (bytes > S88MaxBytes) bytes = S88MaxBytes;
+  noInterrupts();
+  _bytes = bytes;
+  for (uint8_t i = 0; i < S88MaxBytes; i++) {
+    _state[i] = 0;
+    _sticky[i] = 0;
+  }
+  frames = 0;
+  pinMode(PIN_SPI_SCK, INPUT);
+  pinMode(PIN_SPI_MOSI, INPUT);
+  pinMode(PIN_SPI_SS, INPUT);
+  pinMode(PIN_SPI_MISO, OUTPUT);                      // Only driven while SS (LOAD) is low
+  SPI0.CTRLB = SPI_BUFEN_bm | SPI_BUFWR_bm | SPI_MODE_0_gc;
+  SPI0.CTRLA = SPI_DORD_bm;                           // LSB first, slave
+  SPI0.INTCTRL = SPI_RXCIE_bm;
+  load();                                             // Prepare the first frame
+  attachInterrupt(digitalPinToInterrupt(PIN_SPI_SS), s88_load_interrupt, RISING);
+  interrupts();
+}
+
+
+void S88Message::detach(void) {
+  noInterrupts();
+  detachInterrupt(digitalPinToInterrupt(PIN_SPI_SS));
+  SPI0.INTCTRL = 0;
+  SPI0.CTRLA = 0;
+  interrupts();
+}
+
+
+void S88Message::setInput(uint8_t input, bool value) {
+  // Input 1 is the first bit the master receives
+  input--;
+  uint8_t i = input >> 3;
+  if (i >= _bytes) return;
+  uint8_t mask = 1 << (input & 7);
+  noInterrupts();
+  if (value) {
+    _state[i] |= mask;
+    _sticky[i] |= mask;
+  }
+  else _state[i] &= ~mask;
+  interrupts();
+}
+
+
+void S88Message::load(void) {
+  // Called from the LOAD pin interrupt, while LOAD is high. Restarting the SPI empties its buffers
+  SPI0.CTRLA &= ~SPI_ENABLE_bm;
+  SPI0.CTRLA |= SPI_ENABLE_bm;
+  SPI0.INTFLAGS = SPI_RXCIF_bm | SPI_TXCIF_bm | SPI_DREIF_bm | SPI_BUFOVF_bm;
+  for (uint8_t i = 0; i < _bytes; i++) {
+    _frame[i] = _state[i] | _sticky[i];
+    _sticky[i] = 0;
+  }
+  _chainIn = 0;
+  _chainOut = 0;
+  SPI0.DATA = _frame[0];                              // Shift register
+  SPI0.DATA = _frame[1];                              // Buffer
+  _position = 2;
+  frames++;
+}
+
+
+void S88Message::shift(uint8_t received) {
+  // The bits from the next module are sent once our own frame has been sent
+  _chain[_chainIn] = received;
+  _chainIn = (_chainIn + 1) & (S88ChainSize - 1);
+  if (_position < _bytes) SPI0.DATA = _frame[_position++];
+  else {
+    SPI0.DATA = _chain[_chainOut];
+    _chainOut = (_chainOut + 1) & (S88ChainSize - 1);
+  }
+}
+
+#endif
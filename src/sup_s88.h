@@ -0,0 +1,38 @@
+//******************************************************************************************************
+//
+// file:      sup_s88.h
+// purpose:   s88-N feedback bus slave, to support the DCC library
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#pragma once
+#define S88MaxBytes 8                               // Maximum size of our part of the frame (64 inputs)
+#define S88ChainSize 8                              // Bytes from downstream modules in transit (power of 2)
+
+
+class S88Message {
+  public:
+    void attach(uint8_t bytes);
+    void detach(void);
+    void setInput(uint8_t input, bool value);
+
+    // Called by the LOAD pin interrupt and the SPI ISR
+    void load(void);                                // LOAD (PS) went high: latch the next frame
+    void shift(uint8_t received);                   // A byte has been received from downstream
+
+    volatile uint16_t frames;                       // Number of frames read by the s88 master
+
+  private:
+    uint8_t _bytes;                                 // Size of our part of the frame, in bytes
+    uint8_t _state[S88MaxBytes];                    // Current state of the inputs (set by the sketch)
+    uint8_t _sticky[S88MaxBytes];                   // Inputs that were set since the last frame
+    uint8_t _frame[S88MaxBytes];                    // Frame that is being shifted out
+    uint8_t _chain[S88ChainSize];                   // Received downstream bytes, not yet sent
+    uint8_t _chainIn;                               // Ring buffer indexes
+    uint8_t _chainOut;
+    uint8_t _position;                              // Byte that will be written to the TX buffer
+};
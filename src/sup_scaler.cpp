@@ -0,0 +1,70 @@
+//******************************************************************************************************
+//
+// file:      sup_scaler.cpp
+// purpose:   Runs the main clock low while the decoder is idle, and high on own traffic
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+// An AVR Dx draws roughly proportional to its clock. A decoder in a sealed building mostly listens
+// to packets for other decoders, which a few MHz suffice for: the half bits are measured by the
+// TCB, and at 4 MHz the shortest one still lasts 208 ticks. Own commands however start the real
+// work (servos, sound, lights), which may need the full clock.
+// In automatic mode, update() switches to highMhz once burst own commands have been received (a
+// command for one of the decoder addresses, PoM or Service Mode), and back to lowMhz once no own
+// command has arrived for idleMs. Commands that are more than idleMs apart start a new burst.
+// Switching itself is done by DccMessage::setClock() (sup_isr_MegaCoreX_DxCore.h), which also
+// recomputes the half bit limits, rescales the half bit that is being measured and converts the time
+// of DCC_CLOCK. Thus also a packet that arrives during the change is received.
+//
+//******************************************************************************************************
+#include <Arduino.h>
+#include "AP_DCC_library.h"
+#if defined(CLOCK_SCALING)
+#include "sup_isr.h"
+#include "sup_timer.h"
+#include "sup_scaler.h"
+
+extern DccMessage dccMessage;
+
+
+ScalerMessage::ScalerMessage() {
+  automatic = false;
+  lowMhz = 4;
+  highMhz = F_CPU / 1000000UL;
+  burst = 1;
+  idleMs = 1000;
+  changes = 0;
+  count = 0;
+  last = 0;
+}
+
+
+bool ScalerMessage::set(uint8_t mhz) {
+  if (mhz == isrBitLimits.mhz) return true;
+  if (!dccMessage.setClock(mhz)) return false;
+  changes++;
+  return true;
+}
+
+
+void ScalerMessage::update(bool received, uint8_t cmdType) {
+  if (!automatic) return;
+  unsigned long now = dccMillis();
+  bool own = received && (((cmdType >= Dcc::MyLocoSpeedCmd) && (cmdType <= Dcc::MyLocoF61F68Cmd)) ||
+                          (cmdType == Dcc::MyAccessoryCmd) || (cmdType == Dcc::MyPomCmd) ||
+                          (cmdType == Dcc::SmCmd));
+  if (own) {
+    if (now - last > idleMs) count = 0;
+    last = now;
+    if (count < 255) count++;
+    if (count >= burst) set(highMhz);
+  }
+  else if ((isrBitLimits.mhz != lowMhz) && (now - last > idleMs)) {
+    set(lowMhz);
+    count = 0;
+  }
+}
+#endif
@@ -0,0 +1,34 @@
+//******************************************************************************************************
+//
+// file:      sup_scaler.h
+// purpose:   Runs the main clock low while the decoder is idle, and high on own traffic
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#pragma once
+
+#if defined(CLOCK_SCALING)
+class ScalerMessage {
+  public:
+    ScalerMessage();
+    void update(bool received, uint8_t cmdType);    // Called by dcc.input()
+    bool set(uint8_t mhz);                          // Changes the clock, and counts the changes
+
+    bool automatic;                                 // False: only set() changes the clock
+    uint8_t lowMhz;
+    uint8_t highMhz;
+    uint8_t burst;                                  // Own commands that switch to highMhz
+    unsigned int idleMs;                            // Without own commands: back to lowMhz
+    uint16_t changes;
+
+  private:
+    uint8_t count;                                  // Own commands since the last idle period
+    unsigned long last;                             // dccMillis() of the last own command
+};
+
+extern ScalerMessage scalerMessage;                 // instantiated in, and used by, DCC_Library.cpp
+#endif
@@ -0,0 +1,109 @@
+//******************************************************************************************************
+//
+// file:      sup_sequence.cpp
+// purpose:   Stackless sequences (coroutines) for the main sketch, driven by dcc.input()
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+// A decoder that reacts to a command with several steps (fire a coil, wait, move a servo, wait, set a
+// signal) either blocks with delay(), so that DCC packets get lost, or needs a state machine per
+// output. Coroutines give the readability of the first with the behaviour of the second. C++20
+// coroutines (co_await) are not available: the Arduino AVR cores use avr-gcc 7, without C++20 and
+// without a standard library, and each C++20 coroutine frame would be allocated on the heap. The
+// sequences are therefore stackless coroutines in the style of protothreads: the SEQ_ macros store
+// the line (__LINE__) at which the sequence waits, and return; at the next call, SEQ_BEGIN's switch
+// jumps to that line. A sequence costs one frame from a static pool, and no stack while waiting.
+//
+// run() is called at the end of each dcc.input(), after the packet (if any) has been analysed. It
+// calls each sequence for which the wait has ended:
+// - SeqRun: always (SEQ_YIELD and SEQ_WAIT_UNTIL; the latter checks its condition itself)
+// - SeqMs: once the time has passed. Time is dccMillis(), thus the time base if TIME_BASE is defined
+// - SeqCmd: if dcc.input() received a command of the type, or, with a timeout, if that has passed
+// - SeqSequence: if the other sequence has ended, was stopped, or could not be started
+// Each sequence is called at most once per run(), so a sequence that starts to wait for a command,
+// waits for the next command, not for the one that is being handled. Sequences that end (SEQ_END,
+// SEQ_EXIT or sequencer.stop()) keep their frame until the next run(), so that all sequences that
+// wait for them see they ended, before the frame can be used by another sequence.
+//
+//******************************************************************************************************
+#include <Arduino.h>
+#include "AP_DCC_library.h"
+#if defined(SEQUENCES)
+#include "sup_timer.h"
+#include "sup_sequence.h"
+
+
+SequenceMessage::SequenceMessage() {
+  for (uint8_t i = 0; i < SequenceFrames; i++) {
+    frame[i].body = 0;
+    frame[i].number = i;
+  }
+  used = 0;
+}
+
+
+uint8_t SequenceMessage::start(void (*body)(Sequence &seq), int16_t arg) {
+  if (body == 0) return NoSequence;
+  for (uint8_t i = 0; i < SequenceFrames; i++) {
+    Sequence &seq = frame[i];
+    if (seq.body) continue;
+    seq.arg = arg;
+    for (uint8_t v = 0; v < SequenceVars; v++) seq.var[v] = 0;
+    seq.timedOut = false;
+    seq.resume = 0;
+    seq.wait = SeqRun;
+    seq.body = body;
+    used++;
+    return i;
+  }
+  return NoSequence;
+}
+
+
+bool SequenceMessage::running(uint8_t number) {
+  return ((number < SequenceFrames) && frame[number].body && (frame[number].wait != SeqDone));
+}
+
+
+void SequenceMessage::run(bool received, uint8_t cmdType) {
+  if (!used) return;
+  // Step 1: sequences that wait for another sequence that has ended, may continue
+  for (uint8_t i = 0; i < SequenceFrames; i++) {
+    if (frame[i].body && (frame[i].wait == SeqSequence) && !running(frame[i].cmdType)) frame[i].wait = SeqRun;
+  }
+  // Step 2: only now the frames of ended sequences may be reused
+  for (uint8_t i = 0; i < SequenceFrames; i++) {
+    if (frame[i].body && (frame[i].wait == SeqDone)) {
+      frame[i].body = 0;
+      used--;
+    }
+  }
+  // Step 3: call the sequences whose wait has ended. A sequence started by another one, in this
+  // step, is called as well, unless its frame has already been passed
+  unsigned long now = dccMillis();
+  for (uint8_t i = 0; i < SequenceFrames; i++) {
+    Sequence &seq = frame[i];
+    if (!seq.body) continue;
+    switch (seq.wait) {
+      case SeqMs:
+        if (now - seq.since < seq.ms) continue;
+      break;
+      case SeqCmd:
+        if (received && (cmdType == seq.cmdType)) seq.timedOut = false;
+        else if (seq.ms && (now - seq.since >= seq.ms)) seq.timedOut = true;
+        else continue;
+      break;
+      case SeqSequence:
+      case SeqDone:
+        continue;
+      default:
+      break;
+    }
+    seq.wait = SeqRun;
+    seq.body(seq);
+  }
+}
+#endif
@@ -0,0 +1,35 @@
+//******************************************************************************************************
+//
+// file:      sup_sequence.h
+// purpose:   Stackless sequences (coroutines) for the main sketch, driven by dcc.input()
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#pragma once
+
+#if defined(SEQUENCES)
+// What a sequence waits for (Sequence::wait)
+#define SeqRun             0                        // Nothing: called at each dcc.input()
+#define SeqMs              1                        // A number of milliseconds
+#define SeqCmd             2                        // A command of a certain type, or the timeout
+#define SeqSequence        3                        // The end of another sequence
+#define SeqDone            4                        // Ended; the frame is freed by the next run()
+
+
+class SequenceMessage {
+  public:
+    SequenceMessage();
+    void run(bool received, uint8_t cmdType);       // Called by dcc.input()
+    uint8_t start(void (*body)(Sequence &seq), int16_t arg);
+    bool running(uint8_t number);
+
+    Sequence frame[SequenceFrames];
+    uint8_t used;                                   // Frames in use; 0: run() returns at once
+};
+
+extern SequenceMessage sequenceMessage;             // instantiated in, and used by, DCC_Library.cpp
+#endif
@@ -0,0 +1,108 @@
+//******************************************************************************************************
+//
+// file:      sup_stack.cpp
+// purpose:   Stack painting and high water mark, to measure the stack depth of the DCC library
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+// On processors with 2KB RAM, the stack of a sketch with deep call chains may grow into the global
+// variables or the heap once the DCC ISR fires at the wrong moment. Such crashes are random and hard
+// to trace. To base RAM budgets on measured numbers, two techniques are combined:
+//
+// 1. Stack painting. Before main() and the constructors run (section .init3), all RAM between the
+//    end of the global variables (_end) and the top of the stack (__stack) is filled with StackPaint.
+//    The stack grows downwards and overwrites the paint; the lowest overwritten byte is the high
+//    water mark. It includes everything: the sketch, the library, and all ISRs (also those of other
+//    libraries), at their worst combination so far. A stack byte that happens to have the value of
+//    StackPaint makes the result a few bytes too optimistic.
+// 2. Stack probes (see sup_stack.h). These tell per code path how deep the stack was, so it can be
+//    seen whether a deep stack is caused by the sketch (dcc.input() was called deep in a call chain),
+//    by the analysers, or by the DCC ISR interrupting a deep call chain.
+//
+// The static counterpart, the worst case stack usage determined by the compiler, is calculated by
+// extras/Stack_Usage/stack_usage.py.
+//
+//******************************************************************************************************
+#include <Arduino.h>
+#include "AP_DCC_library.h"
+#if defined(STACK_MONITOR)
+#include "sup_stack.h"
+
+extern uint8_t _end;                                // Provided by the linker: end of .data / .bss
+extern uint8_t __stack;                             // Provided by the linker: RAMEND
+extern char *__brkval;                              // avr-libc: end of the heap (0 if malloc() is unused)
+
+// The probes start at "not reached". Note that .data is initialised after painting (in .init4)
+volatile uint16_t stackProbe[StackProbes] = {0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF};
+
+
+//******************************************************************************************************
+// Painting
+//******************************************************************************************************
+// Runs before the stack is used (the C runtime has only initialised SP). Since the stack is still
+// empty, the complete area can be painted. Naked: no prologue, no return; .init4 follows directly.
+void stackPaintInit(void) __attribute__ ((naked, used, section(".init3")));
+void stackPaintInit(void) {
+  __asm volatile (
+    "    ldi r30, lo8(_end)         \n"
+    "    ldi r31, hi8(_end)         \n"
+    "    ldi r24, %0                \n"
+    "    ldi r25, hi8(__stack)      \n"
+    "    rjmp 2f                    \n"
+    "1:  st Z+, r24                 \n"
+    "2:  cpi r30, lo8(__stack)      \n"
+    "    cpc r31, r25               \n"
+    "    brlo 1b                    \n"
+    "    breq 1b                    \n"
+    :: "M" (StackPaint));
+}
+
+
+static uint8_t *stackBottom(void) {
+  // Painting starts above the heap
+  if (__brkval != 0) return (uint8_t *) __brkval;
+  return &_end;
+}
+
+
+//******************************************************************************************************
+//                                    The StackMessage class
+//******************************************************************************************************
+uint16_t StackMessage::unused(void) {
+  uint8_t *p = stackBottom();
+  while ((p <= &__stack) && (*p == StackPaint)) p++;
+  return p - stackBottom();
+}
+
+
+uint16_t StackMessage::maxDepth(void) {
+  uint8_t *p = stackBottom();
+  while ((p <= &__stack) && (*p == StackPaint)) p++;
+  return &__stack - p + 1;
+}
+
+
+uint16_t StackMessage::depth(uint8_t probe) {
+  if (probe >= StackProbes) return 0;
+  noInterrupts();
+  uint16_t sp = stackProbe[probe];
+  interrupts();
+  if (sp == 0xFFFF) return 0;                       // This path was not taken yet
+  return (uint16_t)(uintptr_t) &__stack - sp;
+}
+
+
+void StackMessage::reset(void) {
+  // The area below the current stack pointer is free. Interrupts are disabled, since ISRs use it
+  noInterrupts();
+  uint8_t *p = stackBottom();
+  uint8_t *sp = (uint8_t *)(uintptr_t) SP;
+  while (p < sp) *p++ = StackPaint;
+  for (uint8_t i = 0; i < StackProbes; i++) stackProbe[i] = 0xFFFF;
+  interrupts();
+}
+
+#endif
@@ -0,0 +1,46 @@
+//******************************************************************************************************
+//
+// file:      sup_stack.h
+// purpose:   Stack painting and stack probes, to measure the stack depth of the DCC library
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+// A probe records the lowest stack pointer seen at a certain place in the code. The probes are
+// placed at the entry of the DCC ISR, at the deepest point of the ISR (a complete packet), and at
+// the entry of dcc.input() and its analysers. Without STACK_MONITOR, STACK_PROBE() is empty.
+//
+//******************************************************************************************************
+#pragma once
+
+#if defined(STACK_MONITOR)
+#if !defined(__AVR__)
+#error "STACK_MONITOR requires an AVR processor"
+#endif
+
+#define StackPaint          0xC5                    // Value of stack bytes that were never used
+#define StackProbes         6
+// Probe numbers are the same as StackMonitor::probe_t (AP_DCC_library.h)
+#define STACK_PROBE_ISR     0                       // DCC ISR, every interrupt
+#define STACK_PROBE_PACKET  1                       // DCC ISR, complete packet received
+#define STACK_PROBE_INPUT   2                       // dcc.input()
+#define STACK_PROBE_LOCO    3                       // LocoMessage::analyse()
+#define STACK_PROBE_ACC     4                       // AccMessage::analyse()
+#define STACK_PROBE_CV      5                       // CvMessage::analyseSM() and analysePoM()
+
+extern volatile uint16_t stackProbe[StackProbes];   // Lowest SP per probe. Defined in sup_stack.cpp
+
+#define STACK_PROBE(n) do { uint16_t sp = SP; if (sp < stackProbe[n]) stackProbe[n] = sp; } while (0)
+
+class StackMessage {
+  public:
+    uint16_t unused(void);                          // Bytes between heap and stack never used
+    uint16_t maxDepth(void);                        // Deepest stack so far (high water mark)
+    uint16_t depth(uint8_t probe);                  // Deepest stack at this probe (0: not reached)
+    void reset(void);                               // Repaint the free area and clear the probes
+};
+#else
+#define STACK_PROBE(n)
+#endif
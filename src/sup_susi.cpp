@@ -0,0 +1,290 @@
+//******************************************************************************************************
+//
+// file:      sup_susi.cpp
+// purpose:   SUSI (RCN-600) master, to forward loco commands to sound and function modules
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//            2026-10-18 V1.0.1 ap Timeouts read the time base (TIME_BASE)
+//            2026-10-18 V1.0.2 ap Time from clockMillis(), which may be the DCC input timer (DCC_CLOCK)
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+// SUSI is a synchronous serial interface between a loco decoder (master) and sound or function
+// modules (slaves). The master generates the clock; data is sent LSB first. The master applies the
+// data with the rising edge of the clock, and the slaves read it at the falling edge. The clock is
+// high while idle. Most packets consist of two bytes (command and data); CV access uses three bytes.
+//
+// If SUSI_MASTER is defined, dcc.input() forwards all relevant commands for this decoder:
+// - Speed and direction (0x24), scaled to 127 steps
+// - Function groups F0..F4 (0x60), F5..F12 (0x61) and F13..F68 (0x62..0x68)
+// - CV access (PoM and SM) for the SUSI CVs 897..1024: verify (0x77), bit manipulation (0x7B) and
+//   write (0x7F). In Service Mode, an acknowledge from the module is passed to the command station
+//   via dcc.sendAck(). The main sketch should ignore these CVs.
+//
+// To keep the CPU load low:
+// - A USART in Master SPI mode generates the clock and shifts the bits, and the Data Register Empty
+//   interrupt feeds it from a small queue. Thus the CPU is only involved once per byte.
+// - Only changes are sent. Since retransmissions are already filtered by the library, a change is
+//   sent once; if multiple changes arrive before a group could be sent, only the last value is sent.
+// - Every SUSI_REFRESH_MS one group is refreshed in the background, round robin, so modules that
+//   missed a packet (or were reset) get the current state within roughly a second.
+// - The acknowledge window of CV commands is handled by polling from dcc.input(); no busy waiting.
+//
+// Used hardware resources:
+//  - USART1 on MegaCoreX or DxCore (or USART0 / USART2, see below), on the default (PORTMUX) pins:
+//    TXD (Px0) is SUSI data and XCK (Px2) is SUSI clock. The level shifting to the SUSI levels
+//    (and the pull-up on data) should be done in hardware.
+//
+//******************************************************************************************************
+#include <Arduino.h>
+#include "AP_DCC_library.h"
+#if defined(SUSI_MASTER)
+#include "sup_susi.h"
+#include "sup_timer.h"
+
+#if !defined(USART_CMODE_MSPI_gc)
+#error "The SUSI master requires the USART Master SPI mode of MegaCoreX / DxCore processors"
+#endif
+
+extern SusiMessage susiMessage;           // Instantiated in AP_DCC_library.cpp
+extern Dcc dcc;
+extern Loco locoCmd;
+extern CvAccess cvCmd;
+
+
+//******************************************************************************************************
+// Defines that may need to be modified to accomodate certain hardware
+//******************************************************************************************************
+// USART to use. The default is USART1. This can be overruled by setting one of the following defines:
+// #define SUSI_USES_USART0
+// #define SUSI_USES_USART2
+#if defined(SUSI_USES_USART0)
+  #define susi_USART     USART0
+  #define susi_PORT      PORTA
+  #define susi_DRE_vect  USART0_DRE_vect
+#elif defined(SUSI_USES_USART2)
+  #define susi_USART     USART2
+  #define susi_PORT      PORTF
+  #define susi_DRE_vect  USART2_DRE_vect
+#else
+  #define susi_USART     USART1
+  #define susi_PORT      PORTC
+  #define susi_DRE_vect  USART1_DRE_vect
+#endif
+#define SUSI_DATA_bm     PIN0_bm
+#define SUSI_CLOCK_bm    PIN2_bm
+
+#define SUSI_CLOCK       50000L            // Hz. RCN-600 allows a clock period of 10..500us
+#define SUSI_REFRESH_MS  100               // One group is refreshed every 100ms
+#define SUSI_ACK_MS      3                 // Acknowledge window after a CV packet
+
+// Possible values for _cvState
+#define CV_IDLE          0                 // No CV command for SUSI
+#define CV_QUEUED        1                 // Waiting for room in the transmit queue
+#define CV_SENDING       2                 // Waiting till the last bit has been sent
+#define CV_ACK_WINDOW    3                 // Data line released: a low level is an acknowledge
+#define CV_ACKED         4                 // Acknowledge received, window not yet over
+
+
+//******************************************************************************************************
+// The USART ISR: one call per byte
+//******************************************************************************************************
+ISR(susi_DRE_vect) {
+  uint8_t out = susiMessage.queueOut;
+  if (out == susiMessage.queueIn) {                   // Queue is empty
+    susi_USART.CTRLA = 0;                             // Disable the DRE interrupt
+    return;
+  }
+  susi_USART.TXDATAL = susiMessage.queue[out];
+  susiMessage.queueOut = (out + 1) & (SusiQueueSize - 1);
+}
+
+
+//******************************************************************************************************
+// attach() / detach()
+//******************************************************************************************************
+void SusiMessage::attach(uint8_t speedSteps) {
+  _speedSteps = speedSteps;
+  _dirty = 0x03FF;                                    // Send all groups once
+  _refreshGroup = 0;
+  _lastRefresh = clockMillis();
+  _cvState = CV_IDLE;
+  queueIn = 0;
+  queueOut = 0;
+  noInterrupts();
+  susi_PORT.OUTSET = SUSI_DATA_bm | SUSI_CLOCK_bm;
+  susi_PORT.DIRSET = SUSI_DATA_bm | SUSI_CLOCK_bm;
+  susi_PORT.PIN2CTRL |= PORT_INVEN_bm;                // Clock is high while idle
+  susi_USART.BAUD = (uint16_t)((F_CPU / (2 * SUSI_CLOCK)) << 6);
+  susi_USART.CTRLC = USART_CMODE_MSPI_gc | USART_UDORD_bm;  // LSB first. UCPHA = 0
+  susi_USART.CTRLA = 0;
+  susi_USART.CTRLB = USART_TXEN_bm;
+  interrupts();
+}
+
+
+void SusiMessage::detach(void) {
+  noInterrupts();
+  susi_USART.CTRLA = 0;
+  susi_USART.CTRLB = 0;
+  susi_PORT.PIN2CTRL &= ~PORT_INVEN_bm;
+  interrupts();
+}
+
+
+//******************************************************************************************************
+// Put a packet in the transmit queue
+//******************************************************************************************************
+bool SusiMessage::send(uint8_t size, uint8_t byte1, uint8_t byte2, uint8_t byte3) {
+  uint8_t in = queueIn;
+  uint8_t space = (queueOut - in - 1) & (SusiQueueSize - 1);
+  if (space < size) return false;
+  queue[in] = byte1;
+  in = (in + 1) & (SusiQueueSize - 1);
+  queue[in] = byte2;
+  in = (in + 1) & (SusiQueueSize - 1);
+  if (size == 3) {
+    queue[in] = byte3;
+    in = (in + 1) & (SusiQueueSize - 1);
+  }
+  noInterrupts();
+  queueIn = in;
+  susi_USART.CTRLA = USART_DREIE_bm;                  // The ISR takes it from here
+  interrupts();
+  return true;
+}
+
+
+bool SusiMessage::sendGroup(uint8_t group) {
+  // The latest values are taken from locoCmd
+  uint8_t value;
+  switch (group) {
+    case 0:                                           // Speed: R G G G G G G G
+      value = locoCmd.speed;
+      if (_speedSteps == 28) value = ((unsigned int)value * 127 + 14) / 28;
+        else if (_speedSteps == 14) value = ((unsigned int)value * 127 + 7) / 14;
+      if (value > 127) value = 127;
+      if (locoCmd.forward) value |= 0x80;
+      return send(2, 0x24, value);
+    case 1: return send(2, 0x60, locoCmd.F0F4);      // 0 0 0 F0 F4 F3 F2 F1
+    case 2: return send(2, 0x61, (locoCmd.F9F12 << 4) | locoCmd.F5F8);
+    case 3: return send(2, 0x62, locoCmd.F13F20);
+    case 4: return send(2, 0x63, locoCmd.F21F28);
+    case 5: return send(2, 0x64, locoCmd.F29F36);
+    case 6: return send(2, 0x65, locoCmd.F37F44);
+    case 7: return send(2, 0x66, locoCmd.F45F52);
+    case 8: return send(2, 0x67, locoCmd.F53F60);
+    case 9: return send(2, 0x68, locoCmd.F61F68);
+  }
+  return true;
+}
+
+
+//******************************************************************************************************
+// forward(): called by dcc.input() after a packet has been decoded
+//******************************************************************************************************
+void SusiMessage::forward(Dcc::CmdType_t cmdType) {
+  switch (cmdType) {
+    case Dcc::ResetCmd:
+      _dirty = 0x03FF;
+    break;
+    case Dcc::MyLocoSpeedCmd:
+    case Dcc::MyEmergencyStopCmd:
+      _dirty |= (1 << 0);
+    break;
+    case Dcc::MyLocoF0F4Cmd:
+      _dirty |= (1 << 1);
+    break;
+    case Dcc::MyLocoF5F8Cmd:
+    case Dcc::MyLocoF9F12Cmd:
+      _dirty |= (1 << 2);
+    break;
+    case Dcc::MyLocoF13F20Cmd:
+    case Dcc::MyLocoF21F28Cmd:
+    case Dcc::MyLocoF29F36Cmd:
+    case Dcc::MyLocoF37F44Cmd:
+    case Dcc::MyLocoF45F52Cmd:
+    case Dcc::MyLocoF53F60Cmd:
+    case Dcc::MyLocoF61F68Cmd:
+      _dirty |= (1 << (cmdType - Dcc::MyLocoF13F20Cmd + 3));
+    break;
+    case Dcc::MyPomCmd:
+    case Dcc::SmCmd:
+      // CV bank 897..1024 belongs to the SUSI modules. One CV command at a time
+      if ((cvCmd.number < 897) || (cvCmd.number > 1024) || (_cvState != CV_IDLE)) break;
+      _cvPacket[1] = 0x80 | (cvCmd.number - 897);
+      switch (cvCmd.operation) {
+        case CvAccess::verifyByte:
+          _cvPacket[0] = 0x77;
+          _cvPacket[2] = cvCmd.value;
+        break;
+        case CvAccess::bitManipulation:                // 111K DBBB, like in the DCC packet
+          _cvPacket[0] = 0x7B;
+          _cvPacket[2] = 0b11100000 | (cvCmd.writecmd << 4) | (cvCmd.bitvalue << 3) | cvCmd.bitposition;
+        break;
+        case CvAccess::writeByte:
+          _cvPacket[0] = 0x7F;
+          _cvPacket[2] = cvCmd.value;
+        break;
+        default:
+          return;
+      }
+      _cvServiceMode = (cmdType == Dcc::SmCmd);
+      _cvState = CV_QUEUED;
+    break;
+    default:
+    break;
+  }
+}
+
+
+//******************************************************************************************************
+// update(): called by dcc.input() on every call
+//******************************************************************************************************
+void SusiMessage::update(void) {
+  unsigned int now = dccMillis();
+  // Step 1: CV commands have priority. During the acknowledge window nothing else is sent
+  switch (_cvState) {
+    case CV_QUEUED:
+      if (queueIn != queueOut) return;                // First empty the queue
+      susi_USART.STATUS = USART_TXCIF_bm;
+      send(3, _cvPacket[0], _cvPacket[1], _cvPacket[2]);
+      _cvState = CV_SENDING;
+    return;
+    case CV_SENDING:
+      if ((queueIn != queueOut) || !(susi_USART.STATUS & USART_TXCIF_bm)) return;
+      susi_USART.CTRLB = 0;                           // Release the data line
+      susi_PORT.DIRCLR = SUSI_DATA_bm;
+      _cvTime = now;
+      _cvState = CV_ACK_WINDOW;
+    return;
+    case CV_ACK_WINDOW:
+    case CV_ACKED:
+      if (!(susi_PORT.IN & SUSI_DATA_bm)) _cvState = CV_ACKED;
+      if ((unsigned int)(now - _cvTime) < SUSI_ACK_MS) return;
+      susi_PORT.DIRSET = SUSI_DATA_bm;
+      susi_USART.CTRLB = USART_TXEN_bm;
+      if ((_cvState == CV_ACKED) && _cvServiceMode) dcc.sendAck();
+      _cvState = CV_IDLE;
+    return;
+  }
+  // Step 2: changed groups
+  if (_dirty) {
+    for (uint8_t group = 0; group < 10; group++) {
+      if (_dirty & (1 << group)) {
+        if (sendGroup(group)) _dirty &= ~(1 << group);
+        return;                                       // One group per call
+      }
+    }
+  }
+  // Step 3: background refresh
+  if ((unsigned int)(now - _lastRefresh) >= SUSI_REFRESH_MS) {
+    if (sendGroup(_refreshGroup)) {
+      _lastRefresh = now;
+      if (++_refreshGroup >= 10) _refreshGroup = 0;
+    }
+  }
+}
+
+#endif
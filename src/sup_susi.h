@@ -0,0 +1,40 @@
+//******************************************************************************************************
+//
+// file:      sup_susi.h
+// purpose:   SUSI (RCN-600) master, to forward loco commands to sound and function modules
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#pragma once
+#define SusiQueueSize 16                            // Transmit queue, in bytes (power of 2)
+
+
+class SusiMessage {
+  public:
+    void attach(uint8_t speedSteps);
+    void detach(void);
+    void forward(Dcc::CmdType_t cmdType);           // Called by dcc.input() for each decoded packet
+    void update(void);                              // Called by dcc.input(): sends, refreshes, acks
+
+    // Used by the USART ISR
+    volatile uint8_t queue[SusiQueueSize];
+    volatile uint8_t queueIn;
+    volatile uint8_t queueOut;
+
+  private:
+    bool send(uint8_t size, uint8_t byte1, uint8_t byte2, uint8_t byte3 = 0);
+    bool sendGroup(uint8_t group);                  // 0: speed, 1..9: function groups
+    uint8_t _speedSteps;                            // 14, 28 or 128
+    uint16_t _dirty;                                // Bit per group: changed, not yet sent
+    uint8_t _refreshGroup;                          // Next group to refresh
+    unsigned int _lastRefresh;                      // millis() of the last refresh
+    // CV forwarding
+    uint8_t _cvState;
+    bool _cvServiceMode;                            // Acknowledge via dcc.sendAck()
+    uint8_t _cvPacket[3];
+    unsigned int _cvTime;                           // millis() at the start of the ack window
+};
@@ -0,0 +1,158 @@
+//******************************************************************************************************
+//
+// file:      sup_timer.cpp
+// purpose:   Time base with hierarchical timer wheels, shared by the library and the main sketch
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//            2026-10-18 V1.0.1 ap The clock may be the DCC capture timer (DCC_CLOCK)
+//            2026-10-18 V1.0.2 ap Slots are relative to the wheel position, so timers survive a wrap of now
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+// Decoders often need many timeouts at the same time: pulses for coils, servo and signal ramps,
+// blinking LEDs, and inside the library the Service Mode timeout. If each of these calls millis() and
+// compares it with its own start time, the main loop spends much of its time on comparisons that
+// almost always fail. The time base calls millis() once per dcc.input() and advances a counter (now)
+// one millisecond at a time. Timers are kept in three wheels of 10 slots:
+// - wheel 0: timers that expire within 10 ms, in the slot of their millisecond (1 ms resolution)
+// - wheel 1: timers that expire within 100 ms, in the slot of their 10 ms period
+// - wheel 2: all later timers, in the slot of their 100 ms period
+// Starting and stopping a timer is O(1): it is linked into, or removed from, a doubly linked list.
+// Each tick only looks at one slot of wheel 0. Every 10 ms the next slot of wheel 1 is cascaded, and
+// every 100 ms the next slot of wheel 2: its timers are linked again, now in a lower wheel. Timers
+// more than a second away simply stay in wheel 2 until their slot comes round in the right second.
+// Each timer still fires at its exact millisecond.
+// The position of the wheels (digit[]) is a counter of its own, and the slot of a timer is determined
+// from its delay and that position, not from the digits of its expiry time. After 2^32 ms (49.7 days)
+// now wraps to 0, which, since 2^32 is not a multiple of 1000, doesn't fit the digits of the wheels.
+//
+// Dedicated hardware is not needed: on all supported processors the Arduino core already keeps a
+// timer running for millis(), while the other timers are used for the DCC input and the occupancy ADC.
+// If DCC_CLOCK is defined, the time comes from the DCC input timer instead (see sup_isr.h).
+// Since the wheels only advance within dcc.input() (or timeBase.update()), callbacks are called from
+// the main loop, never from an interrupt. If the loop was blocked for a while, all missed ticks are
+// handled in order, so the order in which timers fire does not depend on the moments of the calls.
+// Callbacks may start and stop timers, but should not call dcc.input().
+//
+//******************************************************************************************************
+#include <Arduino.h>
+#include "AP_DCC_library.h"
+#if defined(TIME_BASE)
+#include "sup_timer.h"
+
+
+TimerMessage::TimerMessage() {
+  now = 0;                                          // The first update() catches up with clockMillis()
+  for (uint8_t i = 0; i < 3; i++) digit[i] = 0;
+  for (uint8_t i = 0; i <= TimerSlots; i++) head[i] = NoTimer;
+  for (uint8_t i = 0; i < LibraryTimers + TimeBaseTimers; i++) {
+    timer[i].callback = 0;
+    timer[i].list = TimerIdle;
+  }
+  created = LibraryTimers;
+}
+
+
+void TimerMessage::update(void) {
+  unsigned long ms = clockMillis();
+  while (now != ms) tick();
+}
+
+
+uint8_t TimerMessage::create(void (*callback)(void)) {
+  if (created == LibraryTimers + TimeBaseTimers) return NoTimer;
+  attach(created, callback);
+  return created++;
+}
+
+
+void TimerMessage::attach(uint8_t number, void (*callback)(void)) {
+  timer[number].callback = callback;
+}
+
+
+void TimerMessage::start(uint8_t number, unsigned int ms, unsigned int period) {
+  if (number >= created) return;
+  if (timer[number].list != TimerIdle) unlink(number);
+  timer[number].expires = now + ((ms == 0) ? 1 : ms);   // The earliest moment is the next tick
+  timer[number].period = period;
+  insert(number);
+}
+
+
+void TimerMessage::stop(uint8_t number) {
+  if ((number < created) && (timer[number].list != TimerIdle)) unlink(number);
+}
+
+
+bool TimerMessage::running(uint8_t number) {
+  return ((number < created) && (timer[number].list != TimerIdle));
+}
+
+
+//******************************************************************************************************
+void TimerMessage::tick(void) {
+  now++;
+  if (++digit[0] == 10) {
+    digit[0] = 0;
+    if (++digit[1] == 10) {
+      digit[1] = 0;
+      if (++digit[2] == 10) digit[2] = 0;
+      handle(20 + digit[2]);                        // Cascade wheel 2
+    }
+    handle(10 + digit[1]);                          // Cascade wheel 1
+  }
+  handle(digit[0]);                                 // Fire the timers of wheel 0
+}
+
+
+void TimerMessage::handle(uint8_t list) {
+  // The timers are first moved to the pending list, since a timer may be linked into the same slot
+  // again (wheel 2), and callbacks may start or stop any timer, including the pending ones
+  uint8_t number = head[list];
+  if (number == NoTimer) return;
+  head[list] = NoTimer;
+  head[TimerPending] = number;
+  for (uint8_t i = number; i != NoTimer; i = timer[i].next) timer[i].list = TimerPending;
+  while ((number = head[TimerPending]) != NoTimer) {
+    unlink(number);
+    if (timer[number].expires == now) {
+      if (timer[number].period) {                   // Periodic: link again before the callback,
+        timer[number].expires += timer[number].period;  // which may stop or restart it
+        insert(number);
+      }
+      if (timer[number].callback) timer[number].callback();
+    }
+    else insert(number);                            // Cascade into a lower wheel
+  }
+}
+
+
+void TimerMessage::insert(uint8_t number) {
+  unsigned long delay = timer[number].expires - now;
+  if (delay < 10) link(number, (digit[0] + delay) % 10);
+  else if (delay < 100) link(number, 10 + ((digit[1] * 10 + digit[0] + delay) / 10) % 10);
+  else link(number, 20 + ((digit[2] * 100 + digit[1] * 10 + digit[0] + delay % 1000) / 100) % 10);
+}
+
+
+void TimerMessage::link(uint8_t number, uint8_t list) {
+  uint8_t first = head[list];
+  timer[number].list = list;
+  timer[number].prev = NoTimer;
+  timer[number].next = first;
+  if (first != NoTimer) timer[first].prev = number;
+  head[list] = number;
+}
+
+
+void TimerMessage::unlink(uint8_t number) {
+  uint8_t next = timer[number].next;
+  uint8_t prev = timer[number].prev;
+  if (prev == NoTimer) head[timer[number].list] = next;
+    else timer[prev].next = next;
+  if (next != NoTimer) timer[next].prev = prev;
+  timer[number].list = TimerIdle;
+}
+#endif
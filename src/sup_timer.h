@@ -0,0 +1,71 @@
+//******************************************************************************************************
+//
+// file:      sup_timer.h
+// purpose:   Time base with hierarchical timer wheels, shared by the library and the main sketch
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//            2026-10-18 V1.0.1 ap The clock may be the DCC capture timer (DCC_CLOCK)
+//            2026-10-18 V1.0.2 ap Slots are relative to the wheel position, so timers survive a wrap of now
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#pragma once
+
+// The clock of the library: millis() of the Arduino core, or the DCC capture timer (DCC_CLOCK)
+#if defined(DCC_CLOCK)
+#include "sup_isr.h"
+inline unsigned long clockMillis(void) { return captureClock.millis(); }
+inline unsigned long clockMicros(void) { return captureClock.micros(); }
+#else
+inline unsigned long clockMillis(void) { return millis(); }
+inline unsigned long clockMicros(void) { return micros(); }
+#endif
+
+#if defined(TIME_BASE)
+#define TimerSM            0                        // Timers used by the library itself
+#define LibraryTimers      1
+#define TimerSlots         30                       // 3 wheels of 10 slots (1 ms, 10 ms and 100 ms)
+#define TimerPending       30                       // List of the timers being handled by tick()
+#define TimerIdle          255                      // List of a timer that is not running
+
+class TimerMessage {
+  public:
+    TimerMessage();
+    void update(void);                              // Called by dcc.input(): advance the wheels to clockMillis()
+    uint8_t create(void (*callback)(void));         // Timer for the main sketch, or NoTimer
+    void attach(uint8_t number, void (*callback)(void));
+    void start(uint8_t number, unsigned int ms, unsigned int period);
+    void stop(uint8_t number);
+    bool running(uint8_t number);
+
+    unsigned long now;                              // Milliseconds; follows clockMillis(), one tick at a time
+
+  private:
+    void tick(void);
+    void handle(uint8_t list);                      // Fire or cascade the timers in a slot
+    void insert(uint8_t number);                    // Link a timer in the slot of its expiry time
+    void link(uint8_t number, uint8_t list);
+    void unlink(uint8_t number);
+
+    struct {
+      void (*callback)(void);
+      unsigned long expires;                        // Value of now at which the timer fires
+      unsigned int period;                          // 0: one-shot
+      uint8_t list;                                 // Slot (0..29), TimerPending or TimerIdle
+      uint8_t next;
+      uint8_t prev;
+    } timer[LibraryTimers + TimeBaseTimers];
+    uint8_t head[TimerSlots + 1];                   // First timer of each list, or NoTimer
+    uint8_t digit[3];                               // Position of wheels 0, 1 and 2 (ticks modulo 1000)
+    uint8_t created;                                // Number of timers in use
+};
+
+extern TimerMessage timerMessage;                   // instantiated in, and used by, DCC_Library.cpp
+
+// The library's own timeouts read the time base, instead of calling millis() each time
+inline unsigned long dccMillis(void) { return timerMessage.now; }
+#else
+inline unsigned long dccMillis(void) { return clockMillis(); }
+#endif
@@ -0,0 +1,278 @@
+//******************************************************************************************************
+//
+// file:      sup_vm.cpp
+// purpose:   Small bytecode interpreter for user logic that is triggered by DCC commands
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//            2026-10-18 V1.0.1 ap Timeouts read the time base (TIME_BASE)
+//            2026-10-18 V1.0.2 ap Time from clockMillis(), which may be the DCC input timer (DCC_CLOCK)
+//            2026-10-19 V1.0.3 ap WAIT and WAITI upto 65535 ms (the deadline test overflowed an int)
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+// Accessory decoders often need some logic: switch an output after a delay, combine outputs, or
+// refuse a command because of an interlock. Instead of changing (and reflashing) the sketch for every
+// change in behaviour, such logic can be written as a small program for this interpreter. Programs
+// are stored in flash (PROGMEM) or in EEPROM. Since decoders usually map their CVs onto EEPROM, a
+// program in EEPROM can be changed in the field via CV writes (PoM or SM), or by a bulk transfer
+// of the sketch; after that, logic.loadEeprom() activates it.
+//
+// Program format (all 16 bit values low byte first):
+//   byte 0-1:  total size of the program, including this header
+//   byte 2:    number of handlers (n)
+//   n times:   cmdType (Dcc::CmdType_t), offset of the handler (2 bytes, from the start of the program)
+//   code:      the instructions, see sup_vm.h
+//
+// If dcc.input() returns a cmdType that has a handler, a task is started at that handler. Upto
+// VmTasks tasks may run concurrently; each has its own registers (initialised to 0) and may be
+// suspended by WAIT. Tasks share the variables, which can be used for interlocks between handlers
+// or to remember a state. The fields of accCmd and locoCmd are read when LDF is executed, so a task
+// should load the fields it needs before it executes a WAIT.
+//
+// To guarantee that decoding is never stalled, dcc.input() executes at most "budget" instructions
+// per call, spread round robin over the active tasks. Programs are verified at load time (valid
+// opcodes, registers, variables and fields, and all jump targets at the start of an instruction),
+// so at runtime the interpreter needs no checks, and a corrupted program can not crash the decoder.
+// At load time the handler table is also converted into a dispatch table, indexed by cmdType.
+//
+//******************************************************************************************************
+#include <Arduino.h>
+#include "AP_DCC_library.h"
+#if defined(LOGIC_VM)
+#include "sup_vm.h"
+#include "sup_timer.h"
+#if defined(__AVR__)
+#include <avr/eeprom.h>
+#endif
+
+extern Accessory accCmd;
+extern Loco locoCmd;
+
+// Operand signature per opcode. r/s: register, i: byte, w: word, t: target, f: field, p: pin, v: variable
+static const char signature[VM_OPCODES][4] PROGMEM = {
+  "",    "ri",  "rw",  "rf",  "rs",  "rs",  "rs",  "rs",  "rs",  "rs",  "ri",  "ri",
+  "ri",  "t",   "rt",  "rt",  "rit", "pr",  "rp",  "r",   "w",   "rv",  "vr"
+};
+
+
+//******************************************************************************************************
+// Fetching bytes from flash or EEPROM
+//******************************************************************************************************
+uint8_t LogicVm::fetch(uint16_t pc) {
+  #if defined(__AVR__)
+  if (_fromEeprom) return eeprom_read_byte((const uint8_t *)(_base + pc));
+  #endif
+  return pgm_read_byte((const uint8_t *)(_base + pc));
+}
+
+
+uint16_t LogicVm::fetch16(uint16_t pc) {
+  return fetch(pc) | (fetch(pc + 1) << 8);
+}
+
+
+static uint8_t instructionLength(uint8_t opcode) {
+  uint8_t length = 1;
+  for (uint8_t i = 0; i < 3; i++) {
+    char operand = pgm_read_byte(&signature[opcode][i]);
+    if (operand == 0) break;
+    length += ((operand == 'w') || (operand == 't')) ? 2 : 1;
+  }
+  return length;
+}
+
+
+//******************************************************************************************************
+// Loading and verification
+//******************************************************************************************************
+bool LogicVm::loadProgmem(const uint8_t *program) {
+  unload();
+  _fromEeprom = false;
+  _base = (uintptr_t)program;
+  return load();
+}
+
+
+bool LogicVm::loadEeprom(uint16_t address) {
+  unload();
+  _fromEeprom = true;
+  _base = address;
+  return load();
+}
+
+
+void LogicVm::unload(void) {
+  _size = 0;
+  for (uint8_t i = 0; i < VmEvents; i++) _entry[i] = 0;
+  for (uint8_t i = 0; i < VmTasks; i++) _task[i].pc = 0;
+}
+
+
+bool LogicVm::load(void) {
+  _size = fetch16(0);
+  uint8_t handlers = fetch(2);
+  _code = 3 + 3 * handlers;
+  if (_code >= _size) {
+    _size = 0;
+    return false;
+  }
+  // Step 1: check all instructions and their operands
+  uint16_t pc = _code;
+  while (pc < _size) {
+    uint8_t opcode = fetch(pc);
+    if (opcode >= VM_OPCODES) break;
+    uint16_t operandPc = pc + 1;
+    for (uint8_t i = 0; i < 3; i++) {
+      char operand = pgm_read_byte(&signature[opcode][i]);
+      if (operand == 0) break;
+      uint8_t value = fetch(operandPc);
+      if (((operand == 'r') || (operand == 's')) && (value >= VmRegisters)) operand = 'x';
+      if ((operand == 'v') && (value >= VmVariables)) operand = 'x';
+      if ((operand == 'f') && (value >= VM_FIELDS)) operand = 'x';
+      if (operand == 'x') {
+        _size = 0;
+        return false;
+      }
+      operandPc += ((operand == 'w') || (operand == 't')) ? 2 : 1;
+    }
+    pc = operandPc;
+  }
+  if (pc != _size) {                                  // Invalid opcode, or last instruction incomplete
+    _size = 0;
+    return false;
+  }
+  // Step 2: check that all jump targets and handlers are at the start of an instruction
+  for (pc = _code; pc < _size; pc += instructionLength(fetch(pc))) {
+    uint8_t opcode = fetch(pc);
+    uint16_t target = 0;
+    if (opcode == VM_JMP) target = fetch16(pc + 1);
+    else if ((opcode == VM_JZ) || (opcode == VM_JNZ)) target = fetch16(pc + 2);
+    else if (opcode == VM_JEQ) target = fetch16(pc + 3);
+    else continue;
+    uint16_t check = _code;
+    while (check < target) check += instructionLength(fetch(check));
+    if ((check != target) || (target >= _size)) {
+      _size = 0;
+      return false;
+    }
+  }
+  // Step 3: build the dispatch table
+  for (uint8_t i = 0; i < handlers; i++) {
+    uint8_t cmdType = fetch(3 + 3 * i);
+    uint16_t target = fetch16(4 + 3 * i);
+    uint16_t check = _code;
+    while (check < target) check += instructionLength(fetch(check));
+    if ((cmdType >= VmEvents) || (check != target) || (target >= _size)) {
+      unload();
+      return false;
+    }
+    _entry[cmdType] = target;
+  }
+  for (uint8_t i = 0; i < VmVariables; i++) variables[i] = 0;
+  dropped = 0;
+  return true;
+}
+
+
+//******************************************************************************************************
+// Starting and running tasks
+//******************************************************************************************************
+void LogicVm::trigger(Dcc::CmdType_t cmdType) {
+  uint16_t entry = _entry[cmdType];
+  if (entry == 0) return;
+  for (uint8_t i = 0; i < VmTasks; i++) {
+    if (_task[i].pc == 0) {
+      _task[i].pc = entry;
+      _task[i].cmdType = cmdType;
+      _task[i].waiting = false;
+      for (uint8_t j = 0; j < VmRegisters; j++) _task[i].r[j] = 0;
+      return;
+    }
+  }
+  dropped++;
+}
+
+
+int16_t LogicVm::field(uint8_t number, uint8_t cmdType) {
+  switch (number) {
+    case VM_F_CMDTYPE:        return cmdType;
+    case VM_F_DECODERADDRESS: return accCmd.decoderAddress;
+    case VM_F_OUTPUTADDRESS:  return accCmd.outputAddress;
+    case VM_F_DEVICE:         return accCmd.device;
+    case VM_F_TURNOUT:        return accCmd.turnout;
+    case VM_F_POSITION:       return accCmd.position;
+    case VM_F_ACTIVATE:       return accCmd.activate;
+    case VM_F_SIGNALHEAD:     return accCmd.signalHead;
+    case VM_F_LOCOADDRESS:    return locoCmd.address;
+    case VM_F_SPEED:          return locoCmd.speed;
+    case VM_F_FORWARD:        return locoCmd.forward;
+    case VM_F_F0F4:           return locoCmd.F0F4;
+    case VM_F_F5F8:           return locoCmd.F5F8;
+    case VM_F_F9F12:          return locoCmd.F9F12;
+    case VM_F_F13F20:         return locoCmd.F13F20;
+    case VM_F_F21F28:         return locoCmd.F21F28;
+    case VM_F_MILLIS:         return (int16_t)clockMillis();
+  }
+  return 0;
+}
+
+
+void LogicVm::run(void) {
+  if (_size == 0) return;
+  unsigned long now = dccMillis();
+  uint8_t steps = budget;
+  for (uint8_t n = 0; (n < VmTasks) && steps; n++) {
+    uint8_t t = _next;
+    _next = (_next + 1) % VmTasks;
+    if (_task[t].pc == 0) continue;
+    if (_task[t].waiting) {
+      if ((unsigned long)(now - _task[t].waitStart) < _task[t].waitMs) continue;
+      _task[t].waiting = false;
+    }
+    int16_t *r = _task[t].r;
+    uint16_t pc = _task[t].pc;
+    // Execute this task till it ends, waits or the budget is used
+    while (steps) {
+      steps--;
+      if (pc >= _size) {                              // Falling off the end equals END
+        pc = 0;
+        break;
+      }
+      uint8_t opcode = fetch(pc);
+      uint8_t a = fetch(pc + 1);                      // Most instructions have one or two byte operands
+      uint8_t b = fetch(pc + 2);
+      uint16_t next = pc + instructionLength(opcode);
+      switch (opcode) {
+        case VM_END:   next = 0; break;
+        case VM_LDI:   r[a] = (int8_t)b; break;
+        case VM_LDW:   r[a] = fetch16(pc + 2); break;
+        case VM_LDF:   r[a] = field(b, _task[t].cmdType); break;
+        case VM_MOV:   r[a] = r[b]; break;
+        case VM_ADD:   r[a] += r[b]; break;
+        case VM_SUB:   r[a] -= r[b]; break;
+        case VM_AND:   r[a] &= r[b]; break;
+        case VM_OR:    r[a] |= r[b]; break;
+        case VM_XOR:   r[a] ^= r[b]; break;
+        case VM_ADDI:  r[a] += (int8_t)b; break;
+        case VM_SHL:   r[a] = (uint16_t)r[a] << (b & 15); break;
+        case VM_SHR:   r[a] = (uint16_t)r[a] >> (b & 15); break;
+        case VM_JMP:   next = a | (b << 8); break;
+        case VM_JZ:    if (r[a] == 0) next = fetch16(pc + 2); break;
+        case VM_JNZ:   if (r[a] != 0) next = fetch16(pc + 2); break;
+        case VM_JEQ:   if (r[a] == (int8_t)b) next = fetch16(pc + 3); break;
+        case VM_OUT:   digitalWrite(a, r[b] ? HIGH : LOW); break;
+        case VM_IN:    r[a] = digitalRead(b); break;
+        case VM_WAIT:  _task[t].waitStart = now; _task[t].waitMs = r[a]; _task[t].waiting = true; break;
+        case VM_WAITI: _task[t].waitStart = now; _task[t].waitMs = a | (b << 8); _task[t].waiting = true; break;
+        case VM_LDV:   r[a] = variables[b]; break;
+        case VM_STV:   variables[a] = r[b]; break;
+      }
+      pc = next;
+      if ((pc == 0) || _task[t].waiting) break;
+    }
+    _task[t].pc = pc;
+  }
+}
+
+#endif
@@ -0,0 +1,98 @@
+//******************************************************************************************************
+//
+// file:      sup_vm.h
+// purpose:   Small bytecode interpreter for user logic that is triggered by DCC commands
+// author:    Aiko Pras
+// version:   2026-10-18 V1.0.0 ap initial version
+//            2026-10-19 V1.0.1 ap WAIT keeps its start and duration, so all 16 bits may be used
+//
+// This source file is subject of the GNU general public license 3,
+// that is available at the world-wide-web at http://www.gnu.org/licenses/gpl.txt
+//
+//******************************************************************************************************
+#pragma once
+#define VmTasks        4                            // Number of programs that may run concurrently
+#define VmRegisters    8                            // Registers per task (r0..r7)
+#define VmVariables    16                           // Variables shared by all tasks (v0..v15)
+#define VmEvents       (Dcc::OccupancyCmd + 1)      // Number of different cmdTypes
+
+// Instruction set. Operands: r, s = register (0..7), v = variable (0..15), f = field, p = Arduino pin,
+// i = 8 bit constant, t = 16 bit target (offset in the program, low byte first), w = 16 bit constant
+#define VM_END         0x00                         // END           The task ends
+#define VM_LDI         0x01                         // LDI  r i      r = i (signed)
+#define VM_LDW         0x02                         // LDW  r w      r = w
+#define VM_LDF         0x03                         // LDF  r f      r = field f of the command (see below)
+#define VM_MOV         0x04                         // MOV  r s      r = s
+#define VM_ADD         0x05                         // ADD  r s      r = r + s
+#define VM_SUB         0x06                         // SUB  r s      r = r - s
+#define VM_AND         0x07                         // AND  r s      r = r & s
+#define VM_OR          0x08                         // OR   r s      r = r | s
+#define VM_XOR         0x09                         // XOR  r s      r = r ^ s
+#define VM_ADDI        0x0A                         // ADDI r i      r = r + i (signed)
+#define VM_SHL         0x0B                         // SHL  r i      r = r << i
+#define VM_SHR         0x0C                         // SHR  r i      r = r >> i (unsigned)
+#define VM_JMP         0x0D                         // JMP  t        continue at t
+#define VM_JZ          0x0E                         // JZ   r t      if r == 0, continue at t
+#define VM_JNZ         0x0F                         // JNZ  r t      if r != 0, continue at t
+#define VM_JEQ         0x10                         // JEQ  r i t    if r == i, continue at t
+#define VM_OUT         0x11                         // OUT  p r      digitalWrite(p, r != 0)
+#define VM_IN          0x12                         // IN   r p      r = digitalRead(p)
+#define VM_WAIT        0x13                         // WAIT r        suspend the task for r ms
+#define VM_WAITI       0x14                         // WAITI w       suspend the task for w ms
+#define VM_LDV         0x15                         // LDV  r v      r = v
+#define VM_STV         0x16                         // STV  v r      v = r
+#define VM_OPCODES     0x17
+
+// Fields that can be loaded with LDF
+#define VM_F_CMDTYPE        0                       // dcc.cmdType that started the task
+#define VM_F_DECODERADDRESS 1                       // accCmd
+#define VM_F_OUTPUTADDRESS  2
+#define VM_F_DEVICE         3
+#define VM_F_TURNOUT        4
+#define VM_F_POSITION       5
+#define VM_F_ACTIVATE       6
+#define VM_F_SIGNALHEAD     7
+#define VM_F_LOCOADDRESS    8                       // locoCmd
+#define VM_F_SPEED          9
+#define VM_F_FORWARD        10
+#define VM_F_F0F4           11
+#define VM_F_F5F8           12
+#define VM_F_F9F12          13
+#define VM_F_F13F20         14
+#define VM_F_F21F28         15
+#define VM_F_MILLIS         16                      // Low 16 bits of millis()
+#define VM_FIELDS           17
+
+
+class LogicVm {
+  public:
+    bool loadProgmem(const uint8_t *program);      // Program in flash (PROGMEM)
+    bool loadEeprom(uint16_t address);              // Program in EEPROM
+    void unload(void);
+    void trigger(Dcc::CmdType_t cmdType);           // Called by dcc.input(): start the handler (if any)
+    void run(void);                                 // Called by dcc.input(): execute upto "budget" steps
+
+    uint8_t budget = 32;                            // Instructions per call of run()
+    uint16_t dropped;                               // Events lost, since all tasks were busy
+    int16_t variables[VmVariables];
+
+  private:
+    bool load(void);                                // Verify the program and build the dispatch table
+    uint8_t fetch(uint16_t pc);
+    uint16_t fetch16(uint16_t pc);
+    int16_t field(uint8_t number, uint8_t cmdType);
+    bool _fromEeprom;
+    uintptr_t _base;                                // Start of the program (flash or EEPROM address)
+    uint16_t _size;                                 // Size of the code
+    uint16_t _code;                                 // Offset of the first instruction
+    uint16_t _entry[VmEvents];                      // Dispatch table: start of the handler per cmdType
+    uint8_t _next;                                  // Task that runs next (round robin)
+    struct {
+      uint16_t pc;                                  // 0 = task is free
+      uint8_t cmdType;
+      unsigned long waitStart;                      // dccMillis() at which WAIT was executed
+      uint16_t waitMs;                              // Duration of that WAIT (upto 65535 ms)
+      bool waiting;
+      int16_t r[VmRegisters];
+    } _task[VmTasks];
+};